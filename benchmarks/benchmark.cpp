@@ -0,0 +1,173 @@
+/******************************************************************************
+**
+** This file is part of commhistory-daemon.
+**
+** Copyright (C) 2026 Jolla Ltd.
+**
+** This library is free software; you can redistribute it and/or modify it
+** under the terms of the GNU Lesser General Public License version 2.1 as
+** published by the Free Software Foundation.
+**
+** This library is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+** or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+** License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this library; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+**
+******************************************************************************/
+
+
+#include "benchmark.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QEventLoop>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStringList>
+#include <QTimer>
+
+#include <stdio.h>
+
+using namespace RTComLogger;
+
+static QVariantMap commonParameters;
+
+Benchmark::Benchmark(const QString &name)
+    : m_name(name),
+      m_parameters(commonParameters),
+      m_firstBegin(-1),
+      m_lastEnd(0),
+      m_injected(0),
+      m_completed(0),
+      m_failed(0)
+{
+    m_clock.start();
+}
+
+int Benchmark::option(const QString &name, int defaultValue)
+{
+    const QStringList arguments(QCoreApplication::arguments());
+    int index = arguments.indexOf(QLatin1String("--") + name);
+    if (index < 0 || index + 1 >= arguments.size())
+        return defaultValue;
+
+    bool ok = false;
+    int value = arguments.at(index + 1).toInt(&ok);
+    if (!ok || value < 0) {
+        qWarning() << "Benchmark: invalid value for" << name << arguments.at(index + 1);
+        return defaultValue;
+    }
+    return value;
+}
+
+QString Benchmark::scenario(const QString &defaultScenario)
+{
+    const QStringList arguments(QCoreApplication::arguments());
+    int index = arguments.indexOf(QStringLiteral("--scenario"));
+    if (index < 0 || index + 1 >= arguments.size())
+        return defaultScenario;
+    return arguments.at(index + 1);
+}
+
+void Benchmark::setParameter(const QString &name, const QVariant &value)
+{
+    m_parameters.insert(name, value);
+}
+
+void Benchmark::setCommonParameter(const QString &name, const QVariant &value)
+{
+    commonParameters.insert(name, value);
+}
+
+void Benchmark::begin(const QString &key)
+{
+    const qint64 now = m_clock.nsecsElapsed();
+    if (m_firstBegin < 0)
+        m_firstBegin = now;
+    m_started.insert(key, now);
+    m_injected++;
+}
+
+bool Benchmark::end(const QString &key, bool successful)
+{
+    QHash<QString, qint64>::iterator it = m_started.find(key);
+    if (it == m_started.end())
+        return false;
+
+    m_lastEnd = m_clock.nsecsElapsed();
+    if (successful) {
+        m_completed++;
+        m_latency.record((m_lastEnd - it.value()) / 1000);
+    } else {
+        m_failed++;
+    }
+    m_started.erase(it);
+    return true;
+}
+
+void Benchmark::endAll()
+{
+    if (m_started.isEmpty())
+        return;
+
+    m_lastEnd = m_clock.nsecsElapsed();
+    m_completed += m_started.size();
+    m_started.clear();
+}
+
+bool Benchmark::waitFor(const std::function<bool()> &done, int msecs)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    // Keeps WaitForMoreEvents from sleeping past the deadline
+    QTimer wakeup;
+    wakeup.start(10);
+
+    while (!done()) {
+        if (timer.elapsed() >= msecs)
+            return false;
+        QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+    }
+    return true;
+}
+
+bool Benchmark::wait(int msecs)
+{
+    return waitFor([this]() { return m_started.isEmpty(); }, msecs);
+}
+
+bool Benchmark::report() const
+{
+    const qint64 elapsedNs = m_firstBegin < 0 ? 0 : qMax<qint64>(m_lastEnd - m_firstBegin, 0);
+
+    QVariantMap result;
+    result.insert(QStringLiteral("benchmark"), m_name);
+    result.insert(QStringLiteral("parameters"), m_parameters);
+    result.insert(QStringLiteral("injected"), m_injected);
+    result.insert(QStringLiteral("completed"), m_completed);
+    result.insert(QStringLiteral("failed"), m_failed);
+    result.insert(QStringLiteral("lost"), m_started.size());
+    result.insert(QStringLiteral("elapsedMs"), elapsedNs / 1000000);
+    if (elapsedNs > 0)
+        result.insert(QStringLiteral("throughputPerSecond"), m_completed * 1e9 / elapsedNs);
+    if (!m_counters.isEmpty()) {
+        QVariantMap counters;
+        for (QHash<QString, int>::const_iterator it = m_counters.constBegin(); it != m_counters.constEnd(); ++it)
+            counters.insert(it.key(), it.value());
+        result.insert(QStringLiteral("counters"), counters);
+    }
+    if (m_latency.count())
+        result.insert(QStringLiteral("latencyUs"), m_latency.toMap());
+    result.insert(QStringLiteral("daemon"), Metrics::instance()->statistics());
+
+    const QByteArray json(QJsonDocument(QJsonObject::fromVariantMap(result)).toJson());
+    fputs(json.constData(), stdout);
+    fflush(stdout);
+
+    return m_failed == 0 && m_started.isEmpty();
+}
@@ -0,0 +1,111 @@
+/******************************************************************************
+**
+** This file is part of commhistory-daemon.
+**
+** Copyright (C) 2026 Jolla Ltd.
+**
+** This library is free software; you can redistribute it and/or modify it
+** under the terms of the GNU Lesser General Public License version 2.1 as
+** published by the Free Software Foundation.
+**
+** This library is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+** or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+** License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this library; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+**
+******************************************************************************/
+
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QString>
+#include <QVariantMap>
+
+#include <functional>
+
+#include "metrics.h"
+
+namespace RTComLogger
+{
+
+/*!
+ * \class Benchmark
+ * \brief Measures one synthetic load scenario.
+ *
+ * The driver calls begin() for every message it injects and end() once
+ * the code under test is done with it. report() prints the throughput,
+ * the per-message latency and the daemon's own Metrics as one JSON
+ * object, so every scenario should run in a process of its own.
+ */
+class Benchmark
+{
+public:
+    explicit Benchmark(const QString &name);
+
+    /*!
+     * \brief Value of "--<name> <value>" on the command line.
+     */
+    static int option(const QString &name, int defaultValue);
+    static QString scenario(const QString &defaultScenario);
+
+    void setParameter(const QString &name, const QVariant &value);
+
+    /*!
+     * \brief Adds a parameter to every benchmark created afterwards.
+     */
+    static void setCommonParameter(const QString &name, const QVariant &value);
+
+    void begin(const QString &key);
+    bool end(const QString &key, bool successful = true);
+
+    /*!
+     * \brief Completes everything still pending without a latency sample,
+     * for code that only tells when the whole load has been handled.
+     */
+    void endAll();
+
+    int pending() const { return m_started.size(); }
+    bool isPending(const QString &key) const { return m_started.contains(key); }
+
+    /*!
+     * \brief Counts something the scenario wants in the report.
+     */
+    void increment(const QString &counter) { m_counters[counter]++; }
+
+    /*!
+     * \brief Runs the event loop until \a done returns true or \a msecs
+     * have passed, returns false on timeout.
+     */
+    static bool waitFor(const std::function<bool()> &done, int msecs);
+    bool wait(int msecs);
+
+    /*!
+     * \brief Prints the result to stdout, returns false if some messages
+     * were lost or failed.
+     */
+    bool report() const;
+
+private:
+    QString m_name;
+    QVariantMap m_parameters;
+    QElapsedTimer m_clock;
+    qint64 m_firstBegin;
+    qint64 m_lastEnd;
+    int m_injected;
+    int m_completed;
+    int m_failed;
+    QHash<QString, qint64> m_started;
+    QHash<QString, int> m_counters;
+    LatencyHistogram m_latency;
+};
+
+} // namespace RTComLogger
+
+#endif // BENCHMARK_H
@@ -0,0 +1,58 @@
+###############################################################################
+#
+# This file is part of commhistory-daemon.
+#
+# Copyright (C) 2026 Jolla Ltd.
+#
+# This library is free software; you can redistribute it and/or modify it
+# under the terms of the GNU Lesser General Public License version 2.1 as
+# published by the Free Software Foundation.
+#
+# This library is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+# or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+# License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this library; if not, write to the Free Software Foundation, Inc.,
+# 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+#
+###############################################################################
+
+!include( ../common-vars.pri ):error( "Unable to install common-vars.pri" )
+
+#-----------------------------------------------------------------------------
+# Synthetic load benchmarks, built on the Telepathy stubs of the unit tests.
+# Each run measures one scenario and prints a JSON report, e.g.
+#   bm_textchannellistener --scenario flood --messages 10000
+#   bm_textchannellistener --scenario reports --messages 5000
+#   bm_textchannellistener --scenario channels --channels 100
+#   bm_textchannellistener --scenario groupchat --members 200
+#   bm_streamchannellistener --scenario missed|answered --calls 1000 --concurrent 20
+#   bm_notificationmanager --scenario flood|contacts|calls --messages 10000
+# All of them take --timeout <ms>. The listener benchmarks run on the
+# database, or with --storage memory on an in-memory stand-in tuned with
+# --storage-latency <us>, --commit-delay <ms> and --fail-every <n>.
+# bm_replay feeds back the Telepathy traffic of a log written by
+# "commhistoryd --record <file>", at --speed <factor> times the original
+# pace (0 for no delays):
+#   bm_replay --log <file> --speed 10
+#-----------------------------------------------------------------------------
+TEMPLATE = subdirs
+SUBDIRS = bm_textchannellistener \
+          bm_streamchannellistener \
+          bm_notificationmanager \
+          bm_replay
+
+# make sure the destination path exists
+!system( mkdir -p $${OUT_PWD}/bin ) : \
+    error( "Unable to create bin dir for benchmarks." )
+
+#-----------------------------------------------------------------------------
+# installation setup
+#-----------------------------------------------------------------------------
+!include( ../common-installs-config.pri ) : \
+         error( "Unable to include common-installs-config.pri!" )
+benchmarks.files = $${OUT_PWD}/bin/*
+benchmarks.path  = /opt/tests/$${PROJECT_NAME}/benchmarks/
+INSTALLS += benchmarks
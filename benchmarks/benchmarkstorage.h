@@ -0,0 +1,63 @@
+/******************************************************************************
+**
+** This file is part of commhistory-daemon.
+**
+** Copyright (C) 2026 Jolla Ltd.
+**
+** This library is free software; you can redistribute it and/or modify it
+** under the terms of the GNU Lesser General Public License version 2.1 as
+** published by the Free Software Foundation.
+**
+** This library is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+** or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+** License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this library; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+**
+******************************************************************************/
+
+
+#ifndef BENCHMARKSTORAGE_H
+#define BENCHMARKSTORAGE_H
+
+#include "benchmark.h"
+#include "inmemorystorage.h"
+
+#include <QCoreApplication>
+#include <QStringList>
+
+namespace RTComLogger
+{
+
+/*!
+ * \brief Installs \a storage when run with "--storage memory", set up
+ * from --storage-latency <us>, --commit-delay <ms> and --fail-every <n>.
+ * The database is used otherwise.
+ */
+inline void setupBenchmarkStorage(InMemoryStorage &storage)
+{
+    const QStringList arguments(QCoreApplication::arguments());
+    int index = arguments.indexOf(QStringLiteral("--storage"));
+    if (index < 0 || arguments.value(index + 1) != QLatin1String("memory")) {
+        Benchmark::setCommonParameter(QStringLiteral("storage"), QStringLiteral("database"));
+        return;
+    }
+
+    QVariantMap parameters;
+    storage.setLatency(Benchmark::option(QStringLiteral("storage-latency"), 0));
+    storage.setCommitDelay(Benchmark::option(QStringLiteral("commit-delay"), 0));
+    storage.setFailEvery(Benchmark::option(QStringLiteral("fail-every"), 0));
+    parameters.insert(QStringLiteral("latencyUs"), Benchmark::option(QStringLiteral("storage-latency"), 0));
+    parameters.insert(QStringLiteral("commitDelayMs"), storage.commitDelay());
+    parameters.insert(QStringLiteral("failEvery"), Benchmark::option(QStringLiteral("fail-every"), 0));
+    Benchmark::setCommonParameter(QStringLiteral("storage"), parameters);
+
+    EventStorage::setInstance(&storage);
+}
+
+} // namespace RTComLogger
+
+#endif // BENCHMARKSTORAGE_H
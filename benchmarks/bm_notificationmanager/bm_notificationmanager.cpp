@@ -0,0 +1,146 @@
+/******************************************************************************
+**
+** This file is part of commhistory-daemon.
+**
+** Copyright (C) 2026 Jolla Ltd.
+**
+** This library is free software; you can redistribute it and/or modify it
+** under the terms of the GNU Lesser General Public License version 2.1 as
+** published by the Free Software Foundation.
+**
+** This library is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+** or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+** License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this library; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+**
+******************************************************************************/
+
+
+#include "bm_notificationmanager.h"
+#include "benchmark.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDebug>
+
+#include "notificationmanager.h"
+#include "personalnotification.h"
+
+#define IM_ACCOUNT_PATH QLatin1String("/org/freedesktop/Telepathy/Account/gabble/jabber/bm_40localhost0")
+#define RING_ACCOUNT_PATH QLatin1String("/org/freedesktop/Telepathy/Account/ring/tel/ring")
+#define IM_CONTACT QLatin1String("contact%1@localhost")
+#define NUMBER QLatin1String("+35850%1")
+
+using namespace RTComLogger;
+using namespace CommHistory;
+
+Bm_NotificationManager::Bm_NotificationManager()
+    : m_nm(NotificationManager::instance()),
+      m_eventId(0)
+{
+}
+
+CommHistory::Event Bm_NotificationManager::createEvent(CommHistory::Event::EventType type,
+                                                       const QString &localUid,
+                                                       const QString &remoteUid)
+{
+    m_eventId++;
+    CommHistory::Event event;
+    event.setId(m_eventId);
+    event.setType(type);
+    event.setDirection(CommHistory::Event::Inbound);
+    event.setStartTime(QDateTime::currentDateTime());
+    event.setEndTime(QDateTime::currentDateTime());
+    event.setLocalUid(localUid);
+    event.setRecipients(Recipient(localUid, remoteUid));
+    event.setMessageToken(QStringLiteral("bm-%1").arg(m_eventId));
+
+    if (type == CommHistory::Event::CallEvent) {
+        event.setIsMissedCall(true);
+    } else {
+        event.setFreeText(QStringLiteral("Benchmark message %1").arg(m_eventId));
+        event.setGroupId(1);
+    }
+    return event;
+}
+
+bool Bm_NotificationManager::idle() const
+{
+    if (m_nm->pendingEventCount() > 0)
+        return false;
+
+    foreach (PersonalNotification *pn, m_nm->m_notifications) {
+        if (pn->hasPendingEvents())
+            return false;
+    }
+    return true;
+}
+
+bool Bm_NotificationManager::run(const QString &scenario)
+{
+    CommHistory::Event::EventType type;
+    QString localUid;
+    QString remoteUid;
+    bool numeric = true;
+    int contacts;
+
+    if (scenario == QLatin1String("flood")) {
+        type = CommHistory::Event::SMSEvent;
+        localUid = RING_ACCOUNT_PATH;
+        remoteUid = NUMBER;
+        contacts = 1;
+    } else if (scenario == QLatin1String("contacts")) {
+        type = CommHistory::Event::IMEvent;
+        localUid = IM_ACCOUNT_PATH;
+        remoteUid = IM_CONTACT;
+        numeric = false;
+        contacts = qMax(Benchmark::option(QStringLiteral("contacts"), 100), 1);
+    } else if (scenario == QLatin1String("calls")) {
+        type = CommHistory::Event::CallEvent;
+        localUid = RING_ACCOUNT_PATH;
+        remoteUid = NUMBER;
+        contacts = qMax(Benchmark::option(QStringLiteral("contacts"), 100), 1);
+    } else {
+        qWarning() << "Unknown scenario" << scenario << "- use flood, contacts or calls";
+        return false;
+    }
+
+    const int messages = Benchmark::option(QStringLiteral("messages"), 10000);
+    const int timeout = Benchmark::option(QStringLiteral("timeout"), 300000);
+
+    // Let the manager finish its own initialisation first
+    Benchmark::waitFor([this]() { return m_nm->m_Initialised; }, timeout);
+
+    Benchmark benchmark(QLatin1String("notificationmanager/") + scenario);
+    benchmark.setParameter(QStringLiteral("messages"), messages);
+    benchmark.setParameter(QStringLiteral("contacts"), contacts);
+
+    for (int i = 0; i < messages; i++) {
+        const QString contact(numeric ? remoteUid.arg(i % contacts, 7, 10, QLatin1Char('0'))
+                                      : remoteUid.arg(i % contacts));
+        CommHistory::Event event(createEvent(type, localUid, contact));
+
+        benchmark.begin(event.messageToken());
+        // Started where TextChannelListener would, stopped when published
+        Metrics::instance()->start(Metrics::NotifyLatency, event.messageToken());
+        m_nm->showNotification(event, contact);
+    }
+
+    if (Benchmark::waitFor([this]() { return idle(); }, timeout))
+        benchmark.endAll();
+
+    m_nm->removeNotifications(localUid);
+    return benchmark.report();
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+
+    Bm_NotificationManager benchmark;
+    return benchmark.run(Benchmark::scenario(QStringLiteral("flood"))) ? 0 : 1;
+}
@@ -0,0 +1,61 @@
+/******************************************************************************
+**
+** This file is part of commhistory-daemon.
+**
+** Copyright (C) 2026 Jolla Ltd.
+**
+** This library is free software; you can redistribute it and/or modify it
+** under the terms of the GNU Lesser General Public License version 2.1 as
+** published by the Free Software Foundation.
+**
+** This library is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+** or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+** License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this library; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+**
+******************************************************************************/
+
+
+#ifndef BM_NOTIFICATIONMANAGER_H
+#define BM_NOTIFICATIONMANAGER_H
+
+#include <QObject>
+
+#include <CommHistory/Event>
+
+namespace RTComLogger {
+
+class NotificationManager;
+
+/*!
+ * \class Bm_NotificationManager
+ * \brief Feeds events to NotificationManager as fast as the channel
+ * listeners could. The load is done when every notification has been
+ * resolved and published; the per-message latency is the daemon's own
+ * notifyLatencyUs histogram.
+ */
+class Bm_NotificationManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    Bm_NotificationManager();
+
+    bool run(const QString &scenario);
+
+private:
+    CommHistory::Event createEvent(CommHistory::Event::EventType type, const QString &localUid,
+                                   const QString &remoteUid);
+    bool idle() const;
+
+    NotificationManager *m_nm;
+    int m_eventId;
+};
+
+}
+
+#endif // BM_NOTIFICATIONMANAGER_H
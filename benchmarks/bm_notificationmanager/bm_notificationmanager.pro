@@ -0,0 +1,67 @@
+###############################################################################
+#
+# This file is part of commhistory-daemon.
+#
+# Copyright (C) 2026 Jolla Ltd.
+#
+# This library is free software; you can redistribute it and/or modify it
+# under the terms of the GNU Lesser General Public License version 2.1 as
+# published by the Free Software Foundation.
+#
+# This library is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+# or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+# License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this library; if not, write to the Free Software Foundation, Inc.,
+# 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+#
+###############################################################################
+
+#-----------------------------------------------------------------------------
+# Project file for benchmark bm_notificationmanager
+#-----------------------------------------------------------------------------
+
+#-----------------------------------------------------------------------------
+# common benchmark configuration
+#-----------------------------------------------------------------------------
+!include(../benchmarks.pri) : error( "Unable to include benchmarks.pri" )
+
+#-----------------------------------------------------------------------------
+# benchmark specific configuration
+#-----------------------------------------------------------------------------
+
+TARGET = bm_notificationmanager
+
+PKGCONFIG += mlocale5 TelepathyQt5 ngf-qt5 nemonotifications-qt5
+
+BENCHMARK_SOURCES += $$COMMHISTORYDSRCDIR/notificationmanager.cpp \
+                     $$COMMHISTORYDSRCDIR/personalnotification.cpp \
+                     $$COMMHISTORYDSRCDIR/serialisable.cpp \
+                     $$COMMHISTORYDSRCDIR/commhistoryservice.cpp \
+                     $$COMMHISTORYDSRCDIR/groupcache.cpp \
+                     $$COMMHISTORYDSRCDIR/debug.cpp \
+                     $$COMMHISTORYDSRCDIR/asynclogger.cpp \
+                     $$COMMHISTORYDSRCDIR/messagetracer.cpp \
+                     $$COMMHISTORYDSRCDIR/dbuscallstats.cpp \
+                     $$COMMHISTORYDSRCDIR/trafficrecorder.cpp
+
+BENCHMARK_HEADERS += $$COMMHISTORYDSRCDIR/notificationmanager.h \
+                     $$COMMHISTORYDSRCDIR/personalnotification.h \
+                     $$COMMHISTORYDSRCDIR/serialisable.h \
+                     $$COMMHISTORYDSRCDIR/commhistoryservice.h \
+                     $$COMMHISTORYDSRCDIR/groupcache.h \
+                     $$COMMHISTORYDSRCDIR/debug.h \
+                     $$COMMHISTORYDSRCDIR/asynclogger.h \
+                     $$COMMHISTORYDSRCDIR/messagetracer.h \
+                     $$COMMHISTORYDSRCDIR/dbuscallstats.h \
+                     $$COMMHISTORYDSRCDIR/trafficrecorder.h
+
+HEADERS     += bm_notificationmanager.h \
+            $$BENCHMARK_HEADERS
+
+SOURCES     += bm_notificationmanager.cpp \
+            $$BENCHMARK_SOURCES
+
+# End of File
@@ -0,0 +1,346 @@
+/******************************************************************************
+**
+** This file is part of commhistory-daemon.
+**
+** Copyright (C) 2026 Jolla Ltd.
+**
+** This library is free software; you can redistribute it and/or modify it
+** under the terms of the GNU Lesser General Public License version 2.1 as
+** published by the Free Software Foundation.
+**
+** This library is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+** or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+** License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this library; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+**
+******************************************************************************/
+
+
+
+#include "bm_replay.h"
+#include "benchmark.h"
+#include "benchmarkstorage.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+
+#include <limits>
+
+#include "TelepathyQt/Account"
+#include "TelepathyQt/TextChannel"
+#include "TelepathyQt/Connection"
+
+#include "TpExtensions/cli-connection.h" // stored messages if
+
+#include "textchannellistener.h"
+#include "notificationmanager.h"
+
+#define SELF_ID QLatin1String("replay@localhost")
+
+using namespace RTComLogger;
+
+namespace {
+    // Reverses TrafficRecorder::plainValue() for message parts, the only
+    // nested values in them are delivery echoes
+    QVariant partValue(const QVariant &value)
+    {
+        if (value.type() != QVariant::List)
+            return value;
+
+        Tp::MessagePartList parts;
+        foreach (const QVariant &part, value.toList()) {
+            if (part.type() != QVariant::Map)
+                return value;
+            Tp::MessagePart restored;
+            const QVariantMap values(part.toMap());
+            for (QVariantMap::const_iterator it = values.constBegin(); it != values.constEnd(); ++it)
+                restored.insert(it.key(), QDBusVariant(partValue(it.value())));
+            parts.append(restored);
+        }
+        return QVariant::fromValue(parts);
+    }
+
+    Tp::MessagePartList messageParts(const QVariant &recorded)
+    {
+        return partValue(recorded).value<Tp::MessagePartList>();
+    }
+
+    QString headerValue(const Tp::MessagePartList &parts, const char *key)
+    {
+        return parts.value(0).value(QLatin1String(key)).variant().toString();
+    }
+}
+
+Bm_Replay::Bm_Replay()
+    : m_benchmark(0),
+      m_timeout(Benchmark::option(QStringLiteral("timeout"), 60000)),
+      m_nextHandle(1)
+{
+}
+
+Bm_Replay::~Bm_Replay()
+{
+    qDeleteAll(m_listeners);
+}
+
+bool Bm_Replay::load(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Cannot open" << fileName << file.errorString();
+        return false;
+    }
+
+    QDataStream stream(&file);
+    if (TrafficRecorder::readHeader(stream) < 0)
+        return false;
+
+    // Everything is read up front to keep file access out of the timing
+    TrafficRecorder::Record record;
+    while (TrafficRecorder::readRecord(stream, record))
+        m_records.append(record);
+    if (!stream.atEnd())
+        qWarning() << "Truncated record at the end of" << fileName;
+    return true;
+}
+
+bool Bm_Replay::run(const QString &fileName)
+{
+    if (fileName.isEmpty()) {
+        qWarning() << "Usage: bm_replay --log <file> [--speed <factor>]";
+        return false;
+    }
+    if (!load(fileName))
+        return false;
+
+    const int speed = Benchmark::option(QStringLiteral("speed"), 1);
+
+    Benchmark benchmark(QStringLiteral("replay"));
+    benchmark.setParameter(QStringLiteral("log"), fileName);
+    benchmark.setParameter(QStringLiteral("speed"), speed);
+    benchmark.setParameter(QStringLiteral("records"), m_records.size());
+    m_benchmark = &benchmark;
+
+    // Time before the first input is not replayed
+    const qint64 firstUs = m_records.isEmpty() ? 0 : m_records.first().timestampUs;
+    QElapsedTimer clock;
+    clock.start();
+
+    foreach (const TrafficRecorder::Record &record, m_records) {
+        if (speed > 0) {
+            const qint64 dueUs = (record.timestampUs - firstUs) / speed;
+            Benchmark::waitFor([&clock, dueUs]() { return clock.nsecsElapsed() / 1000 >= dueUs; },
+                               std::numeric_limits<int>::max());
+        }
+        replay(record);
+    }
+
+    benchmark.wait(m_timeout);
+    m_benchmark = 0;
+    return benchmark.report();
+}
+
+void Bm_Replay::replay(const TrafficRecorder::Record &record)
+{
+    switch (record.kind) {
+    case TrafficRecorder::TextChannelOpened:
+        openChannel(record.args);
+        break;
+    case TrafficRecorder::TextMessageReceived:
+        receiveMessage(record.args);
+        break;
+    case TrafficRecorder::TextMessageSent:
+        sendMessage(record.args);
+        break;
+    case TrafficRecorder::TextChannelClosed:
+        closeChannel(record.args);
+        break;
+    // The stubs have no MMS engine, contacts or observers to feed these to
+    case TrafficRecorder::MmsEngineCall:
+        m_benchmark->increment(QStringLiteral("skippedMmsEngineCalls"));
+        break;
+    case TrafficRecorder::ObservedConversationsChanged:
+    case TrafficRecorder::InboxObservedChanged:
+        m_benchmark->increment(QStringLiteral("skippedObservedChanges"));
+        break;
+    case TrafficRecorder::ContactsChanged:
+        m_benchmark->increment(QStringLiteral("skippedContactChanges"));
+        break;
+    default:
+        m_benchmark->increment(QStringLiteral("skippedUnknown"));
+        break;
+    }
+}
+
+Tp::AccountPtr Bm_Replay::account(const QString &accountPath, const QString &protocol)
+{
+    Tp::AccountPtr &entry(m_accounts[accountPath]);
+    if (!entry) {
+        const bool cellular = protocol == QLatin1String("tel");
+        Tp::ConnectionPtr connection(new Tp::Connection());
+        connection->ut_setIsReady(true);
+        if (cellular)
+            connection->ut_setInterfaces(QStringList() << CommHistoryTp::Client::ConnectionInterfaceStoredMessagesInterface::staticInterfaceName());
+
+        entry = Tp::AccountPtr(new Tp::Account(connection, accountPath));
+        entry->ut_setProtocolName(protocol);
+    }
+    return entry;
+}
+
+Tp::ContactPtr Bm_Replay::contact(const QString &id, uint handle)
+{
+    Tp::ContactPtr &entry(m_contacts[id]);
+    if (!entry) {
+        entry = Tp::ContactPtr(new Tp::Contact());
+        entry->ut_setHandle(handle ? handle : m_nextHandle++);
+        entry->ut_setId(id);
+    }
+    return entry;
+}
+
+void Bm_Replay::openChannel(const QVariantList &args)
+{
+    const QString accountPath(args.value(0).toString());
+    const QString protocol(args.value(1).toString());
+    const QString path(args.value(2).toString());
+    const QString targetId(args.value(3).toString());
+    const uint targetHandleType = args.value(4).toUInt();
+    const bool requested = args.value(5).toBool();
+    const QStringList members(args.value(6).toStringList());
+
+    Tp::AccountPtr acc(account(accountPath, protocol));
+
+    Tp::ChannelPtr ch(new Tp::TextChannel(path));
+    ch->ut_setIsRequested(requested);
+    ch->ut_setTargetHandleType(targetHandleType);
+    ch->ut_setTargetHandle(m_nextHandle++);
+    if (!members.isEmpty()) {
+        Tp::ContactPtr self(contact(SELF_ID));
+        Tp::Contacts contacts;
+        foreach (const QString &member, members)
+            contacts << contact(member);
+        ch->ut_setInterfaces(QStringList() << TP_QT_IFACE_CHANNEL_INTERFACE_GROUP);
+        ch->ut_setGroupSelfContact(self);
+        ch->ut_setGroupContacts(contacts << self);
+    }
+    QVariantMap immProp;
+    immProp.insert(TELEPATHY_INTERFACE_CHANNEL ".TargetID", targetId);
+    ch->ut_setImmutableProperties(immProp);
+    ch->ut_setConnection(acc->connection());
+
+    Tp::MethodInvocationContextPtr<> ctx(new Tp::MethodInvocationContext<>());
+    TextChannelListener *tcl = new TextChannelListener(acc, ch, ctx);
+    if (!Benchmark::waitFor([ctx]() { return ctx->isFinished(); }, m_timeout) || ctx->isError()) {
+        qWarning() << "Channel" << path << "did not become ready";
+        m_benchmark->increment(QStringLiteral("failedChannels"));
+        delete tcl;
+        return;
+    }
+
+    connect(&tcl->eventModel(), SIGNAL(eventsCommitted(const QList<CommHistory::Event>&, bool)),
+            SLOT(eventsCommitted(const QList<CommHistory::Event>&, bool)));
+    connect(tcl, SIGNAL(channelClosed(ChannelListener*)),
+            SLOT(channelClosed(ChannelListener*)));
+    m_listeners.append(tcl);
+    m_channels.insert(path, Tp::TextChannelPtr::dynamicCast(ch));
+}
+
+void Bm_Replay::receiveMessage(const QVariantList &args)
+{
+    Tp::TextChannelPtr ch(m_channels.value(args.value(0).toString()));
+    if (!ch) {
+        m_benchmark->increment(QStringLiteral("messagesWithoutChannel"));
+        return;
+    }
+
+    const Tp::MessagePartList parts(messageParts(args.value(3)));
+    Tp::ReceivedMessage msg(parts);
+    const QString senderId(args.value(1).toString());
+    if (!senderId.isEmpty())
+        msg.ut_setSender(contact(senderId, args.value(2).toUInt()));
+
+    // Reports update the event of the message they refer to
+    const bool report = msg.messageType() == Tp::ChannelTextMessageTypeDeliveryReport;
+    const QString key(report ? headerValue(parts, "delivery-token") : msg.messageToken());
+    if (key.isEmpty() || (report && !m_tokens.contains(key)) || m_benchmark->isPending(key)) {
+        m_benchmark->increment(QStringLiteral("untracked"));
+    } else {
+        m_benchmark->begin(key);
+        m_tokens.insert(key);
+    }
+
+    ch->ut_receiveMessage(msg);
+}
+
+void Bm_Replay::sendMessage(const QVariantList &args)
+{
+    Tp::TextChannelPtr ch(m_channels.value(args.value(0).toString()));
+    if (!ch) {
+        m_benchmark->increment(QStringLiteral("messagesWithoutChannel"));
+        return;
+    }
+
+    const QString token(args.value(2).toString());
+    if (token.isEmpty() || m_benchmark->isPending(token)) {
+        m_benchmark->increment(QStringLiteral("untracked"));
+    } else {
+        m_benchmark->begin(token);
+        m_tokens.insert(token);
+    }
+
+    ch->ut_sendMessage(Tp::Message(messageParts(args.value(3))),
+                       Tp::MessageSendingFlags(args.value(1).toUInt()), token);
+}
+
+void Bm_Replay::closeChannel(const QVariantList &args)
+{
+    Tp::TextChannelPtr ch(m_channels.take(args.value(0).toString()));
+    if (ch)
+        ch->ut_invalidate(TELEPATHY_ERROR_TERMINATED, QString());
+}
+
+void Bm_Replay::eventsCommitted(const QList<CommHistory::Event> &events, bool successful)
+{
+    if (!m_benchmark)
+        return;
+
+    foreach (const CommHistory::Event &event, events) {
+        // Incoming messages are saved again by the listener
+        if (!successful && event.direction() == CommHistory::Event::Inbound)
+            m_benchmark->increment(QStringLiteral("commitRetries"));
+        else
+            m_benchmark->end(event.messageToken(), successful);
+    }
+
+    // The stub only records these, keep it from growing with the load
+    NotificationManager::instance()->postedNotifications.clear();
+}
+
+void Bm_Replay::channelClosed(ChannelListener *listener)
+{
+    m_listeners.removeOne(static_cast<TextChannelListener*>(listener));
+    listener->deleteLater();
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    qRegisterMetaType<Tp::PendingOperation*>("Tp::PendingOperation*");
+    qRegisterMetaType<RTComLogger::ChannelListener*>("ChannelListener*");
+
+    InMemoryStorage storage;
+    setupBenchmarkStorage(storage);
+
+    const QStringList arguments(app.arguments());
+    const int logIndex = arguments.indexOf(QStringLiteral("--log"));
+
+    Bm_Replay benchmark;
+    return benchmark.run(arguments.value(logIndex < 0 ? -1 : logIndex + 1)) ? 0 : 1;
+}
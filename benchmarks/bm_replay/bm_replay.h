@@ -0,0 +1,94 @@
+/******************************************************************************
+**
+** This file is part of commhistory-daemon.
+**
+** Copyright (C) 2026 Jolla Ltd.
+**
+** This library is free software; you can redistribute it and/or modify it
+** under the terms of the GNU Lesser General Public License version 2.1 as
+** published by the Free Software Foundation.
+**
+** This library is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+** or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+** License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this library; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+**
+******************************************************************************/
+
+
+
+#ifndef BM_REPLAY_H
+#define BM_REPLAY_H
+
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QSet>
+
+#include "TelepathyQt/Types"
+#include "TelepathyQt/Contact"
+#include "TelepathyQt/Message"
+
+#include <CommHistory/Event>
+
+#include "trafficrecorder.h"
+
+namespace RTComLogger {
+
+class Benchmark;
+class ChannelListener;
+class TextChannelListener;
+
+/*!
+ * \class Bm_Replay
+ * \brief Feeds a log written by TrafficRecorder back through
+ * TextChannelListener on the Telepathy stubs, at the original pace or
+ * --speed times faster (0 for no delays). A message is done when its
+ * event has been committed.
+ */
+class Bm_Replay : public QObject
+{
+    Q_OBJECT
+
+public:
+    Bm_Replay();
+    ~Bm_Replay();
+
+    bool run(const QString &fileName);
+
+private Q_SLOTS:
+    void eventsCommitted(const QList<CommHistory::Event> &events, bool successful);
+    void channelClosed(ChannelListener *listener);
+
+private:
+    bool load(const QString &fileName);
+    void replay(const TrafficRecorder::Record &record);
+
+    void openChannel(const QVariantList &args);
+    void receiveMessage(const QVariantList &args);
+    void sendMessage(const QVariantList &args);
+    void closeChannel(const QVariantList &args);
+
+    Tp::AccountPtr account(const QString &accountPath, const QString &protocol);
+    Tp::ContactPtr contact(const QString &id, uint handle = 0);
+
+    Benchmark *m_benchmark;
+    int m_timeout;
+    uint m_nextHandle;
+    QList<TrafficRecorder::Record> m_records;
+    QHash<QString, Tp::AccountPtr> m_accounts;
+    QHash<QString, Tp::ContactPtr> m_contacts;
+    QHash<QString, Tp::TextChannelPtr> m_channels;
+    QList<TextChannelListener*> m_listeners;
+    // Tokens of messages replayed so far, reports for other messages
+    // have nothing to update and are not measured
+    QSet<QString> m_tokens;
+};
+
+}
+
+#endif // BM_REPLAY_H
@@ -0,0 +1,71 @@
+###############################################################################
+#
+# This file is part of commhistory-daemon.
+#
+# Copyright (C) 2026 Jolla Ltd.
+#
+# This library is free software; you can redistribute it and/or modify it
+# under the terms of the GNU Lesser General Public License version 2.1 as
+# published by the Free Software Foundation.
+#
+# This library is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+# or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+# License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this library; if not, write to the Free Software Foundation, Inc.,
+# 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+#
+###############################################################################
+
+#-----------------------------------------------------------------------------
+# Project file for benchmark bm_replay
+#-----------------------------------------------------------------------------
+
+#-----------------------------------------------------------------------------
+# common benchmark configuration
+#-----------------------------------------------------------------------------
+!include(../benchmarks.pri) : error( "Unable to include benchmarks.pri" )
+
+!include( $$STUBSDIR/stubs.pri ) : error("Unable to include stubs/stubs.pri")
+INCLUDEPATH = $$STUBSDIR/ $${INCLUDEPATH}
+
+#-----------------------------------------------------------------------------
+# benchmark specific configuration
+#-----------------------------------------------------------------------------
+
+TARGET = bm_replay
+
+PKGCONFIG += mlocale5
+
+BENCHMARK_SOURCES += $$COMMHISTORYDSRCDIR/textchannellistener.cpp \
+                     $$COMMHISTORYDSRCDIR/channellistener.cpp \
+                     $$COMMHISTORYDSRCDIR/eventmodelpool.cpp \
+                     $$COMMHISTORYDSRCDIR/eventstorage.cpp \
+                     $$COMMHISTORYDSRCDIR/shutdowncoordinator.cpp \
+                     $$COMMHISTORYDSRCDIR/debug.cpp \
+                     $$COMMHISTORYDSRCDIR/messagetracer.cpp \
+                     $$COMMHISTORYDSRCDIR/dbuscallstats.cpp \
+                     $$COMMHISTORYDSRCDIR/trafficrecorder.cpp
+
+BENCHMARK_HEADERS += $$COMMHISTORYDSRCDIR/textchannellistener.h \
+                     $$COMMHISTORYDSRCDIR/channellistener.h \
+                     $$COMMHISTORYDSRCDIR/eventmodelpool.h \
+                     $$COMMHISTORYDSRCDIR/eventstorage.h \
+                     $$COMMHISTORYDSRCDIR/shutdowncoordinator.h \
+                     $$COMMHISTORYDSRCDIR/debug.h \
+                     $$COMMHISTORYDSRCDIR/messagetracer.h \
+                     $$COMMHISTORYDSRCDIR/dbuscallstats.h \
+                     $$COMMHISTORYDSRCDIR/trafficrecorder.h
+
+HEADERS     += bm_replay.h \
+            ../benchmarkstorage.h \
+            $$STUBSDIR/inmemorystorage.h \
+            $$BENCHMARK_HEADERS
+
+SOURCES     += bm_replay.cpp \
+            $$STUBSDIR/inmemorystorage.cpp \
+            $$BENCHMARK_SOURCES
+
+# End of File
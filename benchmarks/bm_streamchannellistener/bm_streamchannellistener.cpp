@@ -0,0 +1,202 @@
+/******************************************************************************
+**
+** This file is part of commhistory-daemon.
+**
+** Copyright (C) 2026 Jolla Ltd.
+**
+** This library is free software; you can redistribute it and/or modify it
+** under the terms of the GNU Lesser General Public License version 2.1 as
+** published by the Free Software Foundation.
+**
+** This library is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+** or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+** License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this library; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+**
+******************************************************************************/
+
+
+#include "bm_streamchannellistener.h"
+#include "benchmark.h"
+#include "benchmarkstorage.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+
+#include "TelepathyQt/Account"
+#include "TelepathyQt/Channel"
+#include "TelepathyQt/Contact"
+#include "TelepathyQt/StreamedMediaChannel"
+#include "TelepathyQt/Connection"
+
+#include "streamchannellistener.h"
+#include "notificationmanager.h"
+
+#define ACCOUNT_PATH QLatin1String("/org/freedesktop/Telepathy/Account/ring/tel/ring")
+#define CHANNEL_PATH QLatin1String("/org/freedesktop/Telepathy/Connection/ring/tel/ring/call%1")
+#define NUMBER QLatin1String("+35850%1")
+#define SELF_HANDLE 1
+
+using namespace RTComLogger;
+
+Bm_StreamChannelListener::Bm_StreamChannelListener()
+    : m_benchmark(0),
+      m_answer(false),
+      m_started(0),
+      m_total(0)
+{
+}
+
+bool Bm_StreamChannelListener::run(const QString &scenario)
+{
+    if (scenario == QLatin1String("answered")) {
+        m_answer = true;
+    } else if (scenario != QLatin1String("missed")) {
+        qWarning() << "Unknown scenario" << scenario << "- use missed or answered";
+        return false;
+    }
+
+    m_total = Benchmark::option(QStringLiteral("calls"), 1000);
+    const int concurrent = qMax(Benchmark::option(QStringLiteral("concurrent"), 20), 1);
+
+    m_connection = Tp::ConnectionPtr(new Tp::Connection());
+    m_connection->ut_setIsReady(true);
+    m_account = Tp::AccountPtr(new Tp::Account(m_connection, ACCOUNT_PATH));
+
+    Benchmark benchmark(QLatin1String("streamchannellistener/") + scenario);
+    benchmark.setParameter(QStringLiteral("calls"), m_total);
+    benchmark.setParameter(QStringLiteral("concurrent"), concurrent);
+    m_benchmark = &benchmark;
+
+    // Every pass gives the listeners a turn of the event loop before the
+    // next state change, as Telepathy would
+    Benchmark::waitFor([this, concurrent]() {
+        for (int i = m_calls.size() - 1; i >= 0; i--) {
+            if (!m_calls.at(i).listener)
+                m_calls.removeAt(i);
+        }
+        for (int i = 0; i < m_calls.size(); i++)
+            advance(m_calls[i]);
+
+        while (m_started < m_total && m_calls.size() < concurrent)
+            startCall();
+        return m_calls.isEmpty();
+    }, Benchmark::option(QStringLiteral("timeout"), 300000));
+
+    m_benchmark = 0;
+    NotificationManager::instance()->postedNotifications.clear();
+    return benchmark.report();
+}
+
+void Bm_StreamChannelListener::startCall()
+{
+    const int index = m_started++;
+
+    QVariantMap immProp;
+    immProp.insert(TELEPATHY_INTERFACE_CHANNEL ".TargetID", QString(NUMBER).arg(index, 7, 10, QLatin1Char('0')));
+    immProp.insert(TELEPATHY_INTERFACE_CHANNEL ".Requested", false);
+
+    Call call;
+    call.key = QString(CHANNEL_PATH).arg(index);
+    call.channel = Tp::ChannelPtr(new Tp::StreamedMediaChannel(call.key, immProp));
+    call.channel->ut_setIsRequested(false);
+    call.channel->ut_setTargetHandleType(Tp::HandleTypeContact);
+    call.channel->ut_setTargetHandle(SELF_HANDLE + 1 + index);
+    call.channel->ut_setConnection(m_connection);
+    call.step = 0;
+
+    m_benchmark->begin(call.key);
+
+    Tp::MethodInvocationContextPtr<> ctx(new Tp::MethodInvocationContext<>());
+    call.listener = new StreamChannelListener(m_account, call.channel, ctx);
+    connect(call.listener, SIGNAL(channelClosed(ChannelListener*)),
+            SLOT(channelClosed(ChannelListener*)));
+    m_calls.append(call);
+}
+
+void Bm_StreamChannelListener::advance(Call &call)
+{
+    // Invalidating may close the listener right away, so work on a copy
+    Tp::ChannelPtr ch(call.channel);
+
+    switch (call.step) {
+    case 0:
+        if (!m_answer) {
+            // Remote end gave up before the call was answered
+            call.step = 3;
+            ch->ut_invalidate(TELEPATHY_ERROR_TERMINATED, QString());
+        } else {
+            Tp::ContactPtr self(new Tp::Contact());
+            self->ut_setHandle(SELF_HANDLE);
+            Tp::ContactPtr target(new Tp::Contact());
+            target->ut_setHandle(ch->targetHandle());
+            target->ut_setId(ch->immutableProperties().value(TELEPATHY_INTERFACE_CHANNEL ".TargetID").toString());
+
+            ch->ut_setGroupSelfContact(self);
+            ch->ut_setGroupContacts(Tp::Contacts() << target << self);
+            Tp::StreamedMediaChannelPtr::dynamicCast(ch)->ut_addStream();
+            Tp::StreamedMediaChannelPtr::dynamicCast(ch)->ut_streams().first()->ut_setLocalPendingState(Tp::StreamedMediaStream::SendingStateSending);
+
+            Tp::Channel::GroupMemberChangeDetails details(self, Tp::ChannelGroupChangeReasonNone);
+            call.step = 1;
+            ch->ut_emitGroupMembersChanged(Tp::Contacts() << self,
+                                           Tp::Contacts(),
+                                           Tp::Contacts(),
+                                           Tp::Contacts(),
+                                           details);
+        }
+        break;
+    case 1: {
+        // Hang up locally
+        Tp::ContactPtr self(ch->groupSelfContact());
+        Tp::Channel::GroupMemberChangeDetails details(self, Tp::ChannelGroupChangeReasonNone);
+        Tp::Contacts remaining(ch->groupContacts());
+        remaining.remove(self);
+        ch->ut_setGroupContacts(remaining);
+        call.step = 2;
+        ch->ut_emitGroupMembersChanged(Tp::Contacts(),
+                                       Tp::Contacts(),
+                                       Tp::Contacts(),
+                                       Tp::Contacts() << self,
+                                       details);
+        break;
+    }
+    case 2:
+        call.step = 3;
+        ch->ut_invalidate(QString(), QString());
+        break;
+    default:
+        // Waiting for the listener to store the event and close
+        break;
+    }
+}
+
+void Bm_StreamChannelListener::channelClosed(ChannelListener *listener)
+{
+    // Removed from m_calls on the next pass, this may be called from advance()
+    for (int i = 0; i < m_calls.size(); i++) {
+        if (m_calls.at(i).listener == listener) {
+            if (m_benchmark)
+                m_benchmark->end(m_calls.at(i).key);
+            m_calls[i].listener = 0;
+            break;
+        }
+    }
+    listener->deleteLater();
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    qRegisterMetaType<RTComLogger::ChannelListener*>("ChannelListener*");
+
+    InMemoryStorage storage;
+    setupBenchmarkStorage(storage);
+
+    Bm_StreamChannelListener benchmark;
+    return benchmark.run(Benchmark::scenario(QStringLiteral("missed"))) ? 0 : 1;
+}
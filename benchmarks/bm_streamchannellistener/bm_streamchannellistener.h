@@ -0,0 +1,77 @@
+/******************************************************************************
+**
+** This file is part of commhistory-daemon.
+**
+** Copyright (C) 2026 Jolla Ltd.
+**
+** This library is free software; you can redistribute it and/or modify it
+** under the terms of the GNU Lesser General Public License version 2.1 as
+** published by the Free Software Foundation.
+**
+** This library is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+** or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+** License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this library; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+**
+******************************************************************************/
+
+
+#ifndef BM_STREAMCHANNELLISTENER_H
+#define BM_STREAMCHANNELLISTENER_H
+
+#include <QObject>
+#include <QList>
+
+#include "TelepathyQt/Types"
+
+namespace RTComLogger {
+
+class Benchmark;
+class ChannelListener;
+class StreamChannelListener;
+
+/*!
+ * \class Bm_StreamChannelListener
+ * \brief Drives StreamChannelListener with many calls on the Telepathy
+ * stubs, keeping a number of them open at the same time. A call is done
+ * when its listener has stored the event and closed.
+ */
+class Bm_StreamChannelListener : public QObject
+{
+    Q_OBJECT
+
+public:
+    Bm_StreamChannelListener();
+
+    bool run(const QString &scenario);
+
+private Q_SLOTS:
+    void channelClosed(ChannelListener *listener);
+
+private:
+    struct Call {
+        Tp::ChannelPtr channel;
+        StreamChannelListener *listener;
+        QString key;
+        int step;
+    };
+
+    void startCall();
+    void advance(Call &call);
+
+    Benchmark *m_benchmark;
+    bool m_answer;
+    int m_started;
+    int m_total;
+    Tp::ConnectionPtr m_connection;
+    Tp::AccountPtr m_account;
+    QList<Call> m_calls;
+};
+
+}
+
+#endif // BM_STREAMCHANNELLISTENER_H
@@ -0,0 +1,65 @@
+###############################################################################
+#
+# This file is part of commhistory-daemon.
+#
+# Copyright (C) 2026 Jolla Ltd.
+#
+# This library is free software; you can redistribute it and/or modify it
+# under the terms of the GNU Lesser General Public License version 2.1 as
+# published by the Free Software Foundation.
+#
+# This library is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+# or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+# License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this library; if not, write to the Free Software Foundation, Inc.,
+# 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+#
+###############################################################################
+
+#-----------------------------------------------------------------------------
+# Project file for benchmark bm_streamchannellistener
+#-----------------------------------------------------------------------------
+
+#-----------------------------------------------------------------------------
+# common benchmark configuration
+#-----------------------------------------------------------------------------
+!include(../benchmarks.pri) : error( "Unable to include benchmarks.pri" )
+
+!include( $$STUBSDIR/stubs.pri ) : error("Unable to include stubs/stubs.pri")
+INCLUDEPATH = $$STUBSDIR/ $${INCLUDEPATH}
+
+#-----------------------------------------------------------------------------
+# benchmark specific configuration
+#-----------------------------------------------------------------------------
+
+TARGET = bm_streamchannellistener
+
+LIBS += -lrt
+
+BENCHMARK_SOURCES += $$COMMHISTORYDSRCDIR/streamchannellistener.cpp \
+                     $$COMMHISTORYDSRCDIR/channellistener.cpp \
+                     $$COMMHISTORYDSRCDIR/calljournal.cpp \
+                     $$COMMHISTORYDSRCDIR/eventmodelpool.cpp \
+                     $$COMMHISTORYDSRCDIR/eventstorage.cpp \
+                     $$COMMHISTORYDSRCDIR/debug.cpp
+
+BENCHMARK_HEADERS += $$COMMHISTORYDSRCDIR/streamchannellistener.h \
+                     $$COMMHISTORYDSRCDIR/channellistener.h \
+                     $$COMMHISTORYDSRCDIR/calljournal.h \
+                     $$COMMHISTORYDSRCDIR/eventmodelpool.h \
+                     $$COMMHISTORYDSRCDIR/eventstorage.h \
+                     $$COMMHISTORYDSRCDIR/debug.h
+
+HEADERS     += bm_streamchannellistener.h \
+            ../benchmarkstorage.h \
+            $$STUBSDIR/inmemorystorage.h \
+            $$BENCHMARK_HEADERS
+
+SOURCES     += bm_streamchannellistener.cpp \
+            $$STUBSDIR/inmemorystorage.cpp \
+            $$BENCHMARK_SOURCES
+
+# End of File
@@ -0,0 +1,346 @@
+/******************************************************************************
+**
+** This file is part of commhistory-daemon.
+**
+** Copyright (C) 2026 Jolla Ltd.
+**
+** This library is free software; you can redistribute it and/or modify it
+** under the terms of the GNU Lesser General Public License version 2.1 as
+** published by the Free Software Foundation.
+**
+** This library is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+** or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+** License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this library; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+**
+******************************************************************************/
+
+
+#include "bm_textchannellistener.h"
+#include "benchmark.h"
+#include "benchmarkstorage.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDebug>
+#include <QUuid>
+
+#include "TelepathyQt/Account"
+#include "TelepathyQt/TextChannel"
+#include "TelepathyQt/Connection"
+
+#include "TpExtensions/cli-connection.h" // stored messages if
+
+#include "textchannellistener.h"
+#include "notificationmanager.h"
+
+#define SMS_ACCOUNT_PATH QLatin1String("/org/freedesktop/Telepathy/Account/ring/tel/ring")
+#define SMS_CHANNEL_PATH QLatin1String("/org/freedesktop/Telepathy/Connection/ring/tel/ring/text%1")
+#define SMS_NUMBER QLatin1String("+35850%1")
+#define IM_ACCOUNT_PATH QLatin1String("/org/freedesktop/Telepathy/Account/gabble/jabber/bm_40localhost0")
+#define IM_CHANNEL_PATH QLatin1String("/org/freedesktop/Telepathy/Connection/gabble/jabber/bm_40localhost0/text%1")
+#define IM_ROOM QLatin1String("bm@conference.localhost")
+#define IM_MEMBER QLatin1String("member%1@localhost")
+
+using namespace RTComLogger;
+
+namespace {
+    static uint pendingMessageId = 0;
+
+    template<typename T>
+    void addMsgHeader(Tp::Message &msg, int index, const char *key, T value) {
+        msg.ut_part(index).insert(QLatin1String(key),
+                                  QDBusVariant(value));
+    }
+
+    Tp::ContactPtr contact(uint handle, const QString &id)
+    {
+        Tp::ContactPtr c(new Tp::Contact());
+        c->ut_setHandle(handle);
+        c->ut_setId(id);
+        return c;
+    }
+}
+
+Bm_TextChannelListener::Bm_TextChannelListener()
+    : m_benchmark(0),
+      m_timeout(Benchmark::option(QStringLiteral("timeout"), 300000)),
+      m_nextHandle(1)
+{
+}
+
+Bm_TextChannelListener::~Bm_TextChannelListener()
+{
+    qDeleteAll(m_listeners);
+}
+
+bool Bm_TextChannelListener::run(const QString &scenario)
+{
+    if (scenario == QLatin1String("flood"))
+        return flood();
+    if (scenario == QLatin1String("reports"))
+        return deliveryReports();
+    if (scenario == QLatin1String("channels"))
+        return channels();
+    if (scenario == QLatin1String("groupchat"))
+        return groupChat();
+
+    qWarning() << "Unknown scenario" << scenario << "- use flood, reports, channels or groupchat";
+    return false;
+}
+
+void Bm_TextChannelListener::eventsCommitted(const QList<CommHistory::Event> &events, bool successful)
+{
+    if (!m_benchmark)
+        return;
+
+    foreach (const CommHistory::Event &event, events) {
+        // Incoming messages are saved again by the listener
+        if (!successful && event.direction() == CommHistory::Event::Inbound)
+            m_benchmark->increment(QStringLiteral("commitRetries"));
+        else
+            m_benchmark->end(event.messageToken(), successful);
+    }
+
+    // The stub only records these, keep it from growing with the load
+    NotificationManager::instance()->postedNotifications.clear();
+}
+
+void Bm_TextChannelListener::setupAccount(const QString &accountPath, bool cellular)
+{
+    m_connection = Tp::ConnectionPtr(new Tp::Connection());
+    m_connection->ut_setIsReady(true);
+    if (cellular)
+        m_connection->ut_setInterfaces(QStringList() << CommHistoryTp::Client::ConnectionInterfaceStoredMessagesInterface::staticInterfaceName());
+
+    m_account = Tp::AccountPtr(new Tp::Account(m_connection, accountPath));
+    if (cellular)
+        m_account->ut_setProtocolName("tel");
+}
+
+Tp::TextChannelPtr Bm_TextChannelListener::openChannel(const QString &targetId, bool requested,
+                                                       const Tp::Contacts &members)
+{
+    const bool cellular = m_account->protocolName() == QLatin1String("tel");
+    const QString path((cellular ? SMS_CHANNEL_PATH : IM_CHANNEL_PATH).arg(m_channels.size()));
+
+    Tp::ChannelPtr ch(new Tp::TextChannel(path));
+    ch->ut_setIsRequested(requested);
+    if (members.isEmpty()) {
+        ch->ut_setTargetHandleType(Tp::HandleTypeContact);
+        ch->ut_setTargetHandle(m_nextHandle++);
+    } else {
+        Tp::ContactPtr self(contact(0, QStringLiteral("bm@localhost")));
+        ch->ut_setTargetHandleType(Tp::HandleTypeRoom);
+        ch->ut_setTargetHandle(m_nextHandle++);
+        ch->ut_setInterfaces(QStringList() << TP_QT_IFACE_CHANNEL_INTERFACE_GROUP);
+        ch->ut_setGroupSelfContact(self);
+        ch->ut_setGroupContacts(Tp::Contacts(members) << self);
+    }
+    QVariantMap immProp;
+    immProp.insert(TELEPATHY_INTERFACE_CHANNEL ".TargetID", targetId);
+    ch->ut_setImmutableProperties(immProp);
+    ch->ut_setConnection(m_connection);
+
+    Tp::MethodInvocationContextPtr<> ctx(new Tp::MethodInvocationContext<>());
+    TextChannelListener *tcl = new TextChannelListener(m_account, ch, ctx);
+    if (!Benchmark::waitFor([ctx]() { return ctx->isFinished(); }, m_timeout) || ctx->isError()) {
+        qWarning() << "Channel" << path << "did not become ready";
+        delete tcl;
+        return Tp::TextChannelPtr();
+    }
+
+    connect(&tcl->eventModel(), SIGNAL(eventsCommitted(const QList<CommHistory::Event>&, bool)),
+            SLOT(eventsCommitted(const QList<CommHistory::Event>&, bool)));
+    m_listeners.append(tcl);
+    m_channels.append(Tp::TextChannelPtr::dynamicCast(ch));
+    return m_channels.last();
+}
+
+Tp::ReceivedMessage Bm_TextChannelListener::textMessage(const Tp::ContactPtr &sender, const QString &text)
+{
+    Tp::ReceivedMessage msg(Tp::MessagePartList() << Tp::MessagePart() << Tp::MessagePart());
+
+    addMsgHeader(msg, 0, "pending-message-id", pendingMessageId++);
+    addMsgHeader(msg, 0, "received", QDateTime::currentDateTime().toTime_t());
+    addMsgHeader(msg, 0, "message-type", (uint)Tp::ChannelTextMessageTypeNormal);
+    addMsgHeader(msg, 0, "message-token", QUuid::createUuid().toString());
+    addMsgHeader(msg, 1, "content-type", QStringLiteral("text/plain"));
+    addMsgHeader(msg, 1, "content", text);
+    msg.ut_setSender(sender);
+    return msg;
+}
+
+Tp::ReceivedMessage Bm_TextChannelListener::deliveryReport(const QString &token)
+{
+    Tp::ReceivedMessage msg(Tp::MessagePartList() << Tp::MessagePart());
+
+    uint timestamp = QDateTime::currentDateTime().toTime_t();
+    addMsgHeader(msg, 0, "pending-message-id", pendingMessageId++);
+    addMsgHeader(msg, 0, "received", timestamp);
+    addMsgHeader(msg, 0, "message-sent", timestamp);
+    addMsgHeader(msg, 0, "message-type", (uint)Tp::ChannelTextMessageTypeDeliveryReport);
+    addMsgHeader(msg, 0, "delivery-token", token);
+    addMsgHeader(msg, 0, "delivery-status", (uint)Tp::DeliveryStatusDelivered);
+    addMsgHeader(msg, 0, "message-token", QUuid::createUuid().toString());
+    return msg;
+}
+
+/*!
+ * All messages arrive back to back on one SMS channel.
+ */
+bool Bm_TextChannelListener::flood()
+{
+    const int messages = Benchmark::option(QStringLiteral("messages"), 10000);
+
+    setupAccount(SMS_ACCOUNT_PATH, true);
+    const QString number(QString(SMS_NUMBER).arg(1, 7, 10, QLatin1Char('0')));
+    Tp::TextChannelPtr ch(openChannel(number, false));
+    if (!ch)
+        return false;
+    Tp::ContactPtr sender(contact(m_nextHandle++, number));
+
+    Benchmark benchmark(QStringLiteral("textchannellistener/flood"));
+    benchmark.setParameter(QStringLiteral("messages"), messages);
+    m_benchmark = &benchmark;
+
+    for (int i = 0; i < messages; i++) {
+        Tp::ReceivedMessage msg(textMessage(sender, QStringLiteral("Flood message %1").arg(i)));
+        benchmark.begin(msg.messageToken());
+        ch->ut_receiveMessage(msg);
+    }
+
+    benchmark.wait(m_timeout);
+    m_benchmark = 0;
+    return benchmark.report();
+}
+
+/*!
+ * Sends messages and, once they are stored, delivers a report for
+ * every one of them at once. Only the reports are measured.
+ */
+bool Bm_TextChannelListener::deliveryReports()
+{
+    const int messages = Benchmark::option(QStringLiteral("messages"), 5000);
+
+    setupAccount(SMS_ACCOUNT_PATH, true);
+    Tp::TextChannelPtr ch(openChannel(QString(SMS_NUMBER).arg(1, 7, 10, QLatin1Char('0')), true));
+    if (!ch)
+        return false;
+
+    QStringList tokens;
+    {
+        Benchmark sending(QStringLiteral("textchannellistener/reports/sending"));
+        m_benchmark = &sending;
+        for (int i = 0; i < messages; i++) {
+            Tp::Message msg(QDateTime::currentDateTime().toTime_t(), (uint)Tp::ChannelTextMessageTypeNormal,
+                            QStringLiteral("Report message %1").arg(i));
+            const QString token(QUuid::createUuid().toString());
+            sending.begin(token);
+            ch->ut_sendMessage(msg, Tp::MessageSendingFlagReportDelivery, token);
+            tokens.append(token);
+        }
+        if (!sending.wait(m_timeout)) {
+            qWarning() << "Sent messages were not stored in time";
+            m_benchmark = 0;
+            return false;
+        }
+    }
+
+    Benchmark benchmark(QStringLiteral("textchannellistener/reports"));
+    benchmark.setParameter(QStringLiteral("messages"), messages);
+    m_benchmark = &benchmark;
+
+    foreach (const QString &token, tokens) {
+        benchmark.begin(token);
+        ch->ut_receiveMessage(deliveryReport(token));
+    }
+
+    benchmark.wait(m_timeout);
+    m_benchmark = 0;
+    return benchmark.report();
+}
+
+/*!
+ * Spreads the messages round robin over many open SMS channels.
+ */
+bool Bm_TextChannelListener::channels()
+{
+    const int messages = Benchmark::option(QStringLiteral("messages"), 10000);
+    const int channels = qMax(Benchmark::option(QStringLiteral("channels"), 100), 1);
+
+    setupAccount(SMS_ACCOUNT_PATH, true);
+    QList<Tp::ContactPtr> senders;
+    for (int i = 0; i < channels; i++) {
+        const QString number(QString(SMS_NUMBER).arg(i + 1, 7, 10, QLatin1Char('0')));
+        if (!openChannel(number, false))
+            return false;
+        senders.append(contact(m_nextHandle++, number));
+    }
+
+    Benchmark benchmark(QStringLiteral("textchannellistener/channels"));
+    benchmark.setParameter(QStringLiteral("messages"), messages);
+    benchmark.setParameter(QStringLiteral("channels"), channels);
+    m_benchmark = &benchmark;
+
+    for (int i = 0; i < messages; i++) {
+        const int channel = i % channels;
+        Tp::ReceivedMessage msg(textMessage(senders.at(channel), QStringLiteral("Channel message %1").arg(i)));
+        benchmark.begin(msg.messageToken());
+        m_channels.at(channel)->ut_receiveMessage(msg);
+    }
+
+    benchmark.wait(m_timeout);
+    m_benchmark = 0;
+    return benchmark.report();
+}
+
+/*!
+ * A single IM room with many members, each message from a random one.
+ */
+bool Bm_TextChannelListener::groupChat()
+{
+    const int messages = Benchmark::option(QStringLiteral("messages"), 5000);
+    const int memberCount = qMax(Benchmark::option(QStringLiteral("members"), 200), 1);
+
+    setupAccount(IM_ACCOUNT_PATH, false);
+    QList<Tp::ContactPtr> members;
+    for (int i = 0; i < memberCount; i++)
+        members.append(contact(m_nextHandle++, QString(IM_MEMBER).arg(i)));
+
+    Tp::TextChannelPtr ch(openChannel(IM_ROOM, false, Tp::Contacts::fromList(members)));
+    if (!ch)
+        return false;
+
+    Benchmark benchmark(QStringLiteral("textchannellistener/groupchat"));
+    benchmark.setParameter(QStringLiteral("messages"), messages);
+    benchmark.setParameter(QStringLiteral("members"), memberCount);
+    m_benchmark = &benchmark;
+
+    for (int i = 0; i < messages; i++) {
+        Tp::ReceivedMessage msg(textMessage(members.at(qrand() % memberCount),
+                                            QStringLiteral("Group message %1").arg(i)));
+        benchmark.begin(msg.messageToken());
+        ch->ut_receiveMessage(msg);
+    }
+
+    benchmark.wait(m_timeout);
+    m_benchmark = 0;
+    return benchmark.report();
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    qRegisterMetaType<Tp::PendingOperation*>("Tp::PendingOperation*");
+
+    InMemoryStorage storage;
+    setupBenchmarkStorage(storage);
+
+    Bm_TextChannelListener benchmark;
+    return benchmark.run(Benchmark::scenario(QStringLiteral("flood"))) ? 0 : 1;
+}
@@ -0,0 +1,82 @@
+/******************************************************************************
+**
+** This file is part of commhistory-daemon.
+**
+** Copyright (C) 2026 Jolla Ltd.
+**
+** This library is free software; you can redistribute it and/or modify it
+** under the terms of the GNU Lesser General Public License version 2.1 as
+** published by the Free Software Foundation.
+**
+** This library is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+** or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+** License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this library; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+**
+******************************************************************************/
+
+
+#ifndef BM_TEXTCHANNELLISTENER_H
+#define BM_TEXTCHANNELLISTENER_H
+
+#include <QObject>
+#include <QList>
+
+#include "TelepathyQt/Types"
+#include "TelepathyQt/Contact"
+#include "TelepathyQt/Message"
+
+#include <CommHistory/Event>
+
+namespace RTComLogger {
+
+class Benchmark;
+class TextChannelListener;
+
+/*!
+ * \class Bm_TextChannelListener
+ * \brief Drives TextChannelListener with synthetic loads on the Telepathy
+ * stubs. A message is done when its event has been committed.
+ */
+class Bm_TextChannelListener : public QObject
+{
+    Q_OBJECT
+
+public:
+    Bm_TextChannelListener();
+    ~Bm_TextChannelListener();
+
+    bool run(const QString &scenario);
+
+private Q_SLOTS:
+    void eventsCommitted(const QList<CommHistory::Event> &events, bool successful);
+
+private:
+    bool flood();
+    bool deliveryReports();
+    bool channels();
+    bool groupChat();
+
+    void setupAccount(const QString &accountPath, bool cellular);
+    Tp::TextChannelPtr openChannel(const QString &targetId, bool requested,
+                                   const Tp::Contacts &members = Tp::Contacts());
+
+    Tp::ReceivedMessage textMessage(const Tp::ContactPtr &sender, const QString &text);
+    Tp::ReceivedMessage deliveryReport(const QString &token);
+
+    Benchmark *m_benchmark;
+    int m_timeout;
+    uint m_nextHandle;
+    Tp::ConnectionPtr m_connection;
+    Tp::AccountPtr m_account;
+    QList<Tp::TextChannelPtr> m_channels;
+    QList<TextChannelListener*> m_listeners;
+};
+
+}
+
+#endif // BM_TEXTCHANNELLISTENER_H
@@ -21,7 +21,7 @@
 ###############################################################################
 
 TEMPLATE  = subdirs
-SUBDIRS   = src data tests translations
+SUBDIRS   = src data tests benchmarks translations
 OTHER_FILES += rpm/commhistory-daemon.spec
 
 # End of File
@@ -25,7 +25,6 @@
 
 #include <TelepathyQt/PendingReady>
 
-#include <CommHistory/GroupModel>
 #include <CommHistory/CallModel>
 #include "debug.h"
 
@@ -168,8 +167,8 @@ void AccountOperationsObserver::slotAccountRemoved()
         m_accountPathsForCalls.insert(accountPath, callModel);
 
         if (!m_pGroupModel) {
-            // Notification manager already has a group model so using that instead of creating a separate one:
-            m_pGroupModel = NotificationManager::instance()->groupModel();
+            // Notification manager already has a group cache so using that instead of loading the groups again:
+            m_pGroupModel = NotificationManager::instance()->groupCache();
         }
 
         if (m_pGroupModel && !m_pGroupModel->isReady()) {
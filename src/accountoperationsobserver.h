@@ -29,13 +29,14 @@
 
 namespace CommHistory
 {
-    class GroupModel;
     class CallModel;
     class Event;
 }
 
 namespace RTComLogger
 {
+class GroupCache;
+
 /**
 \class AccountOperationsObserver
 \brief Listens telepathy accounts being removed and when that happens, removes both
@@ -86,7 +87,7 @@ private Q_SLOTS:
      *
      * Adds path of the removed account into a list used when calling methods to
      * remove conversations and calls either a) directly or b) via signal from models
-     * indicating they are ready. Uses CommHistory::GroupModel from NotificationManager
+     * indicating they are ready. Uses the GroupCache from NotificationManager
      * and creates and populates CommHistory::CallModel by itself. Additionally removes
      * all notifications of the account.
      *
@@ -127,7 +128,7 @@ private:
     void connectToAccounts();
 
 private:
-    CommHistory::GroupModel *m_pGroupModel;
+    GroupCache *m_pGroupModel;
     Tp::AccountManagerPtr m_AccountManager;
     QList<QString> m_accountPathsForConvs; // Conversations of these account paths should be removed.
     QMap<QString,CommHistory::CallModel*> m_accountPathsForCalls; // Calls of these account paths should be removed.
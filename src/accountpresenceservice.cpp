@@ -31,6 +31,7 @@
 
 #include "accountpresenceservice.h"
 #include "constants.h"
+#include "dbuscallstats.h"
 #include "debug.h"
 
 #include <TelepathyQt/Account>
@@ -219,21 +220,28 @@ bool AccountPresenceService::presenceUpdate(Tp::AccountPtr account, const Tp::Pr
 bool AccountPresenceService::presenceUpdate(Tp::AccountPtr account, const Tp::Presence &presence, bool current)
 {
     Tp::PendingOperation *po = 0;
+    QString property;
 
     if (current) {
         po = account->setRequestedPresence(presence);
+        property = QStringLiteral("Set RequestedPresence");
     } else {
         if (presence.type() == Tp::ConnectionPresenceTypeOffline) {
             po = account->setConnectsAutomatically(false);
+            property = QStringLiteral("Set ConnectsAutomatically");
         } else {
             account->setConnectsAutomatically(true);
             po = account->setAutomaticPresence(presence);
+            property = QStringLiteral("Set AutomaticPresence");
         }
     }
 
     if (!po)
         return false;
 
+    if (!po->isFinished())
+        DBusCallStats::instance()->trackOperation(account->busName(), property, po);
+
     QString description(QString("set presence for account: %1").arg(account->displayName()));
 
     if (po->isFinished()) {
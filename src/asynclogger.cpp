@@ -0,0 +1,272 @@
+/******************************************************************************
+**
+** This file is part of commhistory-daemon.
+**
+** Copyright (C) 2026 Jolla Ltd.
+**
+** This library is free software; you can redistribute it and/or modify it
+** under the terms of the GNU Lesser General Public License version 2.1 as
+** published by the Free Software Foundation.
+**
+** This library is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+** or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+** License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this library; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+**
+******************************************************************************/
+
+
+#include "asynclogger.h"
+
+#include <QDateTime>
+
+#include <errno.h>
+#include <string.h>
+#include <syslog.h>
+#include <time.h>
+
+using namespace RTComLogger;
+
+// Must be a power of two
+#define RING_SIZE 1024
+// Longer messages are truncated
+#define PAYLOAD_SIZE 472
+
+struct AsyncLogger::Record {
+    // Equal to the enqueue position when free, position + 1 when filled
+    QAtomicInteger<quint32> sequence;
+    qint32 priority;
+    qint32 length;
+    qint64 timestampMs;     // CLOCK_MONOTONIC
+    char payload[PAYLOAD_SIZE];
+};
+
+static qint64 monotonicMs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return qint64(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+static const char *levelPrefix(int priority)
+{
+    switch (priority) {
+    case LOG_WARNING:
+        return "Warning: ";
+    case LOG_CRIT:
+        return "CRITICAL: ";
+    case LOG_ALERT:
+        return "FATAL: ";
+    default:
+        // don't use any prefix for debug messages
+        return "";
+    }
+}
+
+AsyncLogger* AsyncLogger::instance()
+{
+    static AsyncLogger* logger = 0;
+    if (!logger)
+        logger = new AsyncLogger;
+    return logger;
+}
+
+AsyncLogger::AsyncLogger()
+    : m_ring(new Record[RING_SIZE]),
+      m_enqueuePos(0),
+      m_dequeuePos(0),
+      m_dropped(0),
+      m_running(0),
+      m_stopping(0),
+      m_sleeping(0),
+      m_producers(0),
+      m_file(0),
+      m_wallOffsetMs(0)
+{
+    for (quint32 i = 0; i < RING_SIZE; i++)
+        m_ring[i].sequence.store(i);
+}
+
+AsyncLogger::~AsyncLogger()
+{
+    stop();
+    delete [] m_ring;
+}
+
+void AsyncLogger::start(const QString &filePath)
+{
+    QMutexLocker control(&m_controlMutex);
+    if (m_running.load())
+        return;
+
+    m_wallOffsetMs = QDateTime::currentMSecsSinceEpoch() - monotonicMs();
+
+    if (!filePath.isEmpty())
+        m_filePath = filePath;
+    if (!m_filePath.isEmpty()) {
+        QMutexLocker locker(&m_fileMutex);
+        m_file = fopen(m_filePath.toLocal8Bit().constData(), "a");
+        if (!m_file)
+            syslog(LOG_MAKEPRI(LOG_USER, LOG_WARNING), "Warning: cannot open log file %s: %s",
+                   m_filePath.toLocal8Bit().constData(), strerror(errno));
+    }
+
+    m_stopping.store(0);
+    m_sleeping.store(0);
+    m_running.store(1);
+    QThread::start(QThread::LowestPriority);
+}
+
+void AsyncLogger::stop()
+{
+    QMutexLocker control(&m_controlMutex);
+    if (!m_running.load())
+        return;
+
+    // log() writes synchronously from now on
+    m_stopping.fetchAndStoreOrdered(1);
+    wake();
+    wait();
+
+    // Producers that got past the check before it are still pushing
+    while (m_producers.loadAcquire())
+        QThread::yieldCurrentThread();
+    m_running.store(0);
+
+    // Anything logged while the thread was stopping
+    drain();
+
+    QMutexLocker locker(&m_fileMutex);
+    if (m_file) {
+        fclose(m_file);
+        m_file = 0;
+    }
+}
+
+void AsyncLogger::log(int priority, const QByteArray &message)
+{
+    m_producers.fetchAndAddOrdered(1);
+    if (!m_running.loadAcquire() || m_stopping.loadAcquire()) {
+        m_producers.fetchAndAddOrdered(-1);
+        write(priority, monotonicMs(), message.constData(), message.size());
+        return;
+    }
+
+    if (!push(priority, message))
+        m_dropped.fetchAndAddRelaxed(1);
+    m_producers.fetchAndAddOrdered(-1);
+    wake();
+}
+
+void AsyncLogger::wake()
+{
+    // Only the producer that finds the drain thread asleep signals it
+    if (m_sleeping.testAndSetOrdered(1, 0))
+        m_wakeup.release();
+}
+
+bool AsyncLogger::hasPending() const
+{
+    const Record *record = &m_ring[m_dequeuePos & (RING_SIZE - 1)];
+    return record->sequence.loadAcquire() == m_dequeuePos + 1 || m_dropped.loadAcquire();
+}
+
+bool AsyncLogger::push(int priority, const QByteArray &message)
+{
+    Record *record;
+    quint32 pos = m_enqueuePos.loadAcquire();
+    for (;;) {
+        record = &m_ring[pos & (RING_SIZE - 1)];
+        const qint32 diff = qint32(record->sequence.loadAcquire() - pos);
+        if (diff == 0) {
+            // Free slot, claim it unless another producer got there first
+            if (m_enqueuePos.testAndSetRelaxed(pos, pos + 1))
+                break;
+            pos = m_enqueuePos.loadAcquire();
+        } else if (diff < 0) {
+            // Not yet drained, the ring is full
+            return false;
+        } else {
+            pos = m_enqueuePos.loadAcquire();
+        }
+    }
+
+    record->priority = priority;
+    record->timestampMs = monotonicMs();
+    record->length = qMin(message.size(), PAYLOAD_SIZE);
+    memcpy(record->payload, message.constData(), record->length);
+    record->sequence.storeRelease(pos + 1);
+    return true;
+}
+
+int AsyncLogger::drain()
+{
+    int count = 0;
+    for (;;) {
+        Record *record = &m_ring[m_dequeuePos & (RING_SIZE - 1)];
+        if (record->sequence.loadAcquire() != m_dequeuePos + 1)
+            break;
+
+        write(record->priority, record->timestampMs, record->payload, record->length);
+        record->sequence.storeRelease(m_dequeuePos + RING_SIZE);
+        m_dequeuePos++;
+        count++;
+    }
+
+    const quint32 dropped = m_dropped.fetchAndStoreRelaxed(0);
+    if (dropped) {
+        QByteArray message("Log ring full, dropped " + QByteArray::number(dropped) + " message(s)");
+        write(LOG_WARNING, monotonicMs(), message.constData(), message.size());
+    }
+
+    if (count) {
+        QMutexLocker locker(&m_fileMutex);
+        if (m_file)
+            fflush(m_file);
+    }
+    return count;
+}
+
+void AsyncLogger::write(int priority, qint64 timestampMs, const char *message, int length)
+{
+    const qint64 wallMs = (m_wallOffsetMs ? m_wallOffsetMs + timestampMs
+                                          : QDateTime::currentMSecsSinceEpoch());
+    const int seconds = (wallMs / 1000) % 60;
+    const int millis = wallMs % 1000;
+
+    QMutexLocker locker(&m_fileMutex);
+    if (m_file) {
+        fprintf(m_file, "%s [%02d:%03d] %.*s\n", levelPrefix(priority), seconds, millis, length, message);
+    } else {
+        syslog(LOG_MAKEPRI(LOG_USER, priority),
+               "%s [%02d:%03d] %.*s",
+               levelPrefix(priority),
+               seconds,
+               millis,
+               length,
+               message);
+    }
+}
+
+void AsyncLogger::run()
+{
+    for (;;) {
+        drain();
+        if (m_stopping.loadAcquire())
+            break;
+
+        m_sleeping.fetchAndStoreOrdered(1);
+        // Records pushed before the flag was set don't signal
+        if (hasPending() || m_stopping.loadAcquire()) {
+            if (m_sleeping.testAndSetOrdered(1, 0))
+                continue;
+            // A producer cleared the flag and released meanwhile
+        }
+        m_wakeup.acquire();
+    }
+    drain();
+}
@@ -0,0 +1,114 @@
+/******************************************************************************
+**
+** This file is part of commhistory-daemon.
+**
+** Copyright (C) 2026 Jolla Ltd.
+**
+** This library is free software; you can redistribute it and/or modify it
+** under the terms of the GNU Lesser General Public License version 2.1 as
+** published by the Free Software Foundation.
+**
+** This library is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+** or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+** License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this library; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+**
+******************************************************************************/
+
+
+#ifndef ASYNCLOGGER_H
+#define ASYNCLOGGER_H
+
+#include <QAtomicInteger>
+#include <QByteArray>
+#include <QMutex>
+#include <QSemaphore>
+#include <QThread>
+
+#include <stdio.h>
+
+namespace RTComLogger
+{
+
+/*!
+ * \class AsyncLogger
+ * \brief Moves formatting and writing of log messages off the threads
+ * that log them.
+ *
+ * log() copies the message into a fixed size slot of a bounded
+ * multi-producer ring and returns; it never blocks. A drain thread
+ * writes the records to syslog, or to a file if one was given to
+ * start(). The drain thread sleeps on a semaphore while the ring is
+ * empty, and only the first record after that signals it. When the ring is full new records are dropped and
+ * the number of dropped records is logged once there is room again.
+ *
+ * Until start() and after stop() messages are written synchronously.
+ */
+class AsyncLogger : public QThread
+{
+    Q_OBJECT
+
+public:
+    static AsyncLogger* instance();
+
+    /*!
+     * \brief Starts the drain thread. Records go to syslog if \a filePath
+     * is empty or can't be opened. A restart without \a filePath reopens
+     * the file of an earlier start().
+     */
+    void start(const QString &filePath = QString());
+
+    /*!
+     * \brief Writes out everything queued and stops the drain thread.
+     */
+    void stop();
+
+    /*!
+     * \brief Queues \a message with syslog \a priority.
+     */
+    void log(int priority, const QByteArray &message);
+
+protected:
+    void run();
+
+private:
+    AsyncLogger();
+    ~AsyncLogger();
+
+    struct Record;
+
+    bool push(int priority, const QByteArray &message);
+    bool hasPending() const;
+    void wake();
+    int drain();
+    void write(int priority, qint64 timestampMs, const char *message, int length);
+
+    Record *m_ring;
+    QAtomicInteger<quint32> m_enqueuePos;
+    quint32 m_dequeuePos;
+    QAtomicInteger<quint32> m_dropped;
+    QAtomicInt m_running;
+    QAtomicInt m_stopping;
+    // Set while the drain thread waits for m_wakeup
+    QAtomicInt m_sleeping;
+    QSemaphore m_wakeup;
+    // log() calls between the running check and the end of push()
+    QAtomicInt m_producers;
+    // Serialises start() and stop(), a fatal message stops the logger
+    // from whichever thread it was logged on
+    QMutex m_controlMutex;
+    // Guards m_file, synchronous writes of other threads can race with
+    // stop() closing it
+    QMutex m_fileMutex;
+    FILE *m_file;
+    QString m_filePath;
+    qint64 m_wallOffsetMs;
+};
+
+} // namespace RTComLogger
+
+#endif // ASYNCLOGGER_H
@@ -0,0 +1,173 @@
+/******************************************************************************
+**
+** This file is part of commhistory-daemon.
+**
+** Copyright (C) 2026 Jolla Ltd.
+**
+** This library is free software; you can redistribute it and/or modify it
+** under the terms of the GNU Lesser General Public License version 2.1 as
+** published by the Free Software Foundation.
+**
+** This library is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+** or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+** License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this library; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+**
+******************************************************************************/
+
+#include "calljournal.h"
+#include "debug.h"
+
+#include <CommHistory/EventModel>
+#include <CommHistory/DatabaseIO>
+#include <CommHistory/Event>
+
+#include <QFile>
+#include <QStandardPaths>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define DEBUG_(x) qCDebug(lcCall) << "CallJournal:" << x
+
+using namespace RTComLogger;
+using namespace CommHistory;
+
+// More than the number of simultaneous calls we ever expect
+#define JOURNAL_SLOTS 8
+
+struct CallJournal::Header {
+    char magic[4];          // "CJR1"
+    quint32 slots;
+};
+
+struct CallJournal::Entry {
+    qint32 eventId;         // 0 if the slot is free
+    quint32 reserved;
+    qint64 endTime;         // ms since the epoch
+};
+
+CallJournal* CallJournal::instance()
+{
+    static CallJournal* journal = 0;
+    if (!journal)
+        journal = new CallJournal;
+    return journal;
+}
+
+CallJournal::CallJournal()
+    : m_map(0), m_size(sizeof(Header) + JOURNAL_SLOTS * sizeof(Entry))
+{
+    m_path = QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + "/commhistoryd-call-journal";
+
+    QByteArray path(QFile::encodeName(m_path));
+    int fd = open(path.constData(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        qWarning() << "Cannot open call journal:" << strerror(errno);
+        return;
+    }
+
+    if (ftruncate(fd, m_size) < 0) {
+        qWarning() << "Cannot resize call journal:" << strerror(errno);
+        close(fd);
+        return;
+    }
+
+    void *map = mmap(NULL, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        qWarning() << "Cannot map call journal:" << strerror(errno);
+        return;
+    }
+
+    m_map = static_cast<Header*>(map);
+    if (memcmp(m_map->magic, "CJR1", 4) || m_map->slots != JOURNAL_SLOTS) {
+        memset(map, 0, m_size);
+        m_map->slots = JOURNAL_SLOTS;
+        memcpy(m_map->magic, "CJR1", 4);
+    }
+}
+
+CallJournal::~CallJournal()
+{
+    if (m_map)
+        munmap(m_map, m_size);
+}
+
+CallJournal::Entry* CallJournal::entry(int slot) const
+{
+    if (!m_map || slot < 0 || slot >= JOURNAL_SLOTS)
+        return 0;
+    return reinterpret_cast<Entry*>(m_map + 1) + slot;
+}
+
+int CallJournal::begin(int eventId, const QDateTime &endTime)
+{
+    if (!m_map || eventId <= 0)
+        return -1;
+
+    for (int i = 0; i < JOURNAL_SLOTS; i++) {
+        Entry *e = entry(i);
+        if (!e->eventId) {
+            e->endTime = endTime.toMSecsSinceEpoch();
+            e->eventId = eventId;
+            msync(m_map, m_size, MS_ASYNC);
+            DEBUG_("tracking event" << eventId << "in slot" << i);
+            return i;
+        }
+    }
+
+    qWarning() << "Call journal full, not tracking event" << eventId;
+    return -1;
+}
+
+void CallJournal::update(int slot, const QDateTime &endTime)
+{
+    Entry *e = entry(slot);
+    if (e && e->eventId) {
+        e->endTime = endTime.toMSecsSinceEpoch();
+        msync(m_map, m_size, MS_ASYNC);
+    }
+}
+
+void CallJournal::end(int slot)
+{
+    Entry *e = entry(slot);
+    if (e) {
+        e->eventId = 0;
+        msync(m_map, m_size, MS_ASYNC);
+    }
+}
+
+void CallJournal::replay()
+{
+    if (!m_map)
+        return;
+
+    EventModel model;
+    for (int i = 0; i < JOURNAL_SLOTS; i++) {
+        Entry *e = entry(i);
+        if (!e->eventId)
+            continue;
+
+        Event event;
+        QDateTime endTime(QDateTime::fromMSecsSinceEpoch(e->endTime));
+        if (!model.databaseIO().getEvent(e->eventId, event)) {
+            DEBUG_("event" << e->eventId << "is gone");
+        } else if (event.type() == Event::CallEvent && endTime > event.endTime()) {
+            DEBUG_("restoring end time of event" << e->eventId << "to" << endTime);
+            event.setEndTime(endTime);
+            if (!model.modifyEvent(event))
+                qWarning() << "Failed to restore call end time for event" << e->eventId;
+        }
+        e->eventId = 0;
+    }
+    msync(m_map, m_size, MS_ASYNC);
+}
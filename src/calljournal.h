@@ -0,0 +1,77 @@
+/******************************************************************************
+**
+** This file is part of commhistory-daemon.
+**
+** Copyright (C) 2026 Jolla Ltd.
+**
+** This library is free software; you can redistribute it and/or modify it
+** under the terms of the GNU Lesser General Public License version 2.1 as
+** published by the Free Software Foundation.
+**
+** This library is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+** or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+** License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this library; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+**
+******************************************************************************/
+
+#ifndef CALLJOURNAL_H
+#define CALLJOURNAL_H
+
+#include <QDateTime>
+#include <QString>
+
+namespace RTComLogger
+{
+
+/*!
+ * \class CallJournal
+ * \brief Keeps the end time of ongoing calls in a small memory mapped
+ * file, so the call log only needs to be written when a call starts and
+ * when it ends.
+ *
+ * Updating an entry is a plain memory write. Entries left behind by a
+ * daemon that died mid-call are written into the database by replay()
+ * at the next start.
+ */
+class CallJournal
+{
+public:
+    static CallJournal* instance();
+
+    /*!
+     * \brief Starts tracking call event \a eventId.
+     * \return Slot to pass to update() and end(), or -1 if the journal
+     * is not available or full.
+     */
+    int begin(int eventId, const QDateTime &endTime);
+    void update(int slot, const QDateTime &endTime);
+    void end(int slot);
+
+    /*!
+     * \brief Writes the end times of interrupted calls into the call log
+     * and empties the journal.
+     */
+    void replay();
+
+private:
+    CallJournal();
+    ~CallJournal();
+
+    struct Header;
+    struct Entry;
+
+    Entry* entry(int slot) const;
+
+    QString m_path;
+    Header *m_map;
+    size_t m_size;
+};
+
+} // namespace RTComLogger
+
+#endif // CALLJOURNAL_H
@@ -21,6 +21,7 @@
 ******************************************************************************/
 
 #include "channellistener.h"
+#include "eventmodelpool.h"
 #include "constants.h"
 #include "debug.h"
 
@@ -99,6 +100,8 @@ void ChannelListener::finishedWithError(const QString& errorName,
 
 ChannelListener::~ChannelListener()
 {
+    if (m_pEventModel)
+        EventModelPool::release(m_pEventModel, this);
 }
 
 QString ChannelListener::channel() const
@@ -147,7 +150,7 @@ void ChannelListener::invocationContextError()
 CommHistory::EventModel& ChannelListener::eventModel()
 {
     if(!m_pEventModel){
-        m_pEventModel = new CommHistory::EventModel(this);
+        m_pEventModel = EventModelPool::acquire();
     }
 
     return *m_pEventModel;
@@ -63,3 +63,27 @@ void CommHistoryIfAdaptor::setObservedConversations(const QVariantList &conversa
     QMetaObject::invokeMethod(parent(), "setObservedConversations", Q_ARG(QVariantList, conversations));
 }
 
+bool CommHistoryIfAdaptor::setLogLevel(const QString &category, const QString &level)
+{
+    // handle method call org.nemomobile.CommHistoryIf.setLogLevel
+    bool ok = false;
+    QMetaObject::invokeMethod(parent(), "setLogLevel", Q_RETURN_ARG(bool, ok), Q_ARG(QString, category), Q_ARG(QString, level));
+    return ok;
+}
+
+QString CommHistoryIfAdaptor::dumpMessageTrace()
+{
+    // handle method call org.nemomobile.CommHistoryIf.dumpMessageTrace
+    QString trace;
+    QMetaObject::invokeMethod(parent(), "dumpMessageTrace", Q_RETURN_ARG(QString, trace));
+    return trace;
+}
+
+QVariantMap CommHistoryIfAdaptor::getStatistics()
+{
+    // handle method call org.nemomobile.CommHistoryIf.getStatistics
+    QVariantMap statistics;
+    QMetaObject::invokeMethod(parent(), "getStatistics", Q_RETURN_ARG(QVariantMap, statistics));
+    return statistics;
+}
+
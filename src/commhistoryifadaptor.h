@@ -49,6 +49,18 @@ class CommHistoryIfAdaptor: public QDBusAbstractAdaptor
 "    <method name=\"setCallHistoryObserved\">\n"
 "      <arg type=\"b\" name=\"observed\"/>\n"
 "    </method>\n"
+"    <method name=\"setLogLevel\">\n"
+"      <arg direction=\"in\" type=\"s\" name=\"category\"/>\n"
+"      <arg direction=\"in\" type=\"s\" name=\"level\"/>\n"
+"      <arg direction=\"out\" type=\"b\" name=\"ok\"/>\n"
+"    </method>\n"
+"    <method name=\"dumpMessageTrace\">\n"
+"      <arg direction=\"out\" type=\"s\" name=\"trace\"/>\n"
+"    </method>\n"
+"    <method name=\"getStatistics\">\n"
+"      <arg direction=\"out\" type=\"a{sv}\" name=\"statistics\"/>\n"
+"      <annotation value=\"QVariantMap\" name=\"org.qtproject.QtDBus.QtTypeName.Out0\"/>\n"
+"    </method>\n"
 "  </interface>\n"
         "")
 public:
@@ -62,6 +74,9 @@ public Q_SLOTS: // METHODS
     void setInboxObserved(bool observed, const QString &filterAccount);
     void setInboxObserved(bool observed);
     void setObservedConversations(const QVariantList &conversations);
+    bool setLogLevel(const QString &category, const QString &level);
+    QString dumpMessageTrace();
+    QVariantMap getStatistics();
 Q_SIGNALS: // SIGNALS
 };
 
@@ -25,6 +25,11 @@
 #include <QCoreApplication>
 #include "commhistoryservice.h"
 #include "constants.h"
+#include "asynclogger.h"
+#include "messagetracer.h"
+#include "metrics.h"
+#include "trafficrecorder.h"
+#include "debug.h"
 
 CommHistoryService *CommHistoryService::instance()
 {
@@ -76,6 +81,32 @@ void CommHistoryService::activateAuthorization(const QString& contactId,
                                   transactionId, accountUniqueIdentifier);
 }
 
+bool CommHistoryService::setLogLevel(const QString &category, const QString &level)
+{
+    if (!RTComLogger::setLogLevel(category, level)) {
+        qWarning() << "Unknown log category or level:" << category << level;
+        return false;
+    }
+
+    // Keep logging off the calling threads once anything is enabled,
+    // and don't keep the drain thread around when nothing is
+    if (level != QLatin1String("off"))
+        RTComLogger::AsyncLogger::instance()->start();
+    else if (RTComLogger::isLoggingOff())
+        RTComLogger::AsyncLogger::instance()->stop();
+    return true;
+}
+
+QString CommHistoryService::dumpMessageTrace()
+{
+    return QString::fromUtf8(RTComLogger::MessageTracer::instance()->chromeTrace());
+}
+
+QVariantMap CommHistoryService::getStatistics()
+{
+    return RTComLogger::Metrics::instance()->statistics();
+}
+
 void CommHistoryService::setCallHistoryObserved(bool observed)
 {
     if (observed != m_callHistoryObserved) {
@@ -86,6 +117,9 @@ void CommHistoryService::setCallHistoryObserved(bool observed)
 
 void CommHistoryService::setInboxObserved(bool observed, const QString &filterAccount)
 {
+    RTComLogger::TrafficRecorder::instance()->record(RTComLogger::TrafficRecorder::InboxObservedChanged,
+                                                     QVariantList() << observed << filterAccount);
+
     if (observed != m_inboxObserved || filterAccount != m_inboxFilterAccount) {
         m_inboxObserved = observed;
         m_inboxFilterAccount = filterAccount;
@@ -115,6 +149,17 @@ void CommHistoryService::setObservedConversations(const QVariantList &arg)
         }
     }
 
+    RTComLogger::TrafficRecorder *recorder = RTComLogger::TrafficRecorder::instance();
+    if (recorder->isRecording()) {
+        QVariantList recorded;
+        foreach (const Conversation &conversation, conversations) {
+            recorded.append(QVariant(QVariantList() << conversation.first.localUid()
+                                                    << conversation.first.remoteUid()
+                                                    << conversation.second));
+        }
+        recorder->record(RTComLogger::TrafficRecorder::ObservedConversationsChanged, recorded);
+    }
+
     m_observedConversations = conversations;
     emit observedConversationsChanged(m_observedConversations);
 }
@@ -56,6 +56,12 @@ public Q_SLOTS:
     void setCallHistoryObserved(bool observed);
     void setInboxObserved(bool observed, const QString &filterAccount = QString());
     void setObservedConversations(const QVariantList &conversations);
+    /*! \brief Changes the log level of a category without restarting, see RTComLogger::setLogLevel */
+    bool setLogLevel(const QString &category, const QString &level);
+    /*! \brief Returns the recent message lifecycle trace as Chrome trace event JSON */
+    QString dumpMessageTrace();
+    /*! \brief Returns counters, latency histograms and per component statistics */
+    QVariantMap getStatistics();
 
 Q_SIGNALS:
     void showAuthorizationDialog(const QString& contactId,
@@ -0,0 +1,195 @@
+/******************************************************************************
+**
+** This file is part of commhistory-daemon.
+**
+** Copyright (C) 2026 Jolla Ltd.
+**
+** This library is free software; you can redistribute it and/or modify it
+** under the terms of the GNU Lesser General Public License version 2.1 as
+** published by the Free Software Foundation.
+**
+** This library is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+** or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+** License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this library; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+**
+******************************************************************************/
+
+#include "databasereader.h"
+#include "debug.h"
+
+#include <CommHistory/commhistorydatabasepath.h>
+#include <CommHistory/event.h>
+#include <CommHistory/mmsconstants.h>
+#include <CommHistory/recipient.h>
+
+#include <QFile>
+#include <QSqlError>
+#include <QSqlQuery>
+
+#define DEBUG_(x) qCDebug(lcDaemon) << "DatabaseReader:" << x
+
+// SQLITE_MAX_VARIABLE_NUMBER defaults to 999
+static const int kMaxQueryParameters = 500;
+
+DatabaseReader::DatabaseReader(const QString &connectionName) :
+    m_connectionName(connectionName)
+{
+    const QString path(CommHistoryDatabasePath::databaseFile());
+    if (!QFile::exists(path)) {
+        qWarning() << "DatabaseReader: no database at" << path;
+        return;
+    }
+
+    m_database = QSqlDatabase::addDatabase(QLatin1String("QSQLITE"), m_connectionName);
+    m_database.setDatabaseName(path);
+    m_database.setConnectOptions(QLatin1String("QSQLITE_OPEN_READONLY;QSQLITE_BUSY_TIMEOUT=1000"));
+    if (!m_database.open()) {
+        qWarning() << "DatabaseReader: failed to open" << path << m_database.lastError();
+    }
+}
+
+DatabaseReader::~DatabaseReader()
+{
+    if (m_database.isValid()) {
+        m_database.close();
+        m_database = QSqlDatabase();
+        QSqlDatabase::removeDatabase(m_connectionName);
+    }
+}
+
+QString DatabaseReader::placeholders(int count)
+{
+    QString result(QLatin1Char('?'));
+    result.reserve(count * 2);
+    for (int i = 1; i < count; i++)
+        result.append(QLatin1String(",?"));
+    return result;
+}
+
+bool DatabaseReader::isOpen() const
+{
+    return m_database.isOpen();
+}
+
+bool DatabaseReader::mmsIds(QStringList &result)
+{
+    if (!isOpen())
+        return false;
+
+    QSqlQuery query(m_database);
+    query.setForwardOnly(true);
+    query.prepare(QLatin1String("SELECT mmsId FROM Events WHERE type = :type AND mmsId != ''"));
+    query.bindValue(QLatin1String(":type"), (int)CommHistory::Event::MMSEvent);
+    if (!query.exec()) {
+        qWarning() << "DatabaseReader: MMS id query failed" << query.lastError();
+        return false;
+    }
+
+    while (query.next())
+        result.append(query.value(0).toString());
+
+    DEBUG_(result.count() << "MMS id(s) found");
+    return true;
+}
+
+bool DatabaseReader::eventGroups(const QList<int> &ids, QHash<int, int> &result)
+{
+    if (!isOpen())
+        return false;
+
+    for (int start = 0; start < ids.count(); start += kMaxQueryParameters) {
+        const int count = qMin(kMaxQueryParameters, ids.count() - start);
+        QSqlQuery query(m_database);
+        query.setForwardOnly(true);
+        query.prepare(QLatin1String("SELECT id, groupId FROM Events WHERE id IN (") + placeholders(count) + QLatin1Char(')'));
+        for (int i = 0; i < count; i++)
+            query.addBindValue(ids.at(start + i));
+        if (!query.exec()) {
+            qWarning() << "DatabaseReader: event id query failed" << query.lastError();
+            return false;
+        }
+
+        while (query.next())
+            result.insert(query.value(0).toInt(), query.value(1).toInt());
+    }
+
+    DEBUG_(result.count() << "of" << ids.count() << "event(s) exist");
+    return true;
+}
+
+bool DatabaseReader::existingMessageTokens(const QStringList &tokens, QSet<QString> &result)
+{
+    if (!isOpen())
+        return false;
+
+    for (int start = 0; start < tokens.count(); start += kMaxQueryParameters) {
+        const int count = qMin(kMaxQueryParameters, tokens.count() - start);
+        QSqlQuery query(m_database);
+        query.setForwardOnly(true);
+        query.prepare(QLatin1String("SELECT messageToken FROM Events WHERE messageToken IN (") + placeholders(count) + QLatin1Char(')'));
+        for (int i = 0; i < count; i++)
+            query.addBindValue(tokens.at(start + i));
+        if (!query.exec()) {
+            qWarning() << "DatabaseReader: message token query failed" << query.lastError();
+            return false;
+        }
+
+        while (query.next())
+            result.insert(query.value(0).toString());
+    }
+
+    DEBUG_(result.count() << "of" << tokens.count() << "message token(s) exist");
+    return true;
+}
+
+bool DatabaseReader::readReportEvents(const QList<int> &groupIds, QList<CommHistory::Event> &result)
+{
+    if (!isOpen())
+        return false;
+
+    const int found = result.count();
+    for (int start = 0; start < groupIds.count(); start += kMaxQueryParameters) {
+        const int count = qMin(kMaxQueryParameters, groupIds.count() - start);
+        QSqlQuery query(m_database);
+        query.setForwardOnly(true);
+        // Same filter as MmsReadReportModel
+        query.prepare(QLatin1String("SELECT Events.id, Events.groupId, Events.localUid, Events.remoteUid, "
+                                    "Events.mmsId, Events.subscriberIdentity FROM Events "
+                                    "JOIN EventProperties ON EventProperties.eventId = Events.id AND EventProperties.key = ? "
+                                    "WHERE Events.type = ? AND Events.direction = ? AND Events.isRead = 1 "
+                                    "AND Events.groupId IN (") + placeholders(count) +
+                      QLatin1String(") GROUP BY Events.id"));
+        query.addBindValue(QLatin1String(MMS_PROPERTY_UNREAD));
+        query.addBindValue((int)CommHistory::Event::MMSEvent);
+        query.addBindValue((int)CommHistory::Event::Inbound);
+        for (int i = 0; i < count; i++)
+            query.addBindValue(groupIds.at(start + i));
+        if (!query.exec()) {
+            qWarning() << "DatabaseReader: read report query failed" << query.lastError();
+            return false;
+        }
+
+        while (query.next()) {
+            CommHistory::Event event;
+            event.setId(query.value(0).toInt());
+            event.setGroupId(query.value(1).toInt());
+            event.setType(CommHistory::Event::MMSEvent);
+            event.setDirection(CommHistory::Event::Inbound);
+            event.setIsRead(true);
+            event.setLocalUid(query.value(2).toString());
+            event.setRecipients(CommHistory::Recipient(query.value(2).toString(), query.value(3).toString()));
+            event.setMmsId(query.value(4).toString());
+            event.setSubscriberIdentity(query.value(5).toString());
+            event.setExtraProperty(QLatin1String(MMS_PROPERTY_UNREAD), true);
+            result.append(event);
+        }
+    }
+
+    DEBUG_(result.count() - found << "MMS event(s) in" << groupIds.count() << "group(s) need a read report");
+    return true;
+}
@@ -0,0 +1,86 @@
+/******************************************************************************
+**
+** This file is part of commhistory-daemon.
+**
+** Copyright (C) 2026 Jolla Ltd.
+**
+** This library is free software; you can redistribute it and/or modify it
+** under the terms of the GNU Lesser General Public License version 2.1 as
+** published by the Free Software Foundation.
+**
+** This library is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+** or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+** License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this library; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+**
+******************************************************************************/
+
+#ifndef DATABASEREADER_H
+#define DATABASEREADER_H
+
+#include <QList>
+#include <QHash>
+#include <QSet>
+#include <QSqlDatabase>
+#include <QStringList>
+
+namespace CommHistory {
+    class Event;
+}
+
+/*!
+ * \class DatabaseReader
+ * \brief Read-only access to the commhistory database for bulk lookups
+ * which libcommhistory can only do one record at a time.
+ *
+ * Each instance owns a separate SQLite connection and must only be used
+ * from the thread that created it. The queries only read columns that
+ * libcommhistory exposes through Event. All writes still go through
+ * libcommhistory models.
+ */
+class DatabaseReader
+{
+public:
+    explicit DatabaseReader(const QString &connectionName);
+    ~DatabaseReader();
+
+    bool isOpen() const;
+
+    /*!
+     * \brief Collects all non-empty MMS ids, i.e. content locations of
+     * pending notifications and Message-IDs of sent messages.
+     */
+    bool mmsIds(QStringList &result);
+
+    /*!
+     * \brief Maps those of \a ids which still have an event to their
+     * group ids in \a result. The ids are looked up in chunks to stay
+     * below the SQLite host parameter limit.
+     */
+    bool eventGroups(const QList<int> &ids, QHash<int, int> &result);
+
+    /*!
+     * \brief Adds those of \a tokens which are the message token of
+     * some event to \a result.
+     */
+    bool existingMessageTokens(const QStringList &tokens, QSet<QString> &result);
+
+    /*!
+     * \brief Appends the read inbound MMS in \a groupIds which still
+     * have a read report pending to \a result. Only the fields needed
+     * for the read report are set.
+     */
+    bool readReportEvents(const QList<int> &groupIds, QList<CommHistory::Event> &result);
+
+private:
+    static QString placeholders(int count);
+
+    QString m_connectionName;
+    QSqlDatabase m_database;
+};
+
+#endif // DATABASEREADER_H
@@ -0,0 +1,155 @@
+/******************************************************************************
+**
+** This file is part of commhistory-daemon.
+**
+** Copyright (C) 2026 Jolla Ltd.
+**
+** This library is free software; you can redistribute it and/or modify it
+** under the terms of the GNU Lesser General Public License version 2.1 as
+** published by the Free Software Foundation.
+**
+** This library is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+** or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+** License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this library; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+**
+******************************************************************************/
+
+
+#include "dbuscallstats.h"
+#include "debug.h"
+
+#include <QCoreApplication>
+#include <QDBusPendingCallWatcher>
+#include <QThread>
+
+#include <TelepathyQt/PendingOperation>
+
+using namespace RTComLogger;
+
+static const char *kPropertyKey = "dbus-call-key";
+static const char *kPropertyStarted = "dbus-call-started";
+
+DBusCallStats* DBusCallStats::instance()
+{
+    static DBusCallStats* stats = 0;
+    if (!stats) {
+        stats = new DBusCallStats(QCoreApplication::instance());
+        Metrics::instance()->addSource(QStringLiteral("dbusCalls"), []() {
+            return DBusCallStats::instance()->statistics();
+        });
+    }
+    return stats;
+}
+
+DBusCallStats::DBusCallStats(QObject *parent)
+    : QObject(parent)
+{
+    m_clock.start();
+}
+
+DBusCallStats::Entry &DBusCallStats::begin(const QString &key)
+{
+    Entry &entry(m_entries[key]);
+    entry.calls++;
+    return entry;
+}
+
+QDBusPendingCall DBusCallStats::track(const QString &destination, const QString &method,
+                                      const QDBusPendingCall &call)
+{
+    const QString key(destination + QLatin1Char(' ') + method);
+    Entry &entry(begin(key));
+    entry.inFlight++;
+    entry.maxInFlight = qMax(entry.maxInFlight, entry.inFlight);
+
+    // A watcher of our own, the caller may or may not watch the call too
+    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(call, this);
+    watcher->setProperty(kPropertyKey, key);
+    watcher->setProperty(kPropertyStarted, m_clock.nsecsElapsed());
+    connect(watcher, SIGNAL(finished(QDBusPendingCallWatcher*)), SLOT(onCallFinished(QDBusPendingCallWatcher*)));
+    return call;
+}
+
+void DBusCallStats::trackOperation(const QString &destination, const QString &method, QObject *operation)
+{
+    const QString key(destination + QLatin1Char(' ') + method);
+    Entry &entry(begin(key));
+    entry.inFlight++;
+    entry.maxInFlight = qMax(entry.maxInFlight, entry.inFlight);
+
+    operation->setProperty(kPropertyKey, key);
+    operation->setProperty(kPropertyStarted, m_clock.nsecsElapsed());
+    connect(operation, SIGNAL(finished(Tp::PendingOperation*)), SLOT(onOperationFinished()));
+}
+
+void DBusCallStats::count(const QString &destination, const QString &method)
+{
+    begin(destination + QLatin1Char(' ') + method);
+}
+
+void DBusCallStats::finish(QObject *tracker, bool error)
+{
+    QHash<QString, Entry>::iterator it = m_entries.find(tracker->property(kPropertyKey).toString());
+    if (it == m_entries.end())
+        return;
+
+    it->inFlight--;
+    if (error)
+        it->errors++;
+    it->latency.record((m_clock.nsecsElapsed() - tracker->property(kPropertyStarted).toLongLong()) / 1000);
+}
+
+void DBusCallStats::onCallFinished(QDBusPendingCallWatcher *watcher)
+{
+    finish(watcher, watcher->isError());
+    watcher->deleteLater();
+}
+
+void DBusCallStats::onOperationFinished()
+{
+    Tp::PendingOperation *operation = qobject_cast<Tp::PendingOperation*>(sender());
+    if (operation)
+        finish(operation, operation->isError());
+}
+
+QVariantMap DBusCallStats::statistics() const
+{
+    QVariantMap result;
+    for (QHash<QString, Entry>::const_iterator it = m_entries.constBegin(); it != m_entries.constEnd(); ++it) {
+        QVariantMap entry;
+        entry.insert(QStringLiteral("calls"), it->calls);
+        entry.insert(QStringLiteral("inFlight"), it->inFlight);
+        entry.insert(QStringLiteral("maxInFlight"), it->maxInFlight);
+        entry.insert(QStringLiteral("errors"), it->errors);
+        entry.insert(QStringLiteral("sync"), it->sync);
+        entry.insert(QStringLiteral("syncOnMainThread"), it->syncOnMainThread);
+        entry.insert(QStringLiteral("latencyUs"), it->latency.toMap());
+        result.insert(it.key(), entry);
+    }
+    return result;
+}
+
+DBusSyncCall::DBusSyncCall(const QString &destination, const QString &method)
+    : m_key(destination + QLatin1Char(' ') + method)
+{
+    m_timer.start();
+}
+
+DBusSyncCall::~DBusSyncCall()
+{
+    DBusCallStats *stats = DBusCallStats::instance();
+    DBusCallStats::Entry &entry(stats->begin(m_key));
+    entry.sync++;
+    entry.latency.record(m_timer.nsecsElapsed() / 1000);
+
+    if (QThread::currentThread() == QCoreApplication::instance()->thread()) {
+        entry.syncOnMainThread++;
+        qCDebug(lcDaemon) << "Blocking D-Bus call" << m_key << "on the main thread took"
+                          << m_timer.elapsed() << "ms";
+    }
+}
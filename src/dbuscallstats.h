@@ -0,0 +1,116 @@
+/******************************************************************************
+**
+** This file is part of commhistory-daemon.
+**
+** Copyright (C) 2026 Jolla Ltd.
+**
+** This library is free software; you can redistribute it and/or modify it
+** under the terms of the GNU Lesser General Public License version 2.1 as
+** published by the Free Software Foundation.
+**
+** This library is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+** or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+** License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this library; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+**
+******************************************************************************/
+
+
+#ifndef DBUSCALLSTATS_H
+#define DBUSCALLSTATS_H
+
+#include <QObject>
+#include <QDBusPendingCall>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QString>
+#include <QVariantMap>
+
+#include "metrics.h"
+
+class QDBusPendingCallWatcher;
+
+namespace RTComLogger
+{
+
+/*!
+ * \class DBusCallStats
+ * \brief Accounts outgoing D-Bus calls per destination and method.
+ *
+ * Asynchronous calls are passed through track(), which counts them as
+ * in flight until the reply arrives and records the round trip time.
+ * Calls made through a library that hides the reply are only count()ed.
+ * Blocking calls are wrapped in a DBusSyncCall scope, which also notes
+ * whether they blocked the main thread. The result is reported through
+ * Metrics as "dbusCalls". Only used from the main thread.
+ */
+class DBusCallStats : public QObject
+{
+    Q_OBJECT
+
+public:
+    static DBusCallStats* instance();
+
+    QDBusPendingCall track(const QString &destination, const QString &method,
+                           const QDBusPendingCall &call);
+
+    /*!
+     * \brief Tracks an operation that emits finished(Tp::PendingOperation*),
+     * such as the Telepathy D-Bus calls behind it.
+     */
+    void trackOperation(const QString &destination, const QString &method, QObject *operation);
+
+    void count(const QString &destination, const QString &method);
+
+    QVariantMap statistics() const;
+
+private Q_SLOTS:
+    void onCallFinished(QDBusPendingCallWatcher *watcher);
+    void onOperationFinished();
+
+private:
+    friend class DBusSyncCall;
+
+    explicit DBusCallStats(QObject *parent);
+
+    struct Entry {
+        Entry() : calls(0), inFlight(0), maxInFlight(0), errors(0), sync(0), syncOnMainThread(0) {}
+        qint64 calls;
+        int inFlight;
+        int maxInFlight;
+        qint64 errors;
+        qint64 sync;
+        qint64 syncOnMainThread;
+        LatencyHistogram latency;
+    };
+
+    Entry &begin(const QString &key);
+    void finish(QObject *tracker, bool error);
+
+    QElapsedTimer m_clock;
+    QHash<QString, Entry> m_entries;
+};
+
+/*!
+ * \class DBusSyncCall
+ * \brief Accounts the blocking D-Bus call made within its scope.
+ */
+class DBusSyncCall
+{
+public:
+    DBusSyncCall(const QString &destination, const QString &method);
+    ~DBusSyncCall();
+
+private:
+    Q_DISABLE_COPY(DBusSyncCall)
+    QString m_key;
+    QElapsedTimer m_timer;
+};
+
+} // namespace RTComLogger
+
+#endif // DBUSCALLSTATS_H
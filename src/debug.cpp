@@ -0,0 +1,102 @@
+/******************************************************************************
+**
+** This file is part of commhistory-daemon.
+**
+** Copyright (C) 2026 Jolla Ltd.
+**
+** This library is free software; you can redistribute it and/or modify it
+** under the terms of the GNU Lesser General Public License version 2.1 as
+** published by the Free Software Foundation.
+**
+** This library is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+** or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+** License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this library; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+**
+******************************************************************************/
+
+
+#include "debug.h"
+
+#include <QMap>
+#include <QStringList>
+
+Q_LOGGING_CATEGORY(lcDaemon, "commhistoryd.daemon")
+Q_LOGGING_CATEGORY(lcText, "commhistoryd.text")
+Q_LOGGING_CATEGORY(lcCall, "commhistoryd.call")
+Q_LOGGING_CATEGORY(lcNotification, "commhistoryd.notification")
+Q_LOGGING_CATEGORY(lcMms, "commhistoryd.mms")
+Q_LOGGING_CATEGORY(lcReviver, "commhistoryd.reviver")
+Q_LOGGING_CATEGORY(lcCleanup, "commhistoryd.cleanup")
+
+namespace {
+
+const char * const levelNames[] = { "debug", "info", "warning", "critical", "off" };
+const int levelCount = sizeof(levelNames) / sizeof(levelNames[0]);
+
+const char * const categoryNames[] = {
+    "daemon", "text", "call", "notification", "mms", "reviver", "cleanup"
+};
+const int categoryCount = sizeof(categoryNames) / sizeof(categoryNames[0]);
+
+// Rule prefix => index of the lowest enabled level. QMap keeps "*"
+// first, so the more specific rules override it.
+QMap<QString, int> levels;
+
+}
+
+bool RTComLogger::setLogLevel(const QString &category, const QString &level)
+{
+    int levelIndex = 0;
+    while (levelIndex < levelCount && level != QLatin1String(levelNames[levelIndex]))
+        levelIndex++;
+    if (levelIndex == levelCount)
+        return false;
+
+    QString prefix;
+    if (category == QLatin1String("all")) {
+        levels.clear();
+        prefix = QStringLiteral("*");
+    } else if (category == QLatin1String("default")) {
+        prefix = category;
+    } else {
+        for (int i = 0; i < categoryCount; i++) {
+            if (category == QLatin1String(categoryNames[i])) {
+                prefix = QStringLiteral("commhistoryd.") + category;
+                break;
+            }
+        }
+        if (prefix.isEmpty())
+            return false;
+    }
+    levels.insert(prefix, levelIndex);
+
+    QStringList rules;
+    for (QMap<QString, int>::const_iterator it = levels.constBegin(); it != levels.constEnd(); ++it) {
+        // Fatal messages can't be disabled, "off" is the last entry
+        for (int i = 0; i < levelCount - 1; i++) {
+            rules << QString::fromLatin1("%1.%2=%3").arg(it.key(),
+                                                         QLatin1String(levelNames[i]),
+                                                         QLatin1String(i >= it.value() ? "true" : "false"));
+        }
+    }
+    QLoggingCategory::setFilterRules(rules.join(QLatin1Char('\n')));
+    return true;
+}
+
+bool RTComLogger::isLoggingOff()
+{
+    // Without a rule for "*", Qt's defaults apply to the rest
+    if (!levels.contains(QStringLiteral("*")))
+        return false;
+
+    foreach (int levelIndex, levels) {
+        if (levelIndex != levelCount - 1)
+            return false;
+    }
+    return true;
+}
@@ -24,7 +24,36 @@
 #define DEBUG_H
 
 #include <QDebug>
+#include <QLoggingCategory>
 
-#define DEBUG qDebug
+Q_DECLARE_LOGGING_CATEGORY(lcDaemon)
+Q_DECLARE_LOGGING_CATEGORY(lcText)
+Q_DECLARE_LOGGING_CATEGORY(lcCall)
+Q_DECLARE_LOGGING_CATEGORY(lcNotification)
+Q_DECLARE_LOGGING_CATEGORY(lcMms)
+Q_DECLARE_LOGGING_CATEGORY(lcReviver)
+Q_DECLARE_LOGGING_CATEGORY(lcCleanup)
+
+// The message is not formatted at all if the category is disabled
+#define DEBUG() qCDebug(lcDaemon)
+
+namespace RTComLogger {
+
+/*!
+ * \brief Sets the lowest logged level of \a category.
+ *
+ * \a category is one of daemon, text, call, notification, mms, reviver,
+ * cleanup, default (uncategorized messages) or all, which also covers
+ * Qt's own categories. \a level is debug, info, warning, critical or off.
+ * Returns false if either is unknown.
+ */
+bool setLogLevel(const QString &category, const QString &level);
+
+/*!
+ * \brief Returns true if setLogLevel() has turned off every category.
+ */
+bool isLoggingOff();
+
+}
 
 #endif // DEBUG_H
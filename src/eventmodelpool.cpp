@@ -0,0 +1,195 @@
+/******************************************************************************
+**
+** This file is part of commhistory-daemon.
+**
+** Copyright (C) 2026 Jolla Ltd.
+**
+** This library is free software; you can redistribute it and/or modify it
+** under the terms of the GNU Lesser General Public License version 2.1 as
+** published by the Free Software Foundation.
+**
+** This library is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+** or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+** License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this library; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+**
+******************************************************************************/
+
+#include "eventmodelpool.h"
+#include "eventstorage.h"
+#include "debug.h"
+
+#include <CommHistory/EventModel>
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QTimer>
+
+#define DEBUG_(x) qCDebug(lcDaemon) << "EventModelPool:" << x
+
+using namespace RTComLogger;
+using namespace CommHistory;
+
+// Idle models kept around, enough for a call and a message at once
+#define POOL_SIZE 3
+
+static EventModelPool* pool = 0;
+static bool poolDeleted = false;
+static const char *kGenerationProperty = "pool-generation";
+
+EventModelPool* EventModelPool::instance()
+{
+    // Not brought back by listeners being deleted after the pool
+    if (!pool && !poolDeleted)
+        pool = new EventModelPool(QCoreApplication::instance());
+    return pool;
+}
+
+EventModelPool::EventModelPool(QObject *parent)
+    : QObject(parent),
+      m_storage(0),
+      m_generation(0),
+      m_warmUpPending(true),
+      m_hits(0),
+      m_misses(0),
+      m_hitNs(0),
+      m_missNs(0),
+      m_warmUpNs(0),
+      m_firstAcquireNs(-1),
+      m_firstAcquireHit(false)
+{
+    QTimer::singleShot(0, this, SLOT(warmUp()));
+}
+
+EventModelPool::~EventModelPool()
+{
+    pool = 0;
+    poolDeleted = true;
+}
+
+void EventModelPool::checkStorage()
+{
+    // Idle models of a replaced storage are of no use anymore
+    EventStorage *storage = EventStorage::instance();
+    if (storage != m_storage) {
+        qDeleteAll(m_free);
+        m_free.clear();
+        m_storage = storage;
+        m_generation++;
+    }
+}
+
+void EventModelPool::warmUp()
+{
+    m_warmUpPending = false;
+    checkStorage();
+    if (m_free.size() >= POOL_SIZE)
+        return;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    m_storage->open();
+    while (m_free.size() < POOL_SIZE) {
+        EventModel *model = m_storage->createEventModel();
+        model->setParent(this);
+        model->setProperty(kGenerationProperty, m_generation);
+        m_free.append(model);
+    }
+
+    m_warmUpNs += timer.nsecsElapsed();
+    DEBUG_("warmed up" << m_free.size() << "model(s) in" << timer.nsecsElapsed() / 1000 << "us");
+}
+
+EventModel* EventModelPool::acquire()
+{
+    EventModelPool *p = instance();
+    if (!p)
+        return EventStorage::instance()->createEventModel();
+    return p->take();
+}
+
+EventModel* EventModelPool::take()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    checkStorage();
+
+    EventModel *model;
+    bool hit = !m_free.isEmpty();
+    if (hit)
+        model = m_free.takeLast();
+    else
+        model = m_storage->createEventModel();
+    model->setProperty(kGenerationProperty, m_generation);
+    // Borrowed models belong to the borrower until released
+    model->setParent(0);
+
+    qint64 ns = timer.nsecsElapsed();
+    if (hit) {
+        m_hits++;
+        m_hitNs += ns;
+    } else {
+        m_misses++;
+        m_missNs += ns;
+    }
+    // Compares a warmed-up pool with cold model setup on the first
+    // call or message
+    if (m_firstAcquireNs < 0) {
+        m_firstAcquireNs = ns;
+        m_firstAcquireHit = hit;
+        DEBUG_("first model" << (hit ? "from pool" : "created") << "in" << ns / 1000 << "us");
+    }
+
+    // Refill when idle
+    if (m_free.size() < POOL_SIZE && !m_warmUpPending) {
+        m_warmUpPending = true;
+        QTimer::singleShot(0, this, SLOT(warmUp()));
+    }
+    return model;
+}
+
+void EventModelPool::release(EventModel *model, QObject *user)
+{
+    if (!model)
+        return;
+
+    if (user)
+        QObject::disconnect(model, 0, user, 0);
+
+    // Listeners are deleted with the application after the pool
+    if (!pool) {
+        delete model;
+        return;
+    }
+
+    // Only clean models of the current storage are reused
+    if (model->rowCount() > 0 || pool->m_free.size() >= POOL_SIZE
+        || model->property(kGenerationProperty).toInt() != pool->m_generation) {
+        model->deleteLater();
+    } else {
+        model->setParent(pool);
+        pool->m_free.append(model);
+    }
+}
+
+QVariantMap EventModelPool::statistics() const
+{
+    QVariantMap result;
+    result.insert("idle", m_free.size());
+    result.insert("hits", m_hits);
+    result.insert("misses", m_misses);
+    result.insert("averageHitUs", m_hits ? m_hitNs / m_hits / 1000 : 0);
+    result.insert("averageMissUs", m_misses ? m_missNs / m_misses / 1000 : 0);
+    result.insert("warmUpUs", m_warmUpNs / 1000);
+    if (m_firstAcquireNs >= 0) {
+        result.insert("firstAcquireUs", m_firstAcquireNs / 1000);
+        result.insert("firstAcquireHit", m_firstAcquireHit);
+    }
+    return result;
+}
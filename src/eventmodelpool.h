@@ -0,0 +1,116 @@
+/******************************************************************************
+**
+** This file is part of commhistory-daemon.
+**
+** Copyright (C) 2026 Jolla Ltd.
+**
+** This library is free software; you can redistribute it and/or modify it
+** under the terms of the GNU Lesser General Public License version 2.1 as
+** published by the Free Software Foundation.
+**
+** This library is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+** or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+** License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this library; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+**
+******************************************************************************/
+
+#ifndef EVENTMODELPOOL_H
+#define EVENTMODELPOOL_H
+
+#include <QObject>
+#include <QList>
+#include <QVariantMap>
+
+namespace CommHistory {
+    class EventModel;
+}
+
+namespace RTComLogger
+{
+
+class EventStorage;
+
+/*!
+ * \class EventModelPool
+ * \brief Daemon-wide pool of ready made event models.
+ *
+ * Setting up an EventModel (and the database connection behind it on
+ * first use) is done at idle time instead of on the call or message
+ * path. Listeners borrow a model for their lifetime, short-lived users
+ * go through PooledEventModel.
+ */
+class EventModelPool : public QObject
+{
+    Q_OBJECT
+
+public:
+    /*!
+     * \brief Returns the pool, or null once it has been deleted with the
+     * application.
+     */
+    static EventModelPool* instance();
+
+    /*!
+     * \brief Takes a model from the pool, or creates one if it's empty
+     * or already gone.
+     */
+    static CommHistory::EventModel* acquire();
+
+    /*!
+     * \brief Returns \a model to the pool. Connections from the model to
+     * \a user are dropped. If the pool is already gone the model is
+     * deleted.
+     */
+    static void release(CommHistory::EventModel *model, QObject *user = 0);
+
+    QVariantMap statistics() const;
+
+public Q_SLOTS:
+    void warmUp();
+
+private:
+    explicit EventModelPool(QObject *parent);
+    ~EventModelPool();
+
+    void checkStorage();
+    CommHistory::EventModel* take();
+
+    QList<CommHistory::EventModel*> m_free;
+    EventStorage *m_storage;
+    int m_generation;
+    bool m_warmUpPending;
+    int m_hits;
+    int m_misses;
+    qint64 m_hitNs;
+    qint64 m_missNs;
+    qint64 m_warmUpNs;
+    qint64 m_firstAcquireNs;
+    bool m_firstAcquireHit;
+};
+
+/*!
+ * \class PooledEventModel
+ * \brief Borrows an event model from the pool for the current scope.
+ */
+class PooledEventModel
+{
+public:
+    PooledEventModel() : m_model(EventModelPool::acquire()) {}
+    ~PooledEventModel() { EventModelPool::release(m_model); }
+
+    CommHistory::EventModel* operator->() const { return m_model; }
+    CommHistory::EventModel& operator*() const { return *m_model; }
+
+private:
+    Q_DISABLE_COPY(PooledEventModel)
+    CommHistory::EventModel *m_model;
+};
+
+} // namespace RTComLogger
+
+#endif // EVENTMODELPOOL_H
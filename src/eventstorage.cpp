@@ -0,0 +1,99 @@
+/******************************************************************************
+**
+** This file is part of commhistory-daemon.
+**
+** Copyright (C) 2026 Jolla Ltd.
+**
+** This library is free software; you can redistribute it and/or modify it
+** under the terms of the GNU Lesser General Public License version 2.1 as
+** published by the Free Software Foundation.
+**
+** This library is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+** or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+** License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this library; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+**
+******************************************************************************/
+
+
+#include "eventstorage.h"
+
+#include <CommHistory/EventModel>
+#include <CommHistory/SingleEventModel>
+#include <CommHistory/DatabaseIO>
+
+#include <QDebug>
+
+using namespace RTComLogger;
+using namespace CommHistory;
+
+namespace {
+
+class DatabaseStorage : public EventStorage
+{
+public:
+    void open()
+    {
+        // Opens the database connection shared by all models
+        DatabaseIO::instance();
+    }
+
+    EventModel* createEventModel()
+    {
+        EventModel *model = new EventModel;
+        // Make sure the database is open before the model is used
+        model->databaseIO();
+        return model;
+    }
+
+    bool getEventByTokens(const QString &token, const QString &mmsId, int groupId,
+                          const Event::PropertySet &properties, Event &event)
+    {
+        SingleEventModel model;
+        model.setQueryMode(SingleEventModel::SyncQuery);
+        model.setPropertyMask(properties);
+
+        if (model.getEventByTokens(token, mmsId, groupId)) {
+            if (model.rowCount() > 0)
+                event = model.event();
+            return true;
+        } else {
+            qWarning() << "Failed query single event model";
+            return false;
+        }
+    }
+
+    bool getEventById(int eventId, Event &event)
+    {
+        SingleEventModel model;
+        model.setQueryMode(SingleEventModel::SyncQuery);
+
+        if (model.getEventById(eventId)) {
+            if (model.rowCount() > 0)
+                event = model.event();
+            return true;
+        } else {
+            qWarning() << "Failed query single event model";
+            return false;
+        }
+    }
+};
+
+}
+
+static EventStorage* storage = 0;
+
+EventStorage* EventStorage::instance()
+{
+    static DatabaseStorage database;
+    return storage ? storage : &database;
+}
+
+void EventStorage::setInstance(EventStorage *instance)
+{
+    storage = instance;
+}
@@ -0,0 +1,78 @@
+/******************************************************************************
+**
+** This file is part of commhistory-daemon.
+**
+** Copyright (C) 2026 Jolla Ltd.
+**
+** This library is free software; you can redistribute it and/or modify it
+** under the terms of the GNU Lesser General Public License version 2.1 as
+** published by the Free Software Foundation.
+**
+** This library is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+** or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+** License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this library; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+**
+******************************************************************************/
+
+
+#ifndef EVENTSTORAGE_H
+#define EVENTSTORAGE_H
+
+#include <QString>
+
+#include <CommHistory/Event>
+
+namespace CommHistory {
+    class EventModel;
+}
+
+namespace RTComLogger
+{
+
+/*!
+ * \class EventStorage
+ * \brief Where the listeners store and look up their events.
+ *
+ * The default goes to the commhistory database. Tests and benchmarks
+ * can install a backend of their own with setInstance(), models are
+ * taken from it by EventModelPool.
+ */
+class EventStorage
+{
+public:
+    virtual ~EventStorage() {}
+
+    static EventStorage* instance();
+
+    /*!
+     * \brief Replaces the storage, 0 restores the default. Ownership is
+     * not taken. Models already handed out stay with their old storage.
+     */
+    static void setInstance(EventStorage *storage);
+
+    /*!
+     * \brief Prepares the storage before the first model is created.
+     */
+    virtual void open() = 0;
+
+    virtual CommHistory::EventModel* createEventModel() = 0;
+
+    /*!
+     * \brief Finds the event with \a token, or \a mmsId in \a groupId.
+     * \return false if the lookup failed, true with an invalid \a event
+     * if there was no match.
+     */
+    virtual bool getEventByTokens(const QString &token, const QString &mmsId, int groupId,
+                                  const CommHistory::Event::PropertySet &properties,
+                                  CommHistory::Event &event) = 0;
+    virtual bool getEventById(int eventId, CommHistory::Event &event) = 0;
+};
+
+} // namespace RTComLogger
+
+#endif // EVENTSTORAGE_H
@@ -21,26 +21,129 @@
 ****************************************************************************/
 
 #include "fscleanup.h"
+#include "databasereader.h"
 #include "debug.h"
 
 #include <CommHistory/commhistorydatabasepath.h>
 #include <CommHistory/databaseio.h>
 #include <CommHistory/constants.h>
 
-#include <QDirIterator>
 #include <QDBusConnection>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QRunnable>
+#include <QSet>
+#include <QThread>
 
-#define DEBUG_(x) qDebug() << "FsCleanup:" << x
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define DEBUG_(x) qCDebug(lcCleanup) << "FsCleanup:" << x
+
+// Give the rest of the daemon time to start before touching the disk
+#define STARTUP_DELAY_MS (10000)
+// How often the progress is reported during the removal phase
+#define PROGRESS_INTERVAL (50)
+// Delay of the consistency pass that follows group deletions. Targeted
+// cleanup handles the directories known at the last full pass, this
+// catches anything created since then.
+#define CONSISTENCY_DELAY_MS (30*60*1000)
+
+static int openDataDir()
+{
+    QByteArray dataDir(QFile::encodeName(CommHistoryDatabasePath::dataDir()));
+    int fd = open(dataDir.constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0 && errno != ENOENT) {
+        int err = errno;
+        qWarning() << "Failed to open" << dataDir << strerror(err);
+        errno = err;
+    }
+    return fd;
+}
+
+// Runs a full pass when iEventIds is empty, otherwise only looks at
+// the directories of the given events
+class FsCleanupTask: public QRunnable
+{
+public:
+    FsCleanupTask(FsCleanup* aOwner, const QList<int>& aEventIds) :
+        iOwner(aOwner), iEventIds(aEventIds) {}
+    void run();
+
+private:
+    FsCleanup* iOwner;
+    QList<int> iEventIds;
+};
+
+void FsCleanupTask::run()
+{
+    QThread::currentThread()->setPriority(QThread::LowestPriority);
+    iOwner->iStats = FsCleanup::Stats();
+    bool ok;
+    if (iEventIds.isEmpty()) {
+        iOwner->iNewIndex.clear();
+        ok = FsCleanup::fullCleanup(iOwner, iOwner->iStats, iOwner->iNewIndex);
+    } else {
+        ok = FsCleanup::targetedCleanup(iOwner, iOwner->iStats, iEventIds);
+    }
+    QMetaObject::invokeMethod(iOwner, "onCleanupFinished",
+        Qt::QueuedConnection, Q_ARG(bool, ok));
+}
 
 FsCleanup::FsCleanup(QObject* aParent) :
-    QObject(aParent)
+    QObject(aParent),
+    iRunning(false),
+    iRunningFull(false),
+    iPendingFull(false),
+    iRuns(0),
+    iTargetedRuns(0)
 {
     QDBusConnection dbus(QDBusConnection::sessionBus());
     dbus.connect(QString(), QString(), COMM_HISTORY_INTERFACE,
         EVENT_DELETED_SIGNAL, this, SLOT(onEventDeleted(int)));
     dbus.connect(QString(), QString(), COMM_HISTORY_INTERFACE,
         GROUPS_DELETED_SIGNAL, this, SLOT(onGroupsDeleted(QList<int>)));
-    fullCleanup();
+
+    iPool.setMaxThreadCount(1);
+    iStartTimer.setSingleShot(true);
+    iStartTimer.setInterval(STARTUP_DELAY_MS);
+    connect(&iStartTimer, SIGNAL(timeout()), SLOT(startFullCleanup()));
+    iStartTimer.start();
+
+    iConsistencyTimer.setSingleShot(true);
+    iConsistencyTimer.setInterval(CONSISTENCY_DELAY_MS);
+    connect(&iConsistencyTimer, SIGNAL(timeout()), SLOT(startFullCleanup()));
+}
+
+FsCleanup::~FsCleanup()
+{
+    // The task stops at the next directory, don't leave it running
+    // against a destroyed object
+    iCancelled.storeRelease(1);
+    iPool.waitForDone();
+}
+
+QVariantMap FsCleanup::statistics() const
+{
+    QVariantMap result;
+    result.insert("runs", iRuns);
+    result.insert("targetedRuns", iTargetedRuns);
+    result.insert("running", iRunning);
+    result.insert("indexedDirs", iIndex.count());
+    if (!iRunning) {
+        result.insert("dirsScanned", iStats.iDirsScanned);
+        result.insert("dirsRemoved", iStats.iDirsRemoved);
+        result.insert("filesRemoved", iStats.iFilesRemoved);
+        result.insert("failures", iStats.iFailures);
+        result.insert("scanMs", iStats.iScanMs);
+        result.insert("queryMs", iStats.iQueryMs);
+        result.insert("deleteMs", iStats.iDeleteMs);
+    }
+    return result;
 }
 
 void FsCleanup::onEventDeleted(int aEventId)
@@ -49,6 +152,7 @@ void FsCleanup::onEventDeleted(int aEventId)
     if (!io->eventExists(aEventId)) {
         DEBUG_("Event" << aEventId << "deleted");
         deleteFiles(aEventId);
+        iIndex.remove(aEventId);
     } else {
         // Ignore deleteEvent signals emitted by EventModel::moveEvent
         DEBUG_("Ignoring delete signal for" << aEventId);
@@ -58,57 +162,249 @@ void FsCleanup::onEventDeleted(int aEventId)
 void FsCleanup::onGroupsDeleted(QList<int> aGroupIds)
 {
     DEBUG_(aGroupIds.count() << "group(s) deleted");
-    fullCleanup();
+    const QSet<int> groups(aGroupIds.toSet());
+    QHash<int,int>::iterator it = iIndex.begin();
+    while (it != iIndex.end()) {
+        if (groups.contains(it.value())) {
+            iPendingTargets.append(it.key());
+            it = iIndex.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    if (iRunningFull) {
+        // The index being built may still list these groups
+        iDeletedGroups.unite(groups);
+    }
+
+    // Rarely needed, don't postpone it with every deletion
+    if (!iConsistencyTimer.isActive() && !iStartTimer.isActive()) {
+        iConsistencyTimer.start();
+    }
+    startNextRun();
+}
+
+void FsCleanup::startFullCleanup()
+{
+    iStartTimer.stop();
+    iConsistencyTimer.stop();
+    iPendingFull = true;
+    startNextRun();
+}
+
+void FsCleanup::startNextRun()
+{
+    if (iRunning) {
+        // Picked up once the current run is done
+        return;
+    }
+    if (!iPendingTargets.isEmpty()) {
+        DEBUG_("Running targeted cleanup of" << iPendingTargets.count() << "dir(s)");
+        iRunning = true;
+        iPool.start(new FsCleanupTask(this, iPendingTargets));
+        iPendingTargets.clear();
+    } else if (iPendingFull) {
+        iRunning = true;
+        iRunningFull = true;
+        iPendingFull = false;
+        iDeletedGroups.clear();
+        iPool.start(new FsCleanupTask(this, QList<int>()));
+    }
+}
+
+void FsCleanup::onCleanupProgress(int aDone, int aTotal)
+{
+    Q_EMIT cleanupProgress(aDone, aTotal);
+}
+
+void FsCleanup::onCleanupFinished(bool aOk)
+{
+    iRunning = false;
+    if (iRunningFull) {
+        iRunningFull = false;
+        iRuns++;
+        if (aOk) {
+            iIndex.swap(iNewIndex);
+            // Groups deleted during the run may have been indexed
+            // before their events were gone
+            if (!iDeletedGroups.isEmpty()) {
+                onGroupsDeleted(iDeletedGroups.toList());
+                iDeletedGroups.clear();
+            }
+        }
+        iNewIndex.clear();
+    } else {
+        iTargetedRuns++;
+    }
+    QVariantMap stats(statistics());
+    stats.insert("ok", aOk);
+    DEBUG_("Cleanup" << (aOk ? "done" : "failed") << stats);
+    Q_EMIT cleanupFinished(stats);
+    startNextRun();
 }
 
-void FsCleanup::fullCleanup()
+// Runs on the worker thread
+bool FsCleanup::fullCleanup(FsCleanup* aOwner, Stats& aStats,
+    QHash<int,int>& aIndex)
 {
     DEBUG_("Running full cleanup");
-    CommHistory::DatabaseIO* io = CommHistory::DatabaseIO::instance();
-    QDirIterator it(CommHistoryDatabasePath::dataDir(),
-        QDir::Dirs | QDir::NoDotAndDotDot);
-    while (it.hasNext()) {
-        it.next();
-        bool ok = false;
-        int id = it.fileName().toInt(&ok);
-        if (ok && !io->eventExists(id)) {
-            deleteFiles(id);
+    QElapsedTimer timer;
+    timer.start();
+
+    int dataFd = openDataDir();
+    if (dataFd < 0) {
+        // Nothing to clean if there's no data directory yet
+        return errno == ENOENT;
+    }
+
+    // Collect the candidates first, the directory isn't modified
+    // while it's being read
+    QList<int> ids;
+    DIR* dir = fdopendir(dup(dataFd));
+    if (dir) {
+        struct dirent* entry;
+        while ((entry = readdir(dir)) != NULL) {
+            if (entry->d_type != DT_DIR && entry->d_type != DT_UNKNOWN) {
+                continue;
+            }
+            bool ok = false;
+            int id = QByteArray(entry->d_name).toInt(&ok);
+            if (ok) {
+                ids.append(id);
+            }
+        }
+        closedir(dir);
+    }
+    aStats.iDirsScanned = ids.count();
+    aStats.iScanMs = timer.elapsed();
+
+    bool ok = removeOrphans(aOwner, aStats, dataFd, ids, &aIndex);
+    close(dataFd);
+    return ok;
+}
+
+// Runs on the worker thread
+bool FsCleanup::targetedCleanup(FsCleanup* aOwner, Stats& aStats,
+    const QList<int>& aEventIds)
+{
+    int dataFd = openDataDir();
+    if (dataFd < 0) {
+        // Nothing to clean if there's no data directory yet
+        return errno == ENOENT;
+    }
+
+    aStats.iDirsScanned = aEventIds.count();
+    bool ok = removeOrphans(aOwner, aStats, dataFd, aEventIds, NULL);
+    close(dataFd);
+    return ok;
+}
+
+// Removes the directories of those aCandidates which no longer have an
+// event, and records the rest in aIndex if given
+bool FsCleanup::removeOrphans(FsCleanup* aOwner, Stats& aStats, int aDataFd,
+    const QList<int>& aCandidates, QHash<int,int>* aIndex)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QHash<int,int> existing;
+    if (!aCandidates.isEmpty()) {
+        DatabaseReader reader(QLatin1String("commhistoryd-fscleanup"));
+        if (!reader.eventGroups(aCandidates, existing)) {
+            // Never remove anything without knowing what is still in use
+            qWarning() << "Unable to check events, skipping cleanup";
+            return false;
+        }
+    }
+    aStats.iQueryMs = timer.restart();
+
+    QList<int> orphans;
+    foreach (int id, aCandidates) {
+        if (!existing.contains(id)) {
+            orphans.append(id);
         }
     }
-    DEBUG_("Cleanup done");
+    if (aIndex) {
+        aIndex->swap(existing);
+    }
+
+    for (int i = 0; i < orphans.count() && !aOwner->iCancelled.loadAcquire(); i++) {
+        QByteArray name(QByteArray::number(orphans.at(i)));
+        DEBUG_("Removing" << name);
+        if (removeDir(aDataFd, name.constData(), aStats)) {
+            aStats.iDirsRemoved++;
+        } else {
+            aStats.iFailures++;
+        }
+        if (!((i + 1) % PROGRESS_INTERVAL)) {
+            QMetaObject::invokeMethod(aOwner, "onCleanupProgress",
+                Qt::QueuedConnection, Q_ARG(int, i + 1),
+                Q_ARG(int, orphans.count()));
+        }
+    }
+    aStats.iDeleteMs = timer.elapsed();
+    return !aStats.iFailures;
 }
 
 void FsCleanup::deleteFiles(int aEventId)
 {
-    removeDir(CommHistoryDatabasePath::dataDir(aEventId));
+    int dataFd = openDataDir();
+    if (dataFd >= 0) {
+        Stats stats;
+        removeDir(dataFd, QByteArray::number(aEventId).constData(), stats);
+        close(dataFd);
+    }
 }
 
-bool FsCleanup::removeDir(QString aDirPath)
+// Removes aName under aParentFd recursively. Nothing is resolved by
+// path, so the traversal can't be redirected by symbolic links.
+bool FsCleanup::removeDir(int aParentFd, const char* aName, Stats& aStats)
 {
+    int fd = openat(aParentFd, aName, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0) {
+        if (errno == ENOENT) {
+            return true;
+        } else if (errno == ENOTDIR || errno == ELOOP) {
+            // Not a directory, nothing of ours
+            return true;
+        }
+        qWarning() << "Failed to open" << aName << strerror(errno);
+        return false;
+    }
+
+    DIR* dir = fdopendir(fd);
+    if (!dir) {
+        qWarning() << "Failed to read" << aName << strerror(errno);
+        close(fd);
+        return false;
+    }
+
     bool result = true;
-    QDir dir(aDirPath);
-    if (dir.exists()) {
-        DEBUG_("Removing" << aDirPath);
-        QFileInfoList list = dir.entryInfoList(QDir::NoDotAndDotDot |
-            QDir::System | QDir::Hidden  | QDir::AllDirs | QDir::Files,
-            QDir::DirsFirst);
-        for (int i=0; i<list.count(); i++) {
-            QFileInfo info(list.at(i));
-            QString path(info.absoluteFilePath());
-            if (info.isDir()) {
-                result = removeDir(path);
-            } else {
-                result = QFile::remove(path);
-            }
-            if (!result) {
-                qWarning() << "Failed to remove" << path;
-                return result;
-            }
+    struct dirent* entry;
+    while (result && (entry = readdir(dir)) != NULL) {
+        if (!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, "..")) {
+            continue;
+        }
+        bool isDir = (entry->d_type == DT_DIR);
+        if (entry->d_type == DT_UNKNOWN) {
+            struct stat st;
+            isDir = !fstatat(fd, entry->d_name, &st, AT_SYMLINK_NOFOLLOW) &&
+                S_ISDIR(st.st_mode);
         }
-        result = dir.rmdir(aDirPath);
-        if (!result) {
-            qWarning() << "Failed to remove" << aDirPath;
+        if (isDir) {
+            result = removeDir(fd, entry->d_name, aStats);
+        } else if (unlinkat(fd, entry->d_name, 0) == 0) {
+            aStats.iFilesRemoved++;
+        } else if (errno != ENOENT) {
+            qWarning() << "Failed to remove" << entry->d_name << "in" << aName << strerror(errno);
+            result = false;
         }
     }
+    closedir(dir);
+
+    if (result && unlinkat(aParentFd, aName, AT_REMOVEDIR) < 0 && errno != ENOENT) {
+        qWarning() << "Failed to remove" << aName << strerror(errno);
+        result = false;
+    }
     return result;
 }
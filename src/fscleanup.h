@@ -26,6 +26,12 @@
 #include <QObject>
 #include <QString>
 #include <QList>
+#include <QAtomicInt>
+#include <QHash>
+#include <QSet>
+#include <QThreadPool>
+#include <QTimer>
+#include <QVariantMap>
 
 class FsCleanup: public QObject
 {
@@ -33,15 +39,62 @@ class FsCleanup: public QObject
 
 public:
     FsCleanup(QObject* aParent);
+    ~FsCleanup();
+
+    QVariantMap statistics() const;
+
+    struct Stats {
+        int iDirsScanned;
+        int iDirsRemoved;
+        int iFilesRemoved;
+        int iFailures;
+        qint64 iScanMs;
+        qint64 iQueryMs;
+        qint64 iDeleteMs;
+        Stats() : iDirsScanned(0), iDirsRemoved(0), iFilesRemoved(0),
+            iFailures(0), iScanMs(0), iQueryMs(0), iDeleteMs(0) {}
+    };
+
+Q_SIGNALS:
+    void cleanupProgress(int aDone, int aTotal);
+    void cleanupFinished(const QVariantMap &aStatistics);
 
 private Q_SLOTS:
     void onEventDeleted(int aEventId);
     void onGroupsDeleted(QList<int> aGroupIds);
+    void startFullCleanup();
+    void startNextRun();
+    void onCleanupProgress(int aDone, int aTotal);
+    void onCleanupFinished(bool aOk);
 
 private:
-    static void fullCleanup();
+    friend class FsCleanupTask;
+    static bool fullCleanup(FsCleanup* aOwner, Stats& aStats,
+        QHash<int,int>& aIndex);
+    static bool targetedCleanup(FsCleanup* aOwner, Stats& aStats,
+        const QList<int>& aEventIds);
+    static bool removeOrphans(FsCleanup* aOwner, Stats& aStats, int aDataFd,
+        const QList<int>& aCandidates, QHash<int,int>* aIndex);
     static void deleteFiles(int aEventId);
-    static bool removeDir(QString aDirPath);
+    static bool removeDir(int aParentFd, const char* aName, Stats& aStats);
+
+private:
+    QThreadPool iPool;
+    QTimer iStartTimer;
+    QTimer iConsistencyTimer;
+    QAtomicInt iCancelled;
+    bool iRunning;
+    bool iRunningFull;
+    bool iPendingFull;
+    QList<int> iPendingTargets;
+    QSet<int> iDeletedGroups;
+    // Event id => group id of the event directories seen by the last
+    // full pass, used to find what to remove when groups are deleted
+    QHash<int,int> iIndex;
+    QHash<int,int> iNewIndex;
+    int iRuns;
+    int iTargetedRuns;
+    Stats iStats;
 };
 
 #endif // FSCLEANUP_H
@@ -0,0 +1,308 @@
+/******************************************************************************
+**
+** This file is part of commhistory-daemon.
+**
+** Copyright (C) 2026 Jolla Ltd.
+**
+** This library is free software; you can redistribute it and/or modify it
+** under the terms of the GNU Lesser General Public License version 2.1 as
+** published by the Free Software Foundation.
+**
+** This library is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+** or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+** License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this library; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+**
+******************************************************************************/
+
+#include "groupcache.h"
+#include "debug.h"
+
+#include <CommHistory/GroupModel>
+#include <CommHistory/constants.h>
+
+#include <QDBusConnection>
+
+#define DEBUG_(x) qCDebug(lcDaemon) << "GroupCache:" << x
+
+using namespace RTComLogger;
+using namespace CommHistory;
+
+GroupCache::GroupCache(QObject *parent)
+    : QAbstractListModel(parent),
+      m_unusedRemoteUids(0),
+      m_loader(0),
+      m_ready(false)
+{
+    QDBusConnection dbus(QDBusConnection::sessionBus());
+    dbus.connect(QString(), QString(), COMM_HISTORY_INTERFACE, GROUP_ADDED_SIGNAL,
+                 this, SLOT(onGroupAdded(CommHistory::Group)));
+    dbus.connect(QString(), QString(), COMM_HISTORY_INTERFACE, GROUPS_UPDATED_FULL_SIGNAL,
+                 this, SLOT(onGroupsUpdatedFull(QList<CommHistory::Group>)));
+    dbus.connect(QString(), QString(), COMM_HISTORY_INTERFACE, GROUPS_DELETED_SIGNAL,
+                 this, SLOT(onGroupsDeleted(QList<int>)));
+}
+
+GroupCache::~GroupCache()
+{
+}
+
+bool GroupCache::getGroups()
+{
+    if (m_loader)
+        return true;
+
+    // The full model is only kept until its contents are copied
+    m_loader = new GroupModel(this);
+    m_loader->setResolveContacts(GroupManager::DoNotResolve);
+    connect(m_loader, SIGNAL(modelReady(bool)), SLOT(onLoaderReady(bool)));
+    if (!m_loader->getGroups()) {
+        delete m_loader;
+        m_loader = 0;
+        return false;
+    }
+    return true;
+}
+
+bool GroupCache::isReady() const
+{
+    return m_ready;
+}
+
+void GroupCache::onLoaderReady(bool successful)
+{
+    if (successful) {
+        const int count = m_loader->rowCount();
+        m_entries.reserve(count);
+        for (int i = 0; i < count; i++)
+            upsert(m_loader->group(m_loader->index(i, 0)));
+        DEBUG_(m_entries.count() << "group(s)," << m_stringIds.count() << "string(s)");
+    } else {
+        qCritical() << "Failed to load groups";
+    }
+
+    m_loader->deleteLater();
+    m_loader = 0;
+    m_ready = successful;
+    Q_EMIT modelReady(successful);
+}
+
+int GroupCache::intern(const QString &string)
+{
+    QHash<QString, int>::const_iterator it = m_stringIds.constFind(string);
+    if (it != m_stringIds.constEnd()) {
+        m_stringRefs[it.value()]++;
+        return it.value();
+    }
+
+    int id;
+    if (!m_freeStrings.isEmpty()) {
+        id = m_freeStrings.takeLast();
+        m_strings[id] = string;
+        m_stringRefs[id] = 1;
+    } else {
+        id = m_strings.count();
+        m_strings.append(string);
+        m_stringRefs.append(1);
+    }
+    m_stringIds.insert(string, id);
+    return id;
+}
+
+void GroupCache::release(int id)
+{
+    if (--m_stringRefs[id] > 0)
+        return;
+
+    m_stringIds.remove(m_strings.at(id));
+    m_strings[id].clear();
+    m_freeStrings.append(id);
+}
+
+void GroupCache::releaseStrings(const Entry &entry)
+{
+    release(entry.localUid);
+    release(entry.chatName);
+    for (int i = 0; i < entry.remoteUidCount; i++)
+        release(m_remoteUids.at(entry.firstRemoteUid + i));
+}
+
+void GroupCache::store(Entry &entry, const Group &group)
+{
+    const RecipientList &recipients(group.recipients());
+
+    entry.id = group.id();
+    entry.localUid = intern(group.localUid());
+    entry.chatName = intern(group.chatName());
+    entry.chatType = group.chatType();
+
+    // Reuse the old slice if the recipients fit into it
+    if (recipients.count() > entry.remoteUidCount) {
+        m_unusedRemoteUids += entry.remoteUidCount;
+        entry.firstRemoteUid = m_remoteUids.count();
+        m_remoteUids.resize(m_remoteUids.count() + recipients.count());
+    } else {
+        m_unusedRemoteUids += entry.remoteUidCount - recipients.count();
+    }
+    entry.remoteUidCount = recipients.count();
+    for (int i = 0; i < recipients.count(); i++)
+        m_remoteUids[entry.firstRemoteUid + i] = intern(recipients.value(i).remoteUid());
+}
+
+void GroupCache::upsert(const Group &group)
+{
+    if (!group.isValid())
+        return;
+
+    QHash<int, int>::const_iterator it = m_rows.constFind(group.id());
+    if (it != m_rows.constEnd()) {
+        const int row = it.value();
+        // Released after storing, so that unchanged strings are kept
+        const Entry old(m_entries.at(row));
+        QVector<int> oldRemoteUids(m_remoteUids.mid(old.firstRemoteUid, old.remoteUidCount));
+        store(m_entries[row], group);
+        release(old.localUid);
+        release(old.chatName);
+        foreach (int id, oldRemoteUids)
+            release(id);
+        compactRemoteUids();
+        QModelIndex changed(index(row, 0));
+        Q_EMIT dataChanged(changed, changed);
+    } else {
+        Entry entry;
+        entry.firstRemoteUid = 0;
+        entry.remoteUidCount = 0;
+        store(entry, group);
+
+        const int row = m_entries.count();
+        beginInsertRows(QModelIndex(), row, row);
+        m_entries.append(entry);
+        m_rows.insert(entry.id, row);
+        endInsertRows();
+    }
+}
+
+void GroupCache::removeRow(int row)
+{
+    beginRemoveRows(QModelIndex(), row, row);
+    releaseStrings(m_entries.at(row));
+    m_unusedRemoteUids += m_entries.at(row).remoteUidCount;
+    m_rows.remove(m_entries.at(row).id);
+    m_entries.remove(row);
+    for (int i = row; i < m_entries.count(); i++)
+        m_rows.insert(m_entries.at(i).id, i);
+    endRemoveRows();
+}
+
+void GroupCache::compactRemoteUids()
+{
+    if (m_unusedRemoteUids < 64 || m_unusedRemoteUids < m_remoteUids.count() / 2)
+        return;
+
+    QVector<int> remoteUids;
+    remoteUids.reserve(m_remoteUids.count() - m_unusedRemoteUids);
+    for (int i = 0; i < m_entries.count(); i++) {
+        Entry &entry(m_entries[i]);
+        const int first = remoteUids.count();
+        for (int j = 0; j < entry.remoteUidCount; j++)
+            remoteUids.append(m_remoteUids.at(entry.firstRemoteUid + j));
+        entry.firstRemoteUid = first;
+    }
+    m_remoteUids.swap(remoteUids);
+    m_unusedRemoteUids = 0;
+}
+
+Group GroupCache::groupAt(int row) const
+{
+    Group group;
+    if (row < 0 || row >= m_entries.count())
+        return group;
+
+    const Entry &entry(m_entries.at(row));
+    const QString localUid(m_strings.at(entry.localUid));
+    QStringList remoteUids;
+    for (int i = 0; i < entry.remoteUidCount; i++)
+        remoteUids.append(m_strings.at(m_remoteUids.at(entry.firstRemoteUid + i)));
+
+    group.setId(entry.id);
+    group.setLocalUid(localUid);
+    group.setRecipients(RecipientList::fromUids(localUid, remoteUids));
+    group.setChatType(static_cast<Group::ChatType>(entry.chatType));
+    group.setChatName(m_strings.at(entry.chatName));
+    return group;
+}
+
+Group GroupCache::group(const QModelIndex &index) const
+{
+    return index.isValid() ? groupAt(index.row()) : Group();
+}
+
+Group GroupCache::groupById(int id) const
+{
+    return groupAt(m_rows.value(id, -1));
+}
+
+bool GroupCache::addGroup(Group &group)
+{
+    // A model that isn't loaded is just a cheap way to write
+    GroupModel writer;
+    if (!writer.addGroup(group))
+        return false;
+
+    // Don't wait for the D-Bus signal, callers look the group up right
+    // away. The groupAdded signal that follows stores the same data again,
+    // which only costs a dataChanged.
+    upsert(group);
+    return true;
+}
+
+bool GroupCache::modifyGroup(Group &group)
+{
+    GroupModel writer;
+    return writer.modifyGroup(group);
+}
+
+bool GroupCache::deleteGroups(const QList<int> &groupIds)
+{
+    GroupModel writer;
+    return writer.deleteGroups(groupIds);
+}
+
+int GroupCache::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_entries.count();
+}
+
+QVariant GroupCache::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_entries.count() || role != Qt::DisplayRole)
+        return QVariant();
+    return m_entries.at(index.row()).id;
+}
+
+void GroupCache::onGroupAdded(const Group &group)
+{
+    Q_EMIT groupsUpdated(QList<Group>() << group);
+    upsert(group);
+}
+
+void GroupCache::onGroupsUpdatedFull(const QList<Group> &groups)
+{
+    Q_EMIT groupsUpdated(groups);
+    foreach (const Group &group, groups)
+        upsert(group);
+}
+
+void GroupCache::onGroupsDeleted(const QList<int> &groupIds)
+{
+    foreach (int id, groupIds) {
+        int row = m_rows.value(id, -1);
+        if (row >= 0)
+            removeRow(row);
+    }
+    compactRemoteUids();
+}
@@ -0,0 +1,124 @@
+/******************************************************************************
+**
+** This file is part of commhistory-daemon.
+**
+** Copyright (C) 2026 Jolla Ltd.
+**
+** This library is free software; you can redistribute it and/or modify it
+** under the terms of the GNU Lesser General Public License version 2.1 as
+** published by the Free Software Foundation.
+**
+** This library is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+** or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+** License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this library; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+**
+******************************************************************************/
+
+#ifndef GROUPCACHE_H
+#define GROUPCACHE_H
+
+#include <QAbstractListModel>
+#include <QHash>
+#include <QStringList>
+#include <QVector>
+
+#include <CommHistory/Group>
+
+namespace CommHistory {
+    class GroupModel;
+}
+
+namespace RTComLogger
+{
+
+/*!
+ * \class GroupCache
+ * \brief Compact list of all conversations with only what the daemon
+ * looks at: id, local uid, remote uids, chat type and chat name.
+ *
+ * Strings are interned and reference counted, and rows are kept in
+ * contiguous arrays, so the cache stays small even with thousands of
+ * conversations. It is loaded once and then kept up to date from the
+ * commhistory D-Bus signals.
+ * The model interface mirrors the parts of CommHistory::GroupModel
+ * used by the daemon; group() returns a Group with only the cached
+ * properties set.
+ */
+class GroupCache : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    explicit GroupCache(QObject *parent = 0);
+    ~GroupCache();
+
+    /*!
+     * \brief Starts loading the groups, modelReady() is emitted when done.
+     */
+    bool getGroups();
+    bool isReady() const;
+
+    CommHistory::Group group(const QModelIndex &index) const;
+    CommHistory::Group groupById(int id) const;
+
+    bool addGroup(CommHistory::Group &group);
+    bool modifyGroup(CommHistory::Group &group);
+    bool deleteGroups(const QList<int> &groupIds);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+
+Q_SIGNALS:
+    void modelReady(bool successful);
+
+    /*!
+     * \brief Passes on added and updated groups with all their
+     * properties, before the cached rows are updated.
+     */
+    void groupsUpdated(const QList<CommHistory::Group> &groups);
+
+private Q_SLOTS:
+    void onLoaderReady(bool successful);
+    void onGroupAdded(const CommHistory::Group &group);
+    void onGroupsUpdatedFull(const QList<CommHistory::Group> &groups);
+    void onGroupsDeleted(const QList<int> &groupIds);
+
+private:
+    struct Entry {
+        int id;
+        int localUid;           // m_strings index
+        int chatName;           // m_strings index
+        int firstRemoteUid;     // m_remoteUids index
+        int remoteUidCount;
+        int chatType;
+    };
+
+    int intern(const QString &string);
+    void release(int id);
+    void releaseStrings(const Entry &entry);
+    void store(Entry &entry, const CommHistory::Group &group);
+    void upsert(const CommHistory::Group &group);
+    void removeRow(int row);
+    void compactRemoteUids();
+    CommHistory::Group groupAt(int row) const;
+
+    QVector<Entry> m_entries;
+    QHash<int, int> m_rows;     // group id => row
+    QVector<int> m_remoteUids;
+    int m_unusedRemoteUids;
+    QStringList m_strings;
+    QVector<int> m_stringRefs;
+    QList<int> m_freeStrings;   // m_strings indexes without references
+    QHash<QString, int> m_stringIds;
+    CommHistory::GroupModel *m_loader;
+    bool m_ready;
+};
+
+} // namespace RTComLogger
+
+#endif // GROUPCACHE_H
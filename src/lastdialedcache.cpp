@@ -26,13 +26,29 @@
 #include <QSaveFile>
 #include <QStandardPaths>
 
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
 using namespace RTComLogger;
 using namespace CommHistory;
 
+// Number of dialed calls kept in the ring
+static const int kRingCapacity = 8;
+// Model changes within this time are written out together
+static const int kFlushDelayMs = 500;
+
 LastDialedCache::LastDialedCache(QObject *parent)
-    : QObject(parent)
+    : QObject(parent), entriesValid(false), ring(0), ringSize(0)
 {
     filePath = QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + "/last-dialed";
+    ringPath = filePath + "-ring";
+
+    flushTimer.setSingleShot(true);
+    flushTimer.setInterval(kFlushDelayMs);
+    connect(&flushTimer, SIGNAL(timeout()), SLOT(flush()));
 
     model = new CallModel(this);
     connect(model, SIGNAL(modelReset()), SLOT(onModelReset()));
@@ -42,36 +58,86 @@ LastDialedCache::LastDialedCache(QObject *parent)
     model->setTreeMode(false);
     model->setSorting(CallModel::SortByTime);
     model->setFilterType(CallEvent::DialedCallType);
-    model->setLimit(1);
+    model->setLimit(kRingCapacity);
     model->getEvents();
+
+    ShutdownCoordinator::instance()->addParticipant(QLatin1String("LastDialedCache"), this);
+}
+
+LastDialedCache::~LastDialedCache()
+{
+    ShutdownCoordinator::removeParticipant(this);
+
+    if (ring)
+        munmap(ring, ringSize);
+}
+
+void LastDialedCache::drain()
+{
+    if (flushTimer.isActive()) {
+        flushTimer.stop();
+        flush();
+    }
 }
 
+QVariantMap LastDialedCache::pendingWork() const
+{
+    QVariantMap work;
+    work.insert(QLatin1String("unflushedChanges"), flushTimer.isActive() ? 1 : 0);
+    return work;
+}
+
+// The timer isn't restarted, so a steady stream of changes is still
+// written out every kFlushDelayMs
 void LastDialedCache::onRowsInserted(const QModelIndex &parent, int start, int end)
 {
     Q_UNUSED(parent);
+    Q_UNUSED(start);
     Q_UNUSED(end);
 
-    if (start == 0)
-        writeLastDialed(model->event(model->index(0, 0)).recipients().value(0).remoteUid());
+    if (!flushTimer.isActive())
+        flushTimer.start();
 }
 
 void LastDialedCache::onRowsRemoved(const QModelIndex &parent, int start, int end)
 {
     Q_UNUSED(parent);
+    Q_UNUSED(start);
     Q_UNUSED(end);
 
-    if (model->rowCount() == 0)
-        removeLastDialed();
-    else if (start == 0)
-        writeLastDialed(model->event(model->index(0, 0)).recipients().value(0).remoteUid());
+    if (!flushTimer.isActive())
+        flushTimer.start();
 }
 
 void LastDialedCache::onModelReset()
 {
-    if (model->rowCount() == 0)
+    if (!flushTimer.isActive())
+        flushTimer.start();
+}
+
+void LastDialedCache::flush()
+{
+    QList<Entry> newEntries;
+    const int count = qMin(model->rowCount(), kRingCapacity);
+    for (int i = 0; i < count; i++) {
+        Event event(model->event(model->index(i, 0)));
+        newEntries.append(Entry(event.recipients().value(0).remoteUid(),
+                                event.startTime().toMSecsSinceEpoch()));
+    }
+
+    if (entriesValid && newEntries == entries) {
+        qCDebug(lcCall) << "Last dialed numbers unchanged";
+        return;
+    }
+
+    if (newEntries.isEmpty())
         removeLastDialed();
-    else
-        writeLastDialed(model->event(model->index(0, 0)).recipients().value(0).remoteUid());
+    else if (!entriesValid || entries.isEmpty() || newEntries.first().first != entries.first().first)
+        writeLastDialed(newEntries.first().first);
+
+    writeRing(newEntries);
+    entries = newEntries;
+    entriesValid = true;
 }
 
 void LastDialedCache::writeLastDialed(const QString &number)
@@ -82,7 +148,7 @@ void LastDialedCache::writeLastDialed(const QString &number)
         return;
     }
 
-    DEBUG() << "Writing last dialed number to file:" << number;
+    qCDebug(lcCall) << "Writing last dialed number to file:" << number;
     file.write(number.toLatin1());
     if (!file.commit())
         qWarning() << "Writing last dialed cache failed:" << file.errorString();
@@ -90,7 +156,94 @@ void LastDialedCache::writeLastDialed(const QString &number)
 
 void LastDialedCache::removeLastDialed()
 {
-    DEBUG() << "Removing last dialed number file";
+    qCDebug(lcCall) << "Removing last dialed number file";
     QFile::remove(filePath);
 }
 
+bool LastDialedCache::mapRing()
+{
+    if (ring)
+        return true;
+
+    QByteArray path(QFile::encodeName(ringPath));
+    int fd = open(path.constData(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        qWarning() << "Cannot open last dialed ring:" << strerror(errno);
+        return false;
+    }
+
+    size_t size = sizeof(LastDialedRingHeader) + kRingCapacity * sizeof(LastDialedRingEntry);
+    if (ftruncate(fd, size) < 0) {
+        qWarning() << "Cannot resize last dialed ring:" << strerror(errno);
+        close(fd);
+        return false;
+    }
+
+    void *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        qWarning() << "Cannot map last dialed ring:" << strerror(errno);
+        return false;
+    }
+
+    ring = static_cast<LastDialedRingHeader*>(map);
+    ringSize = size;
+
+    // Left over from a different layout, start over
+    if (memcmp(ring->magic, "LDR1", 4) || ring->capacity != (quint32)kRingCapacity ||
+            ring->entrySize != sizeof(LastDialedRingEntry)) {
+        memset(map, 0, size);
+        ring->capacity = kRingCapacity;
+        ring->entrySize = sizeof(LastDialedRingEntry);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        memcpy(ring->magic, "LDR1", 4);
+    }
+    return true;
+}
+
+void LastDialedCache::writeRing(const QList<Entry> &newEntries)
+{
+    if (!mapRing())
+        return;
+
+    // Usually some calls were added on top of what is already there,
+    // in which case only the new entries need to be written
+    const int count = newEntries.count();
+    int added = 0;
+    if (entriesValid && (quint32)entries.count() == ring->count) {
+        for (int k = 1; k < count; k++) {
+            if (newEntries.mid(k) == entries.mid(0, count - k)) {
+                added = k;
+                break;
+            }
+        }
+    }
+
+    LastDialedRingEntry *slots = reinterpret_cast<LastDialedRingEntry*>(ring + 1);
+    quint64 sequence = ring->sequence;
+    __atomic_store_n(&ring->sequence, sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    quint32 head;
+    int first;
+    if (added) {
+        head = (ring->head + added) % kRingCapacity;
+        first = added - 1;
+    } else {
+        head = count ? count - 1 : 0;
+        first = count - 1;
+    }
+    for (int i = first; i >= 0; i--) {
+        LastDialedRingEntry *slot = slots + (head + kRingCapacity - i) % kRingCapacity;
+        QByteArray number(newEntries.at(i).first.toUtf8().left(sizeof(slot->number)));
+        memset(slot, 0, sizeof(*slot));
+        slot->timestamp = newEntries.at(i).second;
+        slot->length = number.size();
+        memcpy(slot->number, number.constData(), number.size());
+    }
+    ring->head = head;
+    ring->count = count;
+
+    __atomic_store_n(&ring->sequence, sequence + 2, __ATOMIC_RELEASE);
+    qCDebug(lcCall) << "Updated last dialed ring:" << count << "entries," << (added ? added : count) << "written";
+}
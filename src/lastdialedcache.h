@@ -24,34 +24,79 @@
 #define LASTDIALEDCACHE_H
 
 #include <QObject>
+#include <QList>
+#include <QPair>
+#include <QTimer>
 #include <CommHistory/CallModel>
+#include "shutdowncoordinator.h"
 
 namespace RTComLogger {
 
+/* Layout of the last dialed ring, a small memory mapped file next to
+ * the last dialed cache file. Readers map it read-only and use the
+ * sequence as a seqlock: it is odd while an update is in progress, and
+ * a reader retries if it changed while the entries were being copied.
+ * All fields are in host byte order.
+ */
+struct LastDialedRingHeader {
+    char magic[4];          // "LDR1"
+    quint32 capacity;       // Number of entries in the file
+    quint32 entrySize;      // sizeof(LastDialedRingEntry)
+    quint32 count;          // Number of valid entries
+    quint32 head;           // Index of the most recent entry
+    quint32 reserved;
+    quint64 sequence;       // Incremented before and after every update
+};
+
+struct LastDialedRingEntry {
+    qint64 timestamp;       // Start time in ms since the epoch
+    quint32 length;         // Number of bytes used in number
+    char number[52];        // UTF-8, not terminated
+};
+
 /* Write the last dialed number from the call log to a cache file,
  * and update the number when items are removed from the call log.
  *
  * This is a hack to provide functionality necessary for bluez,
  * which is otherwise unable to access commhistory data in any sane way.
+ *
+ * The last few dialed numbers are also kept in a memory mapped ring
+ * (see LastDialedRingHeader) for quick redial without going through
+ * the database.
  */
-class LastDialedCache : public QObject
+class LastDialedCache : public QObject, public ShutdownParticipant
 {
     Q_OBJECT
 
 public:
     LastDialedCache(QObject *parent);
+    ~LastDialedCache();
+
+    void drain();
+    QVariantMap pendingWork() const;
 
 private slots:
     void onRowsInserted(const QModelIndex &parent, int start, int end);
     void onRowsRemoved(const QModelIndex &parent, int start, int end);
     void onModelReset();
+    void flush();
 
 private:
+    typedef QPair<QString, qint64> Entry;
+
     QString filePath;
+    QString ringPath;
     CommHistory::CallModel *model;
+    QTimer flushTimer;
+    QList<Entry> entries;
+    bool entriesValid;
+    LastDialedRingHeader *ring;
+    size_t ringSize;
 
     void writeLastDialed(const QString &number);
     void removeLastDialed();
+    bool mapRing();
+    void writeRing(const QList<Entry> &newEntries);
 };
 
 }
@@ -21,6 +21,7 @@
 ******************************************************************************/
 
 #include <signal.h>
+#include <stdio.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <syslog.h>
@@ -37,11 +38,19 @@
 #include "accountpresenceservice.h"
 #include "accountpresenceifadaptor.h"
 #include "messagereviver.h"
+#include "metrics.h"
+#include "stalldetector.h"
+#include "trafficrecorder.h"
 #include "contactauthorizationlistener.h"
 #include "connectionutils.h"
 #include "lastdialedcache.h"
 #include "accountoperationsobserver.h"
 #include "fscleanup.h"
+#include "calljournal.h"
+#include "eventmodelpool.h"
+#include "startupscheduler.h"
+#include "shutdowncoordinator.h"
+#include "asynclogger.h"
 #include "mmshandler.h"
 #include "mmshandler_adaptor.h"
 #include "smartmessaging.h"
@@ -53,52 +62,42 @@ using namespace RTComLogger;
 
 namespace {
 
+// Which messages get here is decided by the category filter rules, see
+// setLogLevel()
 void messageHandler(QtMsgType type, const QMessageLogContext &, const QString &message)
 {
-    if (!toggleDebug)
-        return;
-
-#ifndef QT_DEBUG
-    if (!(type == QtCriticalMsg || type == QtFatalMsg))
-        return;
-#endif
-
-    const char *logLevel = "";
     int priority = LOG_DEBUG;
 
     switch (type) {
     case QtDebugMsg:
-        // don't use any prefix for debug messages
         priority = LOG_DEBUG;
         break;
+    case QtInfoMsg:
+        priority = LOG_INFO;
+        break;
     case QtWarningMsg:
-        logLevel = "Warning: ";
         priority = LOG_WARNING;
         break;
     case QtCriticalMsg:
-        logLevel = "CRITICAL: ";
         priority = LOG_CRIT;
         break;
     case QtFatalMsg:
-        logLevel = "FATAL: ";
         priority = LOG_ALERT;
         break;
     default:
         break;
     }
 
-    const QByteArray &msgData(message.toLocal8Bit());
-    const char *msg = msgData.constData();
-
-    QByteArray timestamp = QLocale::c().toString(QDateTime::currentDateTime(), "ss:zzz").toLocal8Bit();
-    syslog(LOG_MAKEPRI(LOG_USER, priority),
-           "%s [%s] %s",
-           logLevel,
-           timestamp.constData(),
-           msg);
-
-    if (type == QtFatalMsg)
+    // Formatting and writing happens in the logger thread
+    AsyncLogger *logger = AsyncLogger::instance();
+    if (type == QtFatalMsg) {
+        // Write out what led here, and the message itself synchronously
+        logger->stop();
+        logger->log(priority, message.toLocal8Bit());
         abort();
+    }
+
+    logger->log(priority, message.toLocal8Bit());
 }
 
 // handle SIGTERM to cleanup on exit
@@ -131,11 +130,9 @@ Q_DECL_EXPORT int main(int argc, char **argv)
 {
     QCoreApplication app(argc, argv);
 
-    if (argc > 1) {
-        if (strcmp(argv[1],"-d") == 0) {
-            toggleDebug = true;
-        }
-    }
+    if (app.arguments().contains(QLatin1String("-d")))
+        toggleDebug = true;
+    const bool startupBenchmark = app.arguments().contains(QLatin1String("--startup-benchmark"));
 
     int logOption = LOG_NDELAY;
 
@@ -146,6 +143,21 @@ Q_DECL_EXPORT int main(int argc, char **argv)
 
     openlog("COMMHISTORYD", logOption, 0);
 
+    // Everything is off unless started with -d, release builds then only
+    // log critical messages. Levels can be changed over D-Bus later.
+    if (toggleDebug) {
+#ifdef QT_DEBUG
+        setLogLevel(QLatin1String("all"), QLatin1String("debug"));
+#else
+        setLogLevel(QLatin1String("all"), QLatin1String("critical"));
+#endif
+        int logFileIndex = app.arguments().indexOf(QLatin1String("--log-file"));
+        AsyncLogger::instance()->start(logFileIndex > 0 && logFileIndex + 1 < app.arguments().count()
+                                       ? app.arguments().at(logFileIndex + 1) : QString());
+    } else {
+        setLogLevel(QLatin1String("all"), QLatin1String("off"));
+    }
+
     qInstallMessageHandler(messageHandler);
 
     DEBUG() << "MApplication created";
@@ -153,8 +165,13 @@ Q_DECL_EXPORT int main(int argc, char **argv)
     if (::socketpair(AF_UNIX, SOCK_STREAM, 0, sigtermFd))
        qFatal("Couldn't create TERM socketpair");
 
-    QSocketNotifier *snTerm = new QSocketNotifier(sigtermFd[1], QSocketNotifier::Read, &app);
-    QObject::connect(snTerm, SIGNAL(activated(int)), &app, SLOT(quit()));
+    // Pending work is written out before quitting, within the deadline
+    ShutdownCoordinator *shutdown = ShutdownCoordinator::instance();
+    int deadlineIndex = app.arguments().indexOf(QLatin1String("--shutdown-deadline"));
+    if (deadlineIndex > 0 && deadlineIndex + 1 < app.arguments().count())
+        shutdown->setDeadline(app.arguments().at(deadlineIndex + 1).toInt());
+    shutdown->setSignalSocket(sigtermFd[1]);
+    QObject::connect(shutdown, SIGNAL(finished(QVariantMap)), &app, SLOT(quit()));
     setupSigtermHandler();
 
     QScopedPointer<QTranslator> engineeringEnglish(new QTranslator);
@@ -165,58 +182,133 @@ Q_DECL_EXPORT int main(int argc, char **argv)
     app.installTranslator(engineeringEnglish.data());
     app.installTranslator(translator.data());
 
-    CommHistoryService *chService = CommHistoryService::instance();
-    if (!chService->isRegistered()) {
-        qCritical() << "CommHistoryService registration failed (already running or DBus not found), exiting";
-        _exit(1);
+    StartupScheduler *startup = new StartupScheduler(&app);
+
+    Metrics *metrics = Metrics::instance();
+    metrics->addSource(QStringLiteral("startup"), [startup]() { return startup->timings(); });
+    metrics->addSource(QStringLiteral("eventModelPool"), []() {
+        EventModelPool *pool = EventModelPool::instance();
+        return pool ? pool->statistics() : QVariantMap();
+    });
+    int statisticsIndex = app.arguments().indexOf(QLatin1String("--statistics-interval"));
+    if (statisticsIndex > 0 && statisticsIndex + 1 < app.arguments().count())
+        metrics->setDumpInterval(app.arguments().at(statisticsIndex + 1).toInt() * 1000);
+
+    int stallIndex = app.arguments().indexOf(QLatin1String("--stall-threshold"));
+    if (stallIndex > 0 && stallIndex + 1 < app.arguments().count()) {
+        StallDetector *stalls = new StallDetector(app.arguments().at(stallIndex + 1).toInt(), &app);
+        metrics->addSource(QStringLiteral("stalls"), [stalls]() { return stalls->statistics(); });
     }
-    new CommHistoryIfAdaptor(chService);
+
+    // Inputs are captured for bm_replay before any of them can arrive
+    int recordIndex = app.arguments().indexOf(QLatin1String("--record"));
+    if (recordIndex > 0 && recordIndex + 1 < app.arguments().count())
+        TrafficRecorder::instance()->start(app.arguments().at(recordIndex + 1));
+
+    // Only what is needed to accept channels and MMS engine calls is set
+    // up before entering the main loop, the rest follows in stages.
+    startup->runNow("CommHistoryService", []() {
+        CommHistoryService *chService = CommHistoryService::instance();
+        if (!chService->isRegistered()) {
+            qCritical() << "CommHistoryService registration failed (already running or DBus not found), exiting";
+            _exit(1);
+        }
+        new CommHistoryIfAdaptor(chService);
+    });
     DEBUG() << "CommHistoryService created";
 
-    ConnectionUtils *utils = new ConnectionUtils(&app);
+    ConnectionUtils *utils = 0;
+    startup->runNow("AccountPresenceService", [&]() {
+        utils = new ConnectionUtils(&app);
 
-    // ContactAuthorizationListener needs to be updated with nemo-notifications and new UI handling
-    //new ContactAuthorizationListener(utils, chService);
+        // ContactAuthorizationListener needs to be updated with nemo-notifications and new UI handling
+        //new ContactAuthorizationListener(utils, chService);
 
-    AccountPresenceService *apService = new AccountPresenceService(utils->accountManager(), &app);
-    if (!apService->isRegistered()) {
-        qCritical() << "AccountPresenceService registration failed (already running or DBus not found), exiting";
-        _exit(1);
-    }
-    new AccountPresenceIfAdaptor(apService);
+        AccountPresenceService *apService = new AccountPresenceService(utils->accountManager(), &app);
+        if (!apService->isRegistered()) {
+            qCritical() << "AccountPresenceService registration failed (already running or DBus not found), exiting";
+            _exit(1);
+        }
+        new AccountPresenceIfAdaptor(apService);
+    });
     DEBUG() << "AccountPresenceService created";
 
-    MessageReviver *reviver = new MessageReviver(utils, &app);
-    DEBUG() << "Message reviver created, starting main loop";
+    // Finish call events of calls that were ongoing when we died
+    startup->runNow("CallJournal", []() {
+        CallJournal::instance()->replay();
+    });
 
-    if (toggleDebug) {
-        Tp::enableDebug(true);
-        Tp::enableWarnings(true);
-    }
-    new Logger(utils->accountManager(),
-               reviver,
-               &app);
+    // Models are set up once the main loop is idle
+    EventModelPool::instance();
+
+    startup->runNow("Logger", [&]() {
+        MessageReviver *reviver = new MessageReviver(utils, &app);
+        DEBUG() << "Message reviver created, starting main loop";
+
+        if (toggleDebug) {
+            Tp::enableDebug(true);
+            Tp::enableWarnings(true);
+        }
+        new Logger(utils->accountManager(),
+                   reviver,
+                   &app);
+    });
     DEBUG() << "Logger created";
 
-    NotificationManager::instance();
-    DEBUG() << "NotificationManager created";
+    startup->runNow("MmsHandler", [&]() {
+        MmsHandler *mmsHandler = new MmsHandler(&app);
+        new MmsHandlerAdaptor(mmsHandler);
+        metrics->addSource(QStringLiteral("mmsDuplicateFilter"), [mmsHandler]() {
+            return mmsHandler->duplicateFilterStatistics();
+        });
+    });
 
-    new LastDialedCache(&app);
-    DEBUG() << "LastDialedCache created";
+    startup->schedule(StartupScheduler::HighPriority, "NotificationManager", []() {
+        NotificationManager::instance();
+        DEBUG() << "NotificationManager created";
+    });
 
     // Init account operations observer to monitor account removals and to react to them.
-    new AccountOperationsObserver(utils->accountManager(), &app);
+    startup->schedule(StartupScheduler::HighPriority, "AccountOperationsObserver", [&]() {
+        new AccountOperationsObserver(utils->accountManager(), &app);
+    });
 
-    new MmsHandlerAdaptor(new MmsHandler(&app));
-    new SmartMessaging(&app);
-    new FsCleanup(&app);
+    startup->schedule(StartupScheduler::NormalPriority, "SmartMessaging", [&]() {
+        new SmartMessaging(&app);
+    });
+
+    startup->schedule(StartupScheduler::NormalPriority, "LastDialedCache", [&]() {
+        new LastDialedCache(&app);
+        DEBUG() << "LastDialedCache created";
+    });
+
+    startup->schedule(StartupScheduler::LowPriority, "FsCleanup", [&]() {
+        FsCleanup *cleanup = new FsCleanup(&app);
+        metrics->addSource(QStringLiteral("fsCleanup"), [cleanup]() { return cleanup->statistics(); });
+    });
+
+    startup->start();
+
+    // Measure the startup and exit, used by the startup-benchmark target
+    if (startupBenchmark)
+        QObject::connect(startup, SIGNAL(finished()), &app, SLOT(quit()));
 
     int result = app.exec();
 
+    if (startupBenchmark) {
+        const QVariantMap timings(startup->timings());
+        for (QVariantMap::const_iterator it = timings.constBegin(); it != timings.constEnd(); ++it)
+            printf("%s: %lld ms\n", qPrintable(it.key()), it.value().toLongLong());
+    }
+
     close(sigtermFd[0]);
     close(sigtermFd[1]);
 
     DEBUG() << "exit";
 
+    TrafficRecorder::instance()->stop();
+
+    AsyncLogger::instance()->stop();
+
     return result;
 }
@@ -80,16 +80,27 @@ bool MessageHandlerBase::setGroupForEvent(Event& event)
         }
     }
 
-    GroupObject* group = groupManager->findGroup(event.localUid(), event.recipients().value(0).remoteUid());
+    QStringList remoteUids;
+    const RecipientList &recipients(event.recipients());
+    for (int i = 0; i < recipients.count(); i++)
+        remoteUids.append(recipients.value(i).remoteUid());
+
+    // Single recipient is the common case, multiple recipients only
+    // happen with group MMS
+    GroupObject* group = (remoteUids.count() > 1) ?
+        groupManager->findGroup(event.localUid(), remoteUids) :
+        groupManager->findGroup(event.localUid(), remoteUids.value(0));
     if (group) {
         event.setGroupId(group->id());
         return true;
     }
 
-    DEBUG() << "Creating new group for event" << event.recipients().value(0).remoteUid();
+    DEBUG() << "Creating new group for event" << remoteUids;
     Group newGroup;
     newGroup.setLocalUid(event.localUid());
-    newGroup.setRecipients(Recipient(event.localUid(), event.recipients().value(0).remoteUid()));
+    newGroup.setRecipients(RecipientList::fromUids(event.localUid(), remoteUids));
+    if (remoteUids.count() > 1)
+        newGroup.setChatType(Group::ChatTypeUnnamed);
     if (!groupManager->addGroup(newGroup)) {
         qCritical() << "Failed adding new group for event" << newGroup.toString();
         return false;
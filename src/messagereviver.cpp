@@ -29,23 +29,49 @@
 #include "constants.h"
 #include "messagereviver.h"
 #include "connectionutils.h"
+#include "databasereader.h"
+#include "dbuscallstats.h"
 #include "debug.h"
 
 using namespace RTComLogger;
 using namespace CommHistory;
 
-#define STORED_MESSAGES_CHECK_INTERVAL 30000 //msec
+// The token set is rechecked with exponential backoff until it is stable
+#define STORED_MESSAGES_CHECK_INTERVAL 10000 //msec
+#define STORED_MESSAGES_MAX_CHECK_INTERVAL 300000 //msec
 #define MAX_RETRIES 10
+// StoredMessages fetches in flight over all connections
+#define MAX_CONCURRENT_FETCHES 2
+// Keeps the D-Bus messages to the connection manager reasonably sized
+#define MAX_TOKENS_PER_CALL 100
 
 MessageReviver::MessageReviver(ConnectionUtils *connectionUtils,
                                QObject *parent) :
-    QObject(parent)
+    QObject(parent),
+    m_Reader(0)
 {
     connect(connectionUtils,
             SIGNAL(connectionReady(Tp::ConnectionPtr)),
             SLOT(checkConnection(Tp::ConnectionPtr)));
 }
 
+MessageReviver::~MessageReviver()
+{
+    delete m_Reader;
+}
+
+DatabaseReader *MessageReviver::reader()
+{
+    // Retried while the database doesn't exist yet
+    if (m_Reader && !m_Reader->isOpen()) {
+        delete m_Reader;
+        m_Reader = 0;
+    }
+    if (!m_Reader)
+        m_Reader = new DatabaseReader(QLatin1String("commhistoryd-reviver"));
+    return m_Reader;
+}
+
 void MessageReviver::checkConnection(const Tp::ConnectionPtr& connection)
 {
     if (!connection.isNull()
@@ -61,16 +87,36 @@ void MessageReviver::checkConnection(const Tp::ConnectionPtr& connection)
 bool MessageReviver::isConnectionHandled(const Tp::ConnectionPtr &connection)
 {
     return m_Connections.key(connection) != 0
-           || m_TimerConnections.key(connection) != 0;
+           || m_TimerConnections.key(connection) != 0
+           || m_FetchQueue.contains(connection);
 }
 
 void MessageReviver::fetchMessages(const Tp::ConnectionPtr &connection)
 {
+    // Avoid flooding the bus when many accounts connect at once
+    if (m_Connections.size() >= MAX_CONCURRENT_FETCHES) {
+        qCDebug(lcReviver) << "Queueing stored messages fetch for" << connection->objectPath();
+        if (!m_FetchQueue.contains(connection))
+            m_FetchQueue.append(connection);
+        return;
+    }
+
+    CommHistoryTp::Client::ConnectionInterfaceStoredMessagesInterface* storedMessages =
+            connection->interface<CommHistoryTp::Client::ConnectionInterfaceStoredMessagesInterface>();
+    if (storedMessages) {
+        // Tokens the listeners expunge no longer need to be checked
+        connect(storedMessages,
+                SIGNAL(MessagesExpunged(QStringList)),
+                SLOT(onMessagesExpunged(QStringList)),
+                Qt::UniqueConnection);
+    }
+
     Tp::Client::DBus::PropertiesInterface *props = connection->interface<Tp::Client::DBus::PropertiesInterface>();
 
     QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher
-        (props->Get(CommHistoryTp::Client::ConnectionInterfaceStoredMessagesInterface::staticInterfaceName(),
-                    QLatin1String("StoredMessages")),
+        (DBusCallStats::instance()->track(props->service(), QStringLiteral("Get StoredMessages"),
+            props->Get(CommHistoryTp::Client::ConnectionInterfaceStoredMessagesInterface::staticInterfaceName(),
+                       QLatin1String("StoredMessages"))),
          this);
 
     connect(watcher,
@@ -87,12 +133,81 @@ void MessageReviver::onGetStoredMessages(QDBusPendingCallWatcher *call)
     if (reply.isError()) {
         qWarning() << reply.error().name() << "-" << reply.error().message();
         call->deleteLater();
+        fetchNextQueued();
         return;
     }
 
     updateTokens(reply.value().variant().toStringList(), connection);
 
     call->deleteLater();
+    fetchNextQueued();
+}
+
+void MessageReviver::fetchNextQueued()
+{
+    while (!m_FetchQueue.isEmpty() && m_Connections.size() < MAX_CONCURRENT_FETCHES) {
+        Tp::ConnectionPtr connection = m_FetchQueue.takeFirst();
+        if (!connection.isNull() && connection->isValid())
+            fetchMessages(connection);
+    }
+}
+
+void MessageReviver::scheduleFetch(const Tp::ConnectionPtr &connection)
+{
+    const QString path(connection->objectPath());
+    int interval = m_Intervals.value(path, STORED_MESSAGES_CHECK_INTERVAL);
+    m_Intervals.insert(path, qMin(interval * 2, STORED_MESSAGES_MAX_CHECK_INTERVAL));
+
+    qCDebug(lcReviver) << "Checking stored messages of" << path << "again in" << interval << "ms";
+    int timerId = startTimer(interval);
+    if (timerId > 0) {
+        m_TimerConnections.insert(timerId, connection);
+    } else {
+        qWarning() << "Failed to start timer";
+    }
+}
+
+void MessageReviver::cancelFetch(const QString &objectPath)
+{
+    QHash<int, Tp::ConnectionPtr>::iterator it = m_TimerConnections.begin();
+    while (it != m_TimerConnections.end()) {
+        if (!it.value().isNull() && it.value()->objectPath() == objectPath) {
+            killTimer(it.key());
+            it = m_TimerConnections.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    m_Intervals.remove(objectPath);
+}
+
+void MessageReviver::onMessagesExpunged(const QStringList &tokens)
+{
+    // The token sets are left alone, updateTokens compares them with the
+    // next fetch to decide whether the connection manager has settled
+    QStringList drained;
+    QHash<QString, QSet<QString> >::const_iterator it = m_MessageTokens.constBegin();
+    for (; it != m_MessageTokens.constEnd(); ++it) {
+        QSet<QString> expunged = m_ExpungedTokens.value(it.key());
+        foreach (const QString &token, tokens) {
+            if (it.value().contains(token))
+                expunged.insert(token);
+        }
+        if (expunged.isEmpty())
+            continue;
+
+        m_ExpungedTokens.insert(it.key(), expunged);
+        if (expunged.size() == it.value().size())
+            drained << it.key();
+    }
+
+    // Everything was handled by the listeners, no need to check again
+    foreach (const QString &path, drained) {
+        qCDebug(lcReviver) << "Stored messages of" << path << "drained";
+        m_MessageTokens.remove(path);
+        m_ExpungedTokens.remove(path);
+        cancelFetch(path);
+    }
 }
 
 void MessageReviver::updateTokens(const QStringList &tokens,
@@ -103,7 +218,7 @@ void MessageReviver::updateTokens(const QStringList &tokens,
     bool modified = false;
 
     if (connection.isNull() || !connection->isValid()) {
-        DEBUG() << "Connection is not valid anymore, abort";
+        qCDebug(lcReviver) << "Connection is not valid anymore, abort";
         return;
     }
 
@@ -117,19 +232,24 @@ void MessageReviver::updateTokens(const QStringList &tokens,
         modified = (setSize != initialTokens.size());
     }
 
+    // Forget expunged tokens the connection manager no longer reports
+    QHash<QString, QSet<QString> >::iterator expunged = m_ExpungedTokens.find(connection->objectPath());
+    if (expunged != m_ExpungedTokens.end()) {
+        expunged.value().intersect(initialTokens);
+        if (expunged.value().isEmpty())
+            m_ExpungedTokens.erase(expunged);
+    }
+
     if (modified) {
         if (!initialTokens.isEmpty()) {
             m_MessageTokens.insert(connection->objectPath(), initialTokens);
-
-            int timerId = startTimer(STORED_MESSAGES_CHECK_INTERVAL);
-            if (timerId > 0) {
-                m_TimerConnections.insert(timerId, connection);
-            } else {
-                qWarning() << "Failed to start timer";
-            }
+            scheduleFetch(connection);
+        } else {
+            m_Intervals.remove(connection->objectPath());
         }
     } else if (!initialTokens.isEmpty()) {
         m_MessageTokens.insert(connection->objectPath(), initialTokens);
+        m_Intervals.remove(connection->objectPath());
         // get tp-glib connection to finally expunge/deliver messages
         handleMessages(connection);
     }
@@ -139,7 +259,9 @@ void MessageReviver::timerEvent(QTimerEvent *event)
 {
     Tp::ConnectionPtr connection = m_TimerConnections.take(event->timerId());
 
-    if (!connection.isNull() && connection->isValid())
+    // Skip the fetch if the tokens were drained meanwhile
+    if (!connection.isNull() && connection->isValid()
+        && m_MessageTokens.contains(connection->objectPath()))
         fetchMessages(connection);
 
     killTimer(event->timerId());
@@ -150,16 +272,30 @@ void MessageReviver::handleMessages(Tp::ConnectionPtr &connection)
     QStringList toRevive;
     QStringList toBury;
 
-    EventModel model;
-    QSet<QString> messageTokens = m_MessageTokens.take(connection->objectPath());
+    // Messages expunged by the listeners meanwhile are neither revived
+    // nor expunged again
+    QSet<QString> tokens = m_MessageTokens.take(connection->objectPath());
+    tokens.subtract(m_ExpungedTokens.take(connection->objectPath()));
+    QStringList messageTokens = tokens.toList();
+
+    QSet<QString> stored;
+    if (!reader()->existingMessageTokens(messageTokens, stored)) {
+        // Slow path, one query per token
+        stored.clear();
+        EventModel model;
+        foreach (QString token, messageTokens) {
+            Event event;
+            if (model.databaseIO().getEventByMessageToken(token, event))
+                stored.insert(token);
+        }
+    }
 
     foreach (QString token, messageTokens) {
-        Event event;
-        if (model.databaseIO().getEventByMessageToken(token, event)) {
-            DEBUG() << "bury " << token;
+        if (stored.contains(token)) {
+            qCDebug(lcReviver) << "bury " << token;
             toBury << token;
         } else {
-            DEBUG() << "revive " << token;
+            qCDebug(lcReviver) << "revive " << token;
             toRevive << token;
         }
     }
@@ -168,11 +304,14 @@ void MessageReviver::handleMessages(Tp::ConnectionPtr &connection)
             connection->interface<CommHistoryTp::Client::ConnectionInterfaceStoredMessagesInterface>();
 
     if (storedMessages) {
-        if (!toBury.isEmpty())
-            storedMessages->ExpungeMessages(toBury);
+        DBusCallStats *stats = DBusCallStats::instance();
+        for (int i = 0; i < toBury.size(); i += MAX_TOKENS_PER_CALL)
+            stats->track(storedMessages->service(), QStringLiteral("ExpungeMessages"),
+                         storedMessages->ExpungeMessages(toBury.mid(i, MAX_TOKENS_PER_CALL)));
 
-        if (!toRevive.isEmpty())
-            storedMessages->DeliverStoredMessages(toRevive);
+        for (int i = 0; i < toRevive.size(); i += MAX_TOKENS_PER_CALL)
+            stats->track(storedMessages->service(), QStringLiteral("DeliverStoredMessages"),
+                         storedMessages->DeliverStoredMessages(toRevive.mid(i, MAX_TOKENS_PER_CALL)));
     } else {
         qCritical() << Q_FUNC_INFO << "No StoredMessage if";
     }
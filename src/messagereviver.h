@@ -30,6 +30,8 @@ namespace CommHistory {
     class EventModel;
 }
 
+class DatabaseReader;
+
 namespace RTComLogger
 {
 class ConnectionUtils;
@@ -47,27 +49,41 @@ class MessageReviver : public QObject
 public:
     explicit MessageReviver(ConnectionUtils *connectionUtils,
                             QObject *parent = NULL);
+    ~MessageReviver();
 
 public Q_SLOTS:
     void checkConnection(const Tp::ConnectionPtr& connection);
 
 private Q_SLOTS:
     void onGetStoredMessages(QDBusPendingCallWatcher *call);
+    void onMessagesExpunged(const QStringList &tokens);
 private:
     void updateTokens(const QStringList &tokens, Tp::ConnectionPtr &connection);
     void fetchMessages(const Tp::ConnectionPtr &connection);
+    void fetchNextQueued();
+    void scheduleFetch(const Tp::ConnectionPtr &connection);
+    void cancelFetch(const QString &objectPath);
     void timerEvent(QTimerEvent *event);
     void handleMessages(Tp::ConnectionPtr &connection);
     bool isConnectionHandled(const Tp::ConnectionPtr &connection);
+    DatabaseReader *reader();
 
 protected:
     // keep connections while fetching stored messages
     QHash<QDBusPendingCallWatcher*, Tp::ConnectionPtr> m_Connections;
     // keep connections while waiting timer time outs
     QHash<int, Tp::ConnectionPtr> m_TimerConnections;
+    // connections waiting for a free fetch slot
+    QList<Tp::ConnectionPtr> m_FetchQueue;
     QHash<QString, QSet<QString> > m_MessageTokens;
+    // tokens of m_MessageTokens which the listeners have expunged
+    QHash<QString, QSet<QString> > m_ExpungedTokens;
 
     QHash<QString,int> m_Retries;
+    // current check interval of each connection, doubled on every recheck
+    QHash<QString,int> m_Intervals;
+    // opened on first use and kept for later connections
+    DatabaseReader *m_Reader;
 
 #ifdef UNIT_TEST
     friend class Ut_MessageReviver;
@@ -0,0 +1,120 @@
+/******************************************************************************
+**
+** This file is part of commhistory-daemon.
+**
+** Copyright (C) 2026 Jolla Ltd.
+**
+** This library is free software; you can redistribute it and/or modify it
+** under the terms of the GNU Lesser General Public License version 2.1 as
+** published by the Free Software Foundation.
+**
+** This library is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+** or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+** License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this library; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+**
+******************************************************************************/
+
+
+#include "messagetracer.h"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <unistd.h>
+
+using namespace RTComLogger;
+
+// About a thousand messages worth of steps
+#define TRACE_BUFFER_SIZE 8192
+
+MessageTracer* MessageTracer::instance()
+{
+    static MessageTracer* tracer = 0;
+    if (!tracer)
+        tracer = new MessageTracer;
+    return tracer;
+}
+
+MessageTracer::MessageTracer()
+    : m_records(TRACE_BUFFER_SIZE),
+      m_next(0),
+      m_wrapped(false)
+{
+    m_timer.start();
+}
+
+void MessageTracer::begin(const char *category, const QString &key, const char *name)
+{
+    add('b', category, key, name);
+}
+
+void MessageTracer::step(const char *category, const QString &key, const char *name)
+{
+    add('n', category, key, name);
+}
+
+void MessageTracer::end(const char *category, const QString &key, const char *name)
+{
+    add('e', category, key, name);
+}
+
+void MessageTracer::add(char phase, const char *category, const QString &key, const char *name)
+{
+    if (key.isEmpty())
+        return;
+
+    Record &record(m_records[m_next]);
+    record.timestampUs = m_timer.nsecsElapsed() / 1000;
+    record.category = category;
+    record.name = name;
+    record.phase = phase;
+    record.key = key;
+
+    if (++m_next == m_records.size()) {
+        m_next = 0;
+        m_wrapped = true;
+    }
+}
+
+QByteArray MessageTracer::chromeTrace() const
+{
+    const qint64 pid = getpid();
+    QJsonArray events;
+
+    // Oldest first
+    const int count = m_wrapped ? m_records.size() : m_next;
+    const int first = m_wrapped ? m_next : 0;
+    for (int i = 0; i < count; i++) {
+        const Record &record(m_records.at((first + i) % m_records.size()));
+
+        // Async events with the same category and id share a lane. The
+        // span is named after the category so that both ends match.
+        QJsonObject event;
+        if (record.phase == 'n') {
+            event.insert(QStringLiteral("name"), QLatin1String(record.name));
+        } else {
+            QJsonObject args;
+            args.insert(QStringLiteral("step"), QLatin1String(record.name));
+            event.insert(QStringLiteral("name"), QLatin1String(record.category));
+            event.insert(QStringLiteral("args"), args);
+        }
+        event.insert(QStringLiteral("cat"), QLatin1String(record.category));
+        event.insert(QStringLiteral("ph"), QString(QLatin1Char(record.phase)));
+        event.insert(QStringLiteral("id"), record.key);
+        event.insert(QStringLiteral("ts"), double(record.timestampUs));
+        event.insert(QStringLiteral("pid"), double(pid));
+        event.insert(QStringLiteral("tid"), 0);
+        events.append(event);
+    }
+
+    QJsonObject trace;
+    trace.insert(QStringLiteral("traceEvents"), events);
+    trace.insert(QStringLiteral("displayTimeUnit"), QStringLiteral("ms"));
+    return QJsonDocument(trace).toJson(QJsonDocument::Compact);
+}
@@ -0,0 +1,81 @@
+/******************************************************************************
+**
+** This file is part of commhistory-daemon.
+**
+** Copyright (C) 2026 Jolla Ltd.
+**
+** This library is free software; you can redistribute it and/or modify it
+** under the terms of the GNU Lesser General Public License version 2.1 as
+** published by the Free Software Foundation.
+**
+** This library is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+** or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+** License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this library; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+**
+******************************************************************************/
+
+
+#ifndef MESSAGETRACER_H
+#define MESSAGETRACER_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QString>
+#include <QVector>
+
+namespace RTComLogger
+{
+
+/*!
+ * \class MessageTracer
+ * \brief Records the steps of each message through the daemon, keyed by
+ * message token (or "mms:<event id>" for MMS).
+ *
+ * A message is a span from begin() to end() with step() marks between,
+ * each named after the step that was reached.
+ * The most recent TRACE_BUFFER_SIZE records are kept in memory and can
+ * be dumped in the Chrome trace event format (chrome://tracing,
+ * Perfetto), one lane per message. Names and categories must be string
+ * literals. Only used from the main thread.
+ */
+class MessageTracer
+{
+public:
+    static MessageTracer* instance();
+
+    void begin(const char *category, const QString &key, const char *name);
+    void step(const char *category, const QString &key, const char *name);
+    void end(const char *category, const QString &key, const char *name);
+
+    /*!
+     * \brief Buffered records as Chrome trace event JSON.
+     */
+    QByteArray chromeTrace() const;
+
+private:
+    MessageTracer();
+
+    struct Record {
+        qint64 timestampUs;
+        const char *category;
+        const char *name;
+        char phase;
+        QString key;
+    };
+
+    void add(char phase, const char *category, const QString &key, const char *name);
+
+    QElapsedTimer m_timer;
+    QVector<Record> m_records;
+    int m_next;
+    bool m_wrapped;
+};
+
+} // namespace RTComLogger
+
+#endif // MESSAGETRACER_H
@@ -0,0 +1,231 @@
+/******************************************************************************
+**
+** This file is part of commhistory-daemon.
+**
+** Copyright (C) 2026 Jolla Ltd.
+**
+** This library is free software; you can redistribute it and/or modify it
+** under the terms of the GNU Lesser General Public License version 2.1 as
+** published by the Free Software Foundation.
+**
+** This library is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+** or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+** License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this library; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+**
+******************************************************************************/
+
+
+#include "metrics.h"
+
+#include <QCoreApplication>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <syslog.h>
+
+using namespace RTComLogger;
+
+// Buckets for values below this are one wide
+#define LINEAR_BUCKETS 32
+// Buckets per power of two above LINEAR_BUCKETS
+#define SUB_BUCKETS 16
+// Enough for values up to 2^40 us, about 12 days
+#define MAX_SHIFT 36
+// Pending start() keys per histogram
+#define MAX_STARTED 1024
+
+static const char * const counterNames[] = {
+    "messagesReceived",
+    "messagesSent",
+    "deliveryReportsHandled",
+    "deliveryReportsPending",
+    "deliveryReportsFailed",
+    "commitBatches",
+    "committedEvents",
+    "saveFailures",
+    "saveRetries",
+    "notificationsPublished",
+    "notificationsSuppressed",
+    "expungeCalls",
+    "expungedMessages"
+};
+
+static const char * const histogramNames[] = {
+    "commitLatencyUs",
+    "notifyLatencyUs",
+    "mmsIngestLatencyUs"
+};
+
+LatencyHistogram::LatencyHistogram()
+    : m_buckets(LINEAR_BUCKETS + MAX_SHIFT * SUB_BUCKETS)
+{
+    reset();
+}
+
+int LatencyHistogram::bucketIndex(qint64 value)
+{
+    if (value < LINEAR_BUCKETS)
+        return qMax(qint64(0), value);
+
+    // Shift that brings the value to [SUB_BUCKETS, 2 * SUB_BUCKETS)
+    const int shift = qMin(63 - __builtin_clzll(value) - 4, MAX_SHIFT);
+    const int sub = qMin(value >> shift, qint64(2 * SUB_BUCKETS - 1));
+    return LINEAR_BUCKETS + (shift - 1) * SUB_BUCKETS + sub - SUB_BUCKETS;
+}
+
+qint64 LatencyHistogram::bucketValue(int index)
+{
+    if (index < LINEAR_BUCKETS)
+        return index;
+
+    const int shift = (index - LINEAR_BUCKETS) / SUB_BUCKETS + 1;
+    const qint64 sub = (index - LINEAR_BUCKETS) % SUB_BUCKETS + SUB_BUCKETS;
+    // Middle of the bucket
+    return (sub << shift) + (qint64(1) << shift) / 2;
+}
+
+void LatencyHistogram::record(qint64 value)
+{
+    m_buckets[qMin(bucketIndex(value), m_buckets.size() - 1)]++;
+    m_count++;
+    m_sum += value;
+    m_min = m_count == 1 ? value : qMin(m_min, value);
+    m_max = qMax(m_max, value);
+}
+
+void LatencyHistogram::reset()
+{
+    m_buckets.fill(0);
+    m_count = 0;
+    m_sum = 0;
+    m_min = 0;
+    m_max = 0;
+}
+
+qint64 LatencyHistogram::valueAtPercentile(double percentile) const
+{
+    if (!m_count)
+        return 0;
+
+    const qint64 wanted = qMax(qint64(1), qint64(percentile / 100.0 * m_count + 0.5));
+    qint64 seen = 0;
+    for (int i = 0; i < m_buckets.size(); i++) {
+        seen += m_buckets.at(i);
+        if (seen >= wanted)
+            return qBound(m_min, bucketValue(i), m_max);
+    }
+    return m_max;
+}
+
+QVariantMap LatencyHistogram::toMap() const
+{
+    QVariantMap map;
+    map.insert(QStringLiteral("count"), m_count);
+    map.insert(QStringLiteral("min"), m_min);
+    map.insert(QStringLiteral("max"), m_max);
+    map.insert(QStringLiteral("mean"), m_count ? m_sum / m_count : 0);
+    map.insert(QStringLiteral("p50"), valueAtPercentile(50));
+    map.insert(QStringLiteral("p90"), valueAtPercentile(90));
+    map.insert(QStringLiteral("p99"), valueAtPercentile(99));
+    map.insert(QStringLiteral("p999"), valueAtPercentile(99.9));
+    return map;
+}
+
+Metrics* Metrics::instance()
+{
+    static Metrics* metrics = 0;
+    if (!metrics)
+        metrics = new Metrics(QCoreApplication::instance());
+    return metrics;
+}
+
+Metrics::Metrics(QObject *parent)
+    : QObject(parent)
+{
+    for (int i = 0; i < CounterCount; i++)
+        m_counters[i] = 0;
+
+    m_clock.start();
+    connect(&m_dumpTimer, SIGNAL(timeout()), SLOT(dump()));
+}
+
+void Metrics::start(Histogram histogram, const QString &key)
+{
+    if (key.isEmpty())
+        return;
+
+    QHash<QString, qint64> &started(m_started[histogram]);
+    QMultiMap<qint64, QString> &order(m_startOrder[histogram]);
+
+    QHash<QString, qint64>::iterator it = started.find(key);
+    if (it != started.end()) {
+        order.remove(it.value(), key);
+        started.erase(it);
+    } else if (started.size() >= MAX_STARTED) {
+        // Oldest key whose end point was never reached
+        QMultiMap<qint64, QString>::iterator oldest = order.begin();
+        started.remove(oldest.value());
+        order.erase(oldest);
+    }
+
+    const qint64 now = m_clock.nsecsElapsed();
+    started.insert(key, now);
+    order.insert(now, key);
+}
+
+void Metrics::stop(Histogram histogram, const QString &key)
+{
+    QHash<QString, qint64>::iterator it = m_started[histogram].find(key);
+    if (it == m_started[histogram].end())
+        return;
+
+    record(histogram, (m_clock.nsecsElapsed() - it.value()) / 1000);
+    m_startOrder[histogram].remove(it.value(), key);
+    m_started[histogram].erase(it);
+}
+
+void Metrics::addSource(const QString &name, const std::function<QVariantMap()> &source)
+{
+    m_sources.append(qMakePair(name, source));
+}
+
+void Metrics::setDumpInterval(int msecs)
+{
+    if (msecs > 0) {
+        m_dumpTimer.start(msecs);
+    } else {
+        m_dumpTimer.stop();
+    }
+}
+
+QVariantMap Metrics::statistics() const
+{
+    QVariantMap counters;
+    for (int i = 0; i < CounterCount; i++)
+        counters.insert(QLatin1String(counterNames[i]), m_counters[i]);
+
+    QVariantMap histograms;
+    for (int i = 0; i < HistogramCount; i++)
+        histograms.insert(QLatin1String(histogramNames[i]), m_histograms[i].toMap());
+
+    QVariantMap result;
+    result.insert(QStringLiteral("uptimeMs"), m_clock.elapsed());
+    result.insert(QStringLiteral("counters"), counters);
+    result.insert(QStringLiteral("histograms"), histograms);
+
+    typedef QPair<QString, std::function<QVariantMap()> > Source;
+    foreach (const Source &source, m_sources)
+        result.insert(source.first, source.second());
+    return result;
+}
+
+void Metrics::dump()
+{
+    const QByteArray json(QJsonDocument(QJsonObject::fromVariantMap(statistics())).toJson(QJsonDocument::Compact));
+    syslog(LOG_MAKEPRI(LOG_USER, LOG_INFO), "statistics: %s", json.constData());
+}
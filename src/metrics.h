@@ -0,0 +1,160 @@
+/******************************************************************************
+**
+** This file is part of commhistory-daemon.
+**
+** Copyright (C) 2026 Jolla Ltd.
+**
+** This library is free software; you can redistribute it and/or modify it
+** under the terms of the GNU Lesser General Public License version 2.1 as
+** published by the Free Software Foundation.
+**
+** This library is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+** or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+** License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this library; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+**
+******************************************************************************/
+
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QPair>
+#include <QString>
+#include <QTimer>
+#include <QVariantMap>
+#include <QVector>
+
+#include <functional>
+
+namespace RTComLogger
+{
+
+/*!
+ * \class LatencyHistogram
+ * \brief Histogram with HDR-style log-linear buckets.
+ *
+ * Values below 32 get a bucket each, above that every power of two is
+ * split into 16 buckets, so any recorded value is reported within about
+ * 6% of its real value at a fixed memory cost.
+ */
+class LatencyHistogram
+{
+public:
+    LatencyHistogram();
+
+    void record(qint64 value);
+    void reset();
+
+    qint64 count() const { return m_count; }
+    qint64 valueAtPercentile(double percentile) const;
+
+    /*!
+     * \brief count, min, max, mean, p50, p90, p99 and p999.
+     */
+    QVariantMap toMap() const;
+
+private:
+    static int bucketIndex(qint64 value);
+    static qint64 bucketValue(int index);
+
+    QVector<quint32> m_buckets;
+    qint64 m_count;
+    qint64 m_sum;
+    qint64 m_min;
+    qint64 m_max;
+};
+
+/*!
+ * \class Metrics
+ * \brief Daemon-wide counters and latency histograms.
+ *
+ * Counters are plain integers, cheap enough for the message paths.
+ * Latencies between two points in different objects are measured with
+ * start() and stop() on a key such as the message token. Other objects
+ * can add their own statistics with addSource(). Everything is
+ * available through CommHistoryIf.getStatistics and can be written to
+ * syslog periodically. Only used from the main thread.
+ */
+class Metrics : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Counter {
+        MessagesReceived,
+        MessagesSent,
+        DeliveryReportsHandled,
+        // Deferred because the event was not committed yet
+        DeliveryReportsPending,
+        DeliveryReportsFailed,
+        CommitBatches,
+        CommittedEvents,
+        SaveFailures,
+        SaveRetries,
+        NotificationsPublished,
+        NotificationsSuppressed,
+        ExpungeCalls,
+        ExpungedMessages,
+        CounterCount
+    };
+
+    enum Histogram {
+        // addEvents() to eventsCommitted, us
+        CommitLatency,
+        // messageReceived to notification published, us
+        NotifyLatency,
+        // MMS messageReceived to parts stored, us
+        MmsIngestLatency,
+        HistogramCount
+    };
+
+    static Metrics* instance();
+
+    void increment(Counter counter, qint64 amount = 1) { m_counters[counter] += amount; }
+    void record(Histogram histogram, qint64 value) { m_histograms[histogram].record(value); }
+
+    /*!
+     * \brief Starts measuring \a histogram for \a key, stop() records the
+     * elapsed time. Keys that are never stopped are dropped oldest first.
+     */
+    void start(Histogram histogram, const QString &key);
+    void stop(Histogram histogram, const QString &key);
+
+    void addSource(const QString &name, const std::function<QVariantMap()> &source);
+
+    /*!
+     * \brief Writes the statistics to syslog every \a msecs, 0 disables.
+     */
+    void setDumpInterval(int msecs);
+
+    QVariantMap statistics() const;
+
+private Q_SLOTS:
+    void dump();
+
+private:
+    explicit Metrics(QObject *parent);
+
+    qint64 m_counters[CounterCount];
+    LatencyHistogram m_histograms[HistogramCount];
+    QHash<QString, qint64> m_started[HistogramCount];
+    // Start time to key, for dropping the oldest pending key
+    QMultiMap<qint64, QString> m_startOrder[HistogramCount];
+    QList<QPair<QString, std::function<QVariantMap()> > > m_sources;
+    QElapsedTimer m_clock;
+    QTimer m_dumpTimer;
+};
+
+} // namespace RTComLogger
+
+#endif // METRICS_H
@@ -21,6 +21,12 @@
 ******************************************************************************/
 
 #include "mmshandler.h"
+#include "eventmodelpool.h"
+#include "messagetracer.h"
+#include "metrics.h"
+#include "databasereader.h"
+#include "dbuscallstats.h"
+#include "trafficrecorder.h"
 #include "constants.h"
 #include "notificationmanager.h"
 #include "debug.h"
@@ -28,6 +34,7 @@
 #include <CommHistory/singleeventmodel.h>
 #include <CommHistory/mmsreadreportmodel.h>
 #include <CommHistory/commonutils.h>
+#include <CommHistory/group.h>
 #include <CommHistory/groupmanager.h>
 #include <CommHistory/constants.h>
 #include <CommHistory/mmsconstants.h>
@@ -35,7 +42,7 @@
 #include <QDBusMessage>
 #include <QDBusPendingCall>
 #include <QDBusPendingCallWatcher>
-#include <mdconfgroup.h>
+#include <mgconfitem.h>
 #include <qofonosimmanager.h>
 #include <qofononetworkregistration.h>
 #include <qofonoconnectionmanager.h>
@@ -44,13 +51,54 @@
 using namespace RTComLogger;
 using namespace CommHistory;
 
-#define DEBUG_(x) qDebug() << "MmsHandler:" << x
+#define DEBUG_(x) qCDebug(lcMms) << "MmsHandler:" << x
 
+static const QString kImsiSettingsPrefix("/imsi/");
 static const QString kSettingSendFlags("/mms/send-flags");
 static const QString kSettingAutomaticDownload("/mms/automatic-download");
 static const QString kSettingSendReadReports("/mms/send-read-reports");
 static const QString kNetworkStatusRoaming("roaming");
 static const char *kCallPropertyEventId = "mms-event-id";
+// Per-recipient delivery state of group messages, stored in event headers
+static const QString kHeaderDeliveryStatusPrefix("x-mms-delivery-status:");
+static const QString kDeliveryStatusPending("pending");
+static const QString kDeliveryStatusDelivered("delivered");
+static const QString kDeliveryStatusFailed("failed");
+// Messages are traced by event id, see MessageTracer
+static const QString kTracePrefix("mms:");
+// Transient receive states are stored only if they last this long
+static const int kReceiveStateDebounceMs = 3000;
+// Receive progress of events the engine has gone quiet about is dropped
+static const qint64 kReceiveStateExpiryMs = 30 * 60 * 1000;
+// Maximum number of sendReadReport calls waiting for the engine to reply
+static const int kMaxReadReportsInFlight = 4;
+// How long a submitted read report waits for readReportSendStatus
+static const qint64 kReadReportStatusTimeoutMs = 10 * 60 * 1000;
+
+// Calls from the MMS engine are captured for bm_replay
+static bool recordingEngineCalls()
+{
+    return TrafficRecorder::instance()->isRecording();
+}
+
+static void recordEngineCall(const char *method, const QVariantList &args)
+{
+    TrafficRecorder::instance()->record(TrafficRecorder::MmsEngineCall,
+                                        QVariantList() << QString::fromLatin1(method) << args);
+}
+
+// Group messages are notified in their own conversation, not in the
+// one with their first recipient
+static void showEventNotification(const Event &event, const QString &details = QString())
+{
+    if (event.recipients().count() > 1) {
+        NotificationManager::instance()->showNotification(event, QString::number(event.groupId()),
+                                                          Group::ChatTypeUnnamed, details);
+    } else {
+        NotificationManager::instance()->showNotification(event, event.recipients().value(0).remoteUid(),
+                                                          Group::ChatTypeP2P, details);
+    }
+}
 
 class MmsHandlerModem
 {
@@ -78,17 +126,72 @@ class MmsHandlerModem
     QOfonoConnectionManager *connection;
 };
 
+// Snapshot of the per-SIM MMS settings, kept up to date by dconf
+// change notifications so that lookups never hit the configuration.
+// Owns its MGConfItems; the settings themselves are owned by MmsHandler.
+class MmsHandlerImsiSettings
+{
+    public:
+
+    MmsHandlerImsiSettings(const QString &imsi, QObject *receiver) :
+        sendFlagsItem(new MGConfItem(kImsiSettingsPrefix + imsi + kSettingSendFlags)),
+        automaticDownloadItem(new MGConfItem(kImsiSettingsPrefix + imsi + kSettingAutomaticDownload)),
+        sendReadReportsItem(new MGConfItem(kImsiSettingsPrefix + imsi + kSettingSendReadReports))
+    {
+        QObject::connect(sendFlagsItem, SIGNAL(valueChanged()), receiver, SLOT(onImsiSettingChanged()));
+        QObject::connect(automaticDownloadItem, SIGNAL(valueChanged()), receiver, SLOT(onImsiSettingChanged()));
+        QObject::connect(sendReadReportsItem, SIGNAL(valueChanged()), receiver, SLOT(onImsiSettingChanged()));
+        refresh();
+    }
+
+    ~MmsHandlerImsiSettings()
+    {
+        delete sendFlagsItem;
+        delete automaticDownloadItem;
+        delete sendReadReportsItem;
+    }
+
+    bool hasItem(const QObject *item) const
+    {
+        return item == sendFlagsItem || item == automaticDownloadItem || item == sendReadReportsItem;
+    }
+
+    void refresh()
+    {
+        sendFlags = sendFlagsItem->value(0).toUInt();
+        automaticDownload = automaticDownloadItem->value(true).toBool();
+        sendReadReports = sendReadReportsItem->value(false).toBool();
+    }
+
+    MGConfItem *sendFlagsItem;
+    MGConfItem *automaticDownloadItem;
+    MGConfItem *sendReadReportsItem;
+    unsigned int sendFlags;
+    bool automaticDownload;
+    bool sendReadReports;
+};
+
 MmsHandler::MmsHandler(QObject* parent)
     : MessageHandlerBase(parent, MMS_HANDLER_PATH, MMS_HANDLER_SERVICE)
     , m_ofonoManager(QOfonoManager::instance())
     , m_ofonoExtModemManager(QOfonoExtModemManager::instance())
-    , m_imsiSettings(new MDConfGroup("/imsi", this))
+    , m_readReportsInFlight(0)
+    , m_readReportsDeferred(0)
+    , m_reader(0)
 {
+    m_receiveStateTimer.setSingleShot(true);
+    m_receiveStateTimer.setInterval(kReceiveStateDebounceMs);
+    connect(&m_receiveStateTimer, SIGNAL(timeout()), SLOT(onReceiveStateTimeout()));
+    m_readReportClock.start();
+
+    ShutdownCoordinator::instance()->addParticipant(QLatin1String("MmsHandler"), this);
+
     qDBusRegisterMetaType<MmsPart>();
     qDBusRegisterMetaType<MmsPartFd>();
     qDBusRegisterMetaType<MmsPartList>();
     qDBusRegisterMetaType<MmsPartFdList>();
     qDBusRegisterMetaType<QList<CommHistory::Event> >();
+    qDBusRegisterMetaType<QList<CommHistory::Group> >();
 
     QOfonoManager* ofonoManager = m_ofonoManager.data();
     connect(ofonoManager, SIGNAL(modemAdded(QString)), SLOT(onModemAdded(QString)));
@@ -110,12 +213,31 @@ MmsHandler::MmsHandler(QObject* parent)
     }
 }
 
+MmsHandler::~MmsHandler()
+{
+    ShutdownCoordinator::removeParticipant(this);
+    qDeleteAll(m_imsiSettings);
+    delete m_reader;
+}
+
+DatabaseReader *MmsHandler::reader()
+{
+    // Retried while the database doesn't exist yet
+    if (m_reader && !m_reader->isOpen()) {
+        delete m_reader;
+        m_reader = 0;
+    }
+    if (!m_reader)
+        m_reader = new DatabaseReader(QLatin1String("commhistoryd-mmshandler"));
+    return m_reader;
+}
+
 QDBusPendingCall MmsHandler::callEngine(const QString &method, const QVariantList &args)
 {
     QDBusMessage call(QDBusMessage::createMethodCall(MMS_ENGINE_SERVICE, MMS_ENGINE_PATH,
         MMS_ENGINE_INTERFACE, method));
     call.setArguments(args);
-    return MMS_ENGINE_BUS.asyncCall(call);
+    return DBusCallStats::instance()->track(MMS_ENGINE_SERVICE, method, MMS_ENGINE_BUS.asyncCall(call));
 }
 
 void MmsHandler::onOfonoAvailableChanged(bool available)
@@ -126,6 +248,7 @@ void MmsHandler::onOfonoAvailableChanged(bool available)
     } else {
         qDeleteAll(m_modems.values());
         m_modems.clear();
+        updateImsiIndex();
     }
 }
 
@@ -139,6 +262,7 @@ void MmsHandler::onModemRemoved(QString path)
 {
     DEBUG_("onModemRemoved" << path);
     delete m_modems.take(path);
+    updateImsiIndex();
 }
 
 
@@ -164,28 +288,70 @@ void MmsHandler::addModem(const QString &path)
                      SLOT(onStatusChanged(const QString &)));
     connect(m->connection, SIGNAL(roamingAllowedChanged(bool)),
                         SLOT(onRoamingAllowedChanged(bool)));
+    connect(m->sim, SIGNAL(validChanged(bool)), SLOT(onSimChanged()));
+    connect(m->sim, SIGNAL(subscriberIdentityChanged(QString)), SLOT(onSimChanged()));
+    updateImsiIndex();
 }
 
-QString MmsHandler::getModemPath(const CommHistory::Event &event) const
+void MmsHandler::onSimChanged()
 {
-    return getModemPath(event.subscriberIdentity());
+    updateImsiIndex();
 }
 
-QString MmsHandler::getModemPath(const QString &imsi) const
+void MmsHandler::updateImsiIndex()
 {
-    QString path;
+    m_imsiModems.clear();
 
     QHash<QString, MmsHandlerModem*>::const_iterator i = m_modems.constBegin();
     while (i != m_modems.constEnd()) {
         const MmsHandlerModem *m = i.value();
-        if (m->sim->isValid() && m->sim->subscriberIdentity() == imsi) {
-            path = m->sim->modemPath();
-            break;
+        if (m->sim->isValid()) {
+            const QString imsi(m->sim->subscriberIdentity());
+            if (!imsi.isEmpty())
+                m_imsiModems.insert(imsi, i.key());
+        }
+        ++i;
+    }
+
+    DEBUG_("IMSI index updated:" << m_imsiModems);
+
+    // Reports of a SIM that just appeared may be sendable now
+    if (!m_readReportQueue.isEmpty())
+        flushReadReports();
+}
+
+const MmsHandlerImsiSettings *MmsHandler::imsiSettings(const QString &imsi)
+{
+    MmsHandlerImsiSettings *settings = m_imsiSettings.value(imsi);
+    if (!settings) {
+        settings = new MmsHandlerImsiSettings(imsi, this);
+        m_imsiSettings.insert(imsi, settings);
+    }
+    return settings;
+}
+
+void MmsHandler::onImsiSettingChanged()
+{
+    const QObject *item = sender();
+    QHash<QString, MmsHandlerImsiSettings*>::const_iterator i = m_imsiSettings.constBegin();
+    while (i != m_imsiSettings.constEnd()) {
+        if (i.value()->hasItem(item)) {
+            DEBUG_("MMS settings changed for" << i.key());
+            i.value()->refresh();
+            return;
         }
         ++i;
     }
+}
 
-    return path;
+QString MmsHandler::getModemPath(const CommHistory::Event &event) const
+{
+    return getModemPath(event.subscriberIdentity());
+}
+
+QString MmsHandler::getModemPath(const QString &imsi) const
+{
+    return m_imsiModems.value(imsi);
 }
 
 QString MmsHandler::getDefaultVoiceSim() const
@@ -214,19 +380,20 @@ QString MmsHandler::messageNotification(const QString &imsi, const QString &from
         const QString &subject, uint expiry, const QByteArray &data,
         const QString &location)
 {
+    if (recordingEngineCalls()) {
+        recordEngineCall("messageNotification",
+                         QVariantList() << imsi << from << subject << expiry << data << location);
+    }
+
     QString modemPath = getModemPath(imsi);
     QString ringAccountPath = accountPath(modemPath);
     DEBUG_("got MMS message with imsi" << imsi
            << "modem path" << modemPath
            << "account path" << ringAccountPath);
 
-    if (!location.isEmpty()) {
-        Event event;
-        if (CommHistory::DatabaseIO::instance()->getEventByMmsId(location, event)) {
-            qWarning() << "MMS event" << location <<
-                          "is already in the database, id =" << event.id();
-            return QString();
-        }
+    if (!location.isEmpty() && m_locationFilter.contains(location)) {
+        qWarning() << "MMS event" << location << "is already in the database";
+        return QString();
     }
 
     Event event;
@@ -245,7 +412,7 @@ QString MmsHandler::messageNotification(const QString &imsi, const QString &from
 
     // The default action is to download MMS automatically
     const bool manualDownload = isDataProhibited(modemPath)
-                || !m_imsiSettings->value(imsi + kSettingAutomaticDownload, true).toBool();
+                || !imsiSettings(imsi)->automaticDownload;
 
     DEBUG_("manualDownload is" << manualDownload);
     event.setStatus(manualDownload ? Event::ManualNotificationStatus : Event::WaitingStatus);
@@ -255,12 +422,17 @@ QString MmsHandler::messageNotification(const QString &imsi, const QString &from
         return QString();
     }
 
-    EventModel model;
-    if (!model.addEvent(event)) {
+    PooledEventModel model;
+    if (!model->addEvent(event)) {
         qCritical() << "Failed to save MMS notification event; message dropped" << event.toString();
         return QString();
     }
 
+    if (!location.isEmpty())
+        m_locationFilter.insert(location, event.id(), event.groupId());
+
+    MessageTracer::instance()->begin("mms", kTracePrefix + QString::number(event.id()), "messageNotification");
+
     if (!manualDownload) {
         m_activeEvents.insert(modemPath, event.id());
     } else {
@@ -281,8 +453,88 @@ enum MessageReceiveState {
     Garbage
 };
 
+MmsHandler::ReceiveProgress *MmsHandler::receiveProgressEntry(int eventId)
+{
+    QHash<int, ReceiveProgress>::iterator it = m_receiveProgress.find(eventId);
+    if (it != m_receiveProgress.end()) {
+        it->updated.start();
+        return &it.value();
+    }
+
+    expireReceiveStates();
+
+    Event event;
+    SingleEventModel model;
+    if (model.getEventById(eventId))
+        event = model.event();
+
+    if (!event.isValid())
+        return 0;
+
+    ReceiveProgress progress;
+    progress.state = -1;
+    progress.status = event.status();
+    progress.storedStatus = event.status();
+    progress.bytesReceived = 0;
+    progress.bytesTotal = 0;
+    progress.updated.start();
+    return &m_receiveProgress.insert(eventId, progress).value();
+}
+
+void MmsHandler::expireReceiveStates()
+{
+    // The engine may never report a terminal state, e.g. if it was
+    // restarted in the middle of a download
+    QHash<int, ReceiveProgress>::iterator it = m_receiveProgress.begin();
+    while (it != m_receiveProgress.end()) {
+        if (it->status == it->storedStatus && it->updated.elapsed() >= kReceiveStateExpiryMs) {
+            DEBUG_("dropping stale receive state of event" << it.key());
+            it = m_receiveProgress.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
 void MmsHandler::messageReceiveStateChanged(const QString &recId, int state)
 {
+    if (recordingEngineCalls())
+        recordEngineCall("messageReceiveStateChanged", QVariantList() << recId << state);
+
+    static const char * const stateNames[] = {
+        "receiving", "deferred", "noSpace", "decoding", "recvError", "garbage"
+    };
+    if (state >= Receiving && state <= Garbage)
+        MessageTracer::instance()->step("mms", kTracePrefix + recId, stateNames[state]);
+
+    if (state == Receiving || state == Deferred || state == Decoding) {
+        // Transient state, only stored if it doesn't change for a while
+        ReceiveProgress *progress = receiveProgressEntry(recId.toInt());
+        if (!progress) {
+            qWarning() << "Ignoring MMS message receive state for unknown event" << recId;
+            m_activeEvents.remove(getModemPath(Event()), recId.toInt());
+            return;
+        }
+
+        progress->state = state;
+        progress->status = (state == Deferred) ? Event::WaitingStatus : Event::DownloadingStatus;
+        progress->changed.start();
+        emit receiveProgressChanged(recId, state, progress->bytesReceived, progress->bytesTotal);
+
+        if (progress->status != progress->storedStatus && !m_receiveStateTimer.isActive())
+            m_receiveStateTimer.start();
+        return;
+    }
+
+    // The status in memory may not have been stored yet
+    Event::EventStatus currentStatus = Event::UnknownStatus;
+    QHash<int, ReceiveProgress>::iterator it = m_receiveProgress.find(recId.toInt());
+    if (it != m_receiveProgress.end()) {
+        currentStatus = it->status;
+        m_receiveProgress.erase(it);
+    }
+    emit receiveProgressChanged(recId, state, 0, 0);
+
     Event event;
     SingleEventModel model;
     if (model.getEventById(recId.toInt()))
@@ -294,18 +546,15 @@ void MmsHandler::messageReceiveStateChanged(const QString &recId, int state)
         return;
     }
 
-    Event::EventStatus newStatus = event.status();
+    if (currentStatus == Event::UnknownStatus)
+        currentStatus = event.status();
+
+    Event::EventStatus newStatus = currentStatus;
     switch (state) {
-        case Deferred:
-            newStatus = Event::WaitingStatus;
-            break;
-        case Receiving:
-        case Decoding:
-            newStatus = Event::DownloadingStatus;
-            break;
         case NoSpace:
         case RecvError:
-            // Avoid overwriting the status for cancelled receive calls
+            // Avoid overwriting the status for cancelled receive calls.
+            // Cancelling is stored by the UI, not by us.
             if (event.status() == Event::ManualNotificationStatus)
                 return;
             newStatus = Event::TemporarilyFailedStatus;
@@ -319,18 +568,117 @@ void MmsHandler::messageReceiveStateChanged(const QString &recId, int state)
         event.setStatus(newStatus);
         if (!model.modifyEvent(event))
             qWarning() << "Failed updating MMS event status for" << recId;
+    }
 
-        if (newStatus != Event::WaitingStatus && newStatus != Event::DownloadingStatus) {
-            m_activeEvents.remove(getModemPath(event), event.id());
-            NotificationManager::instance()->showNotification(event, event.recipients().value(0).remoteUid(), Group::ChatTypeP2P);
+    if (newStatus != currentStatus) {
+        m_activeEvents.remove(getModemPath(event), event.id());
+        showEventNotification(event);
+    }
+}
+
+void MmsHandler::onReceiveStateTimeout()
+{
+    storeReceiveStates(false);
+}
+
+void MmsHandler::storeReceiveStates(bool force)
+{
+    QList<Event> events;
+    bool pending = false;
+
+    QHash<int, ReceiveProgress>::iterator it = m_receiveProgress.begin();
+    while (it != m_receiveProgress.end()) {
+        ReceiveProgress &progress(it.value());
+        if (progress.status == progress.storedStatus) {
+            ++it;
+            continue;
+        }
+
+        if (!force && progress.changed.elapsed() < kReceiveStateDebounceMs) {
+            pending = true;
+            ++it;
+            continue;
+        }
+
+        Event event;
+        SingleEventModel model;
+        if (model.getEventById(it.key()))
+            event = model.event();
+
+        if (!event.isValid()) {
+            it = m_receiveProgress.erase(it);
+            continue;
         }
+
+        if (event.status() != progress.storedStatus) {
+            // Changed behind our back, e.g. the download was cancelled
+            DEBUG_("not storing receive state of event" << it.key() << ", status is now" << event.status());
+            it = m_receiveProgress.erase(it);
+            continue;
+        }
+
+        event.setStatus(progress.status);
+        events.append(event);
+        progress.storedStatus = progress.status;
+        ++it;
+    }
+
+    if (!events.isEmpty()) {
+        DEBUG_("storing receive state of" << events.count() << "MMS event(s)");
+        PooledEventModel model;
+        if (!model->modifyEvents(events))
+            qWarning() << "Failed updating MMS event status for" << events.count() << "event(s)";
+    }
+
+    if (pending)
+        m_receiveStateTimer.start();
+}
+
+void MmsHandler::messageReceiveProgress(const QString &recId, qulonglong bytesReceived, qulonglong bytesTotal)
+{
+    if (recordingEngineCalls())
+        recordEngineCall("messageReceiveProgress", QVariantList() << recId << bytesReceived << bytesTotal);
+
+    ReceiveProgress *progress = receiveProgressEntry(recId.toInt());
+    if (progress) {
+        progress->bytesReceived = bytesReceived;
+        progress->bytesTotal = bytesTotal;
+        emit receiveProgressChanged(recId, progress->state, bytesReceived, bytesTotal);
     }
 }
 
+int MmsHandler::receiveProgress(const QString &recId, qulonglong &bytesReceived, qulonglong &bytesTotal)
+{
+    QHash<int, ReceiveProgress>::const_iterator it = m_receiveProgress.constFind(recId.toInt());
+    if (it == m_receiveProgress.constEnd()) {
+        bytesReceived = bytesTotal = 0;
+        return -1;
+    }
+
+    bytesReceived = it->bytesReceived;
+    bytesTotal = it->bytesTotal;
+    return it->state;
+}
+
 void MmsHandler::messageReceived(const QString &recId, const QString &mmsId, const QString &from,
         const QStringList &to, const QStringList &cc, const QString &subj, uint date, int priority,
         const QString &cls, bool readReport, MmsPartList parts)
 {
+    if (recordingEngineCalls()) {
+        QVariantList recordedParts;
+        foreach (const MmsPart &part, parts)
+            recordedParts.append(QStringList() << part.fileName << part.contentType << part.contentId);
+        recordEngineCall("messageReceived",
+                         QVariantList() << recId << mmsId << from << to << cc << subj << date << priority
+                                        << cls << readReport << QVariant(recordedParts));
+    }
+
+    QElapsedTimer ingestTimer;
+    ingestTimer.start();
+
+    m_receiveProgress.remove(recId.toInt());
+    MessageTracer::instance()->step("mms", kTracePrefix + recId, "messageReceived");
+
     Event event;
     SingleEventModel model;
     if (model.getEventById(recId.toInt()))
@@ -353,6 +701,8 @@ void MmsHandler::messageReceived(const QString &recId, const QString &mmsId, con
         }
     }
 
+    const QString location(event.mmsId());
+
     // Update event properties
     event.setSubject(subj);
     event.setStartTime(QDateTime::fromTime_t(date));
@@ -365,6 +715,8 @@ void MmsHandler::messageReceived(const QString &recId, const QString &mmsId, con
     Q_UNUSED(cls);
 
     // MMS location is not needed anymore
+    if (!location.isEmpty())
+        m_locationFilter.remove(location);
     event.setMmsId(QString());
 
     // We no longer need expiry and push data properties but we need
@@ -397,8 +749,10 @@ void MmsHandler::messageReceived(const QString &recId, const QString &mmsId, con
 
     QList<MessagePart> eventParts;
     QString freeText;
+    const QString traceKey(kTracePrefix + QString::number(event.id()));
     bool ok = copyMmsPartFiles(parts, event.id(), eventParts, freeText);
     if (ok) {
+        MessageTracer::instance()->step("mms", traceKey, "partsCopied");
         event.setMessageParts(eventParts);
         event.setFreeText(freeText);
 
@@ -407,6 +761,9 @@ void MmsHandler::messageReceived(const QString &recId, const QString &mmsId, con
             ok = false;
         }
     }
+    MessageTracer::instance()->end("mms", traceKey, ok ? "stored" : "failed");
+    if (ok)
+        Metrics::instance()->record(Metrics::MmsIngestLatency, ingestTimer.nsecsElapsed() / 1000);
 
     if (!ok) {
         // Clean up copied MMS parts, and try to set TemporarilyFailed on the event
@@ -481,6 +838,9 @@ QString MmsHandler::copyMessagePartFile(const QString &sourcePath, int eventId,
 
 void MmsHandler::messageSendStateChanged(const QString &recId, int state, const QString &details)
 {
+    if (recordingEngineCalls())
+        recordEngineCall("messageSendStateChanged", QVariantList() << recId << state << details);
+
     enum MessageSendState {
         Encoding = 0,
         TooBig,
@@ -528,13 +888,16 @@ void MmsHandler::messageSendStateChanged(const QString &recId, int state, const
 
         if (newStatus != Event::SendingStatus) {
             m_activeEvents.remove(getModemPath(event), event.id());
-            NotificationManager::instance()->showNotification(event, event.recipients().value(0).remoteUid(), Group::ChatTypeP2P, details);
+            showEventNotification(event, details);
         }
     }
 }
 
 void MmsHandler::messageSent(const QString &recId, const QString &mmsId)
 {
+    if (recordingEngineCalls())
+        recordEngineCall("messageSent", QVariantList() << recId << mmsId);
+
     Event event;
     SingleEventModel model;
     if (model.getEventById(recId.toInt()))
@@ -555,7 +918,8 @@ void MmsHandler::messageSent(const QString &recId, const QString &mmsId)
 
 void MmsHandler::deliveryReport(const QString &imsi, const QString &mmsId, const QString &recipient, int status)
 {
-    Q_UNUSED(recipient); // No handling for read/delivery reports from multiple recipients
+    if (recordingEngineCalls())
+        recordEngineCall("deliveryReport", QVariantList() << imsi << mmsId << recipient << status);
 
     enum DeliveryStatus {
         Indeterminate = 0,
@@ -579,14 +943,15 @@ void MmsHandler::deliveryReport(const QString &imsi, const QString &mmsId, const
 
     event.setSubscriberIdentity(imsi);
 
+    QString recipientStatus;
     switch (status) {
         case Expired:
         case Rejected:
         case Unrecognized:
-            event.setStatus(Event::TemporarilyFailedStatus);
+            recipientStatus = kDeliveryStatusFailed;
             break;
         case Retrieved:
-            event.setStatus(Event::DeliveredStatus);
+            recipientStatus = kDeliveryStatusDelivered;
             break;
         case Indeterminate:
         case Deferred:
@@ -595,13 +960,52 @@ void MmsHandler::deliveryReport(const QString &imsi, const QString &mmsId, const
             break;
     }
 
+    // Group messages track the delivery state of each recipient. Once
+    // every recipient has reported, the message is delivered if anyone
+    // got it and failed only if nobody did; partial failures are kept
+    // in the headers.
+    const QString key(kHeaderDeliveryStatusPrefix + CommHistory::normalizePhoneNumber(recipient, false));
+    QHash<QString, QString> headers(event.headers());
+    if (headers.contains(key)) {
+        if (!recipientStatus.isEmpty()) {
+            headers.insert(key, recipientStatus);
+            event.setHeaders(headers);
+        }
+
+        int failed = 0;
+        bool delivered = false;
+        bool pending = false;
+        QHash<QString, QString>::const_iterator i = headers.constBegin();
+        for (; i != headers.constEnd(); ++i) {
+            if (i.key().startsWith(kHeaderDeliveryStatusPrefix)) {
+                if (i.value() == kDeliveryStatusFailed)
+                    failed++;
+                else if (i.value() == kDeliveryStatusPending)
+                    pending = true;
+                else if (i.value() == kDeliveryStatusDelivered)
+                    delivered = true;
+            }
+        }
+
+        DEBUG_("delivery report for" << mmsId << "from" << recipient << status
+               << (pending ? "pending" : (delivered ? "delivered" : "failed"))
+               << failed << "recipient(s) failed");
+        if (!pending)
+            event.setStatus(delivered ? Event::DeliveredStatus : Event::TemporarilyFailedStatus);
+    } else if (recipientStatus == kDeliveryStatusFailed) {
+        event.setStatus(Event::TemporarilyFailedStatus);
+    } else if (recipientStatus == kDeliveryStatusDelivered) {
+        event.setStatus(Event::DeliveredStatus);
+    }
+
     if (!model.modifyEvent(event))
         qWarning() << "Failed updating MMS event sent status for" << mmsId;
 }
 
 void MmsHandler::readReport(const QString &imsi, const QString &mmsId, const QString &recipient, int status)
 {
-    Q_UNUSED(recipient); // No handling for read/delivery reports from multiple recipients
+    if (recordingEngineCalls())
+        recordEngineCall("readReport", QVariantList() << imsi << mmsId << recipient << status);
 
     Event event;
     SingleEventModel model;
@@ -626,6 +1030,9 @@ void MmsHandler::readReport(const QString &imsi, const QString &mmsId, const QSt
 
 void MmsHandler::readReportSendStatus(const QString &recId, int status)
 {
+    if (recordingEngineCalls())
+        recordEngineCall("readReportSendStatus", QVariantList() << recId << status);
+
     enum ReadReportStatus {
         ReadReportOK = 0,
         ReadReportTransientError,
@@ -633,6 +1040,7 @@ void MmsHandler::readReportSendStatus(const QString &recId, int status)
     };
 
     DEBUG_(recId << "read report status" << status);
+    m_readReportEvents.remove(recId.toInt());
     if (status != ReadReportTransientError) {
         SingleEventModel model;
         if (model.getEventById(recId.toInt())) {
@@ -680,18 +1088,35 @@ int MmsHandler::sendMessage(const QString &imsi, const QStringList &to, const QS
     event.setStatus(Event::SendingStatus);
     event.setIsRead(true);
 
-    event.setRecipients(Recipient(ringAccountPath, CommHistory::normalizePhoneNumber(to[0], false))); // XXX Wrong for group conversations!
     event.setToList(normalizeNumberList(to));
     event.setCcList(normalizeNumberList(cc));
     event.setBccList(normalizeNumberList(bcc));
     if (!imsi.isEmpty()) event.setSubscriberIdentity(imsi);
 
-    // XXX Group conversations not yet supported
-    if (to.size() + cc.size() + bcc.size() > 1) {
-        qCritical() << "Ignoring outgoing group MMS event; this is not yet implemented:" << event.toString();
+    // Group messages are a single event with all recipients, sharing
+    // one copy of the parts and sent with a single engine call
+    QStringList deliveryRecipients(event.toList() + event.ccList() + event.bccList());
+    deliveryRecipients.removeDuplicates();
+    if (deliveryRecipients.isEmpty()) {
+        qCritical() << "Ignoring outgoing MMS event without recipients:" << event.toString();
         return -1;
     }
 
+    // BCC recipients must not show up in the conversation, unless there
+    // is nobody else
+    QStringList recipients(event.toList() + event.ccList());
+    recipients.removeDuplicates();
+    if (recipients.isEmpty())
+        recipients = deliveryRecipients;
+    event.setRecipients(RecipientList::fromUids(ringAccountPath, recipients));
+
+    if (deliveryRecipients.count() > 1) {
+        QHash<QString, QString> headers(event.headers());
+        foreach (const QString &recipient, deliveryRecipients)
+            headers.insert(kHeaderDeliveryStatusPrefix + recipient, kDeliveryStatusPending);
+        event.setHeaders(headers);
+    }
+
     if (!setGroupForEvent(event)) {
         qCritical() << "Failed to handle group for MMS send event; message dropped:" << event.toString();
         return -1;
@@ -743,7 +1168,7 @@ int MmsHandler::sendMessage(const QString &imsi, const QStringList &to, const QS
     }
 
     if (event.status() >= Event::TemporarilyFailedStatus)
-        NotificationManager::instance()->showNotification(event, event.recipients().value(0).remoteUid(), Group::ChatTypeP2P);
+        showEventNotification(event);
     return event.id();
 }
 
@@ -781,10 +1206,10 @@ Event::EventStatus MmsHandler::sendMessageFromEvent(Event &event)
     MmsPartFdList parts;
     foreach (const MessagePart &part, event.messageParts()) {
         MmsPartFd p(part.path(), part.contentType(), part.contentId());
-        if (p.file.isOpen()) {
+        if (p.isReadable()) {
             parts.append(p);
         } else {
-            qWarning() << "Failed to open" << part.path();
+            qWarning() << "Cannot read" << part.path();
             return Event::TemporarilyFailedStatus;
         }
     }
@@ -793,7 +1218,7 @@ Event::EventStatus MmsHandler::sendMessageFromEvent(Event &event)
     if (imsi.isEmpty()) imsi = getDefaultVoiceSim();
 
     if (!imsi.isEmpty()) {
-        unsigned int flags = m_imsiSettings->value(imsi + kSettingSendFlags, 0).toInt();
+        unsigned int flags = imsiSettings(imsi)->sendFlags;
         DEBUG_("send flags are" << flags);
 
         QVariantList args;
@@ -826,7 +1251,7 @@ void MmsHandler::onSendMessageFinished(QDBusPendingCallWatcher *call)
             // Commit the changes, in case if showNotification requires it
             // or will require in the future:
             model.modifyEvent(event);
-            NotificationManager::instance()->showNotification(event, event.recipients().value(0).remoteUid(), Group::ChatTypeP2P);
+            showEventNotification(event);
         } else {
             if (event.isValid()) {
                 event.setSubscriberIdentity(reply.value());
@@ -852,6 +1277,7 @@ bool MmsHandler::isDataProhibited(const QString &path)
         return true;
 
     // TODO: This property should be monitored asynchronously to avoid blocking dbus queries
+    DBusSyncCall accounting(QStringLiteral("com.jolla.Connectiond"), QStringLiteral("Get askRoaming"));
     QDBusInterface interface("com.jolla.Connectiond", "/Connectiond");
     // For now, treat "always ask" like "never"
     if (interface.property("askRoaming").toBool())
@@ -880,6 +1306,10 @@ void MmsHandler::dataProhibitedChanged(const QString &path)
 
         m_activeEvents.remove(path);
     }
+
+    // Deferred reports of any modem may be sendable now
+    if (!m_readReportQueue.isEmpty())
+        flushReadReports();
 }
 
 void MmsHandler::onStatusChanged(const QString &status)
@@ -898,69 +1328,198 @@ void MmsHandler::onRoamingAllowedChanged(bool roaming)
     dataProhibitedChanged(connection->modemPath());
 }
 
-void MmsHandler::eventMarkedAsRead(CommHistory::Event &event)
+void MmsHandler::eventsMarkedAsRead(const QList<CommHistory::Event> &events)
 {
-    const QString imsi = event.subscriberIdentity();
+    QList<Event> modified;
+
+    expireReadReports();
+    foreach (Event event, events) {
+        if (m_readReportEvents.contains(event.id()))
+            continue;
+
+        const QString imsi = event.subscriberIdentity();
+        const bool sendReadReports = imsiSettings(imsi)->sendReadReports;
+
+        if (sendReadReports) {
+            DEBUG_("queueing read report for" << event.id());
+            ReadReport report;
+            report.eventId = event.id();
+            report.imsi = imsi;
+            report.mmsId = event.mmsId();
+            report.recipient = event.recipients().value(0).remoteUid();
+            m_readReportQueue.enqueue(report);
+            m_readReportEvents.insert(event.id(), 0);
+        } else {
+            DEBUG_("not allowed to send read report for" << event.id());
+            event.removeExtraProperty(MMS_PROPERTY_UNREAD);
+            modified.append(event);
+        }
+    }
 
-    // Caller already checked canSendReadReports() so mobile data is allowed
-    const bool sendReadReports = m_imsiSettings->value(
-                imsi + kSettingSendReadReports, false).toBool();
+    // All property removals are committed in a single transaction
+    if (!modified.isEmpty()) {
+        PooledEventModel model;
+        if (!model->modifyEvents(modified))
+            qWarning() << "Failed to update" << modified.count() << "MMS event(s)";
+    }
+
+    flushReadReports();
+}
 
-    if (sendReadReports) {
-        DEBUG_("sending read report for" << event.id());
+void MmsHandler::flushReadReports()
+{
+    // The data policy may take a blocking D-Bus call, ask once per modem
+    QHash<QString, bool> allowed;
+    int deferred = 0;
+
+    int i = 0;
+    while (i < m_readReportQueue.count() && m_readReportsInFlight < kMaxReadReportsInFlight) {
+        const QString path(getModemPath(m_readReportQueue.at(i).imsi));
+        QHash<QString, bool>::const_iterator policy = allowed.constFind(path);
+        if (policy == allowed.constEnd())
+            policy = allowed.insert(path, canSendReadReports(path));
+        if (!policy.value()) {
+            // Keep it in place until the data policy allows sending
+            deferred++;
+            i++;
+            continue;
+        }
+
+        const ReadReport report(m_readReportQueue.takeAt(i));
+        DEBUG_("sending read report for" << report.eventId);
         QVariantList args;
-        args << event.id() << imsi << event.mmsId() << event.recipients().value(0).remoteUid() << 0;
-        callEngine("sendReadReport", args);
-    } else {
-        DEBUG_("not allowed to send read report for" << event.id());
-        event.removeExtraProperty(MMS_PROPERTY_UNREAD);
-        SingleEventModel model;
-        if (!model.modifyEvent(event)) {
-            qWarning() << "Failed to update MMS event" << event.id();
+        args << report.eventId << report.imsi << report.mmsId << report.recipient << 0;
+
+        QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(callEngine("sendReadReport", args), this);
+        watcher->setProperty(kCallPropertyEventId, report.eventId);
+        connect(watcher, SIGNAL(finished(QDBusPendingCallWatcher*)), SLOT(onSendReadReportFinished(QDBusPendingCallWatcher*)));
+        m_readReportsInFlight++;
+    }
+
+    m_readReportsDeferred = deferred;
+    if (deferred)
+        DEBUG_(deferred << "read report(s) deferred");
+}
+
+void MmsHandler::expireReadReports()
+{
+    const qint64 now = m_readReportClock.elapsed();
+    QHash<int, qint64>::iterator it = m_readReportEvents.begin();
+    while (it != m_readReportEvents.end()) {
+        if (it.value() && it.value() < now) {
+            qWarning() << "No read report status for" << it.key() << "- allowing a retry";
+            it = m_readReportEvents.erase(it);
+        } else {
+            ++it;
         }
     }
 }
 
+void MmsHandler::onSendReadReportFinished(QDBusPendingCallWatcher *call)
+{
+    QDBusPendingReply<> reply = *call;
+    const int eventId = call->property(kCallPropertyEventId).toInt();
+
+    m_readReportsInFlight--;
+    if (reply.isError()) {
+        qWarning() << "Call to MmsEngine sendReadReport failed for" << eventId << reply.error();
+        // Allow the next update of this event to retry
+        m_readReportEvents.remove(eventId);
+    } else if (m_readReportEvents.contains(eventId)) {
+        // Normally removed by readReportSendStatus
+        m_readReportEvents.insert(eventId, m_readReportClock.elapsed() + kReadReportStatusTimeoutMs);
+    }
+
+    call->deleteLater();
+    flushReadReports();
+}
+
+void MmsHandler::drain()
+{
+    m_receiveStateTimer.stop();
+    storeReceiveStates(true);
+    flushReadReports();
+}
+
+QVariantMap MmsHandler::pendingWork() const
+{
+    int receiveStates = 0;
+    QHash<int, ReceiveProgress>::const_iterator it = m_receiveProgress.constBegin();
+    for (; it != m_receiveProgress.constEnd(); ++it) {
+        if (it->status != it->storedStatus)
+            receiveStates++;
+    }
+
+    QVariantMap work;
+    work.insert(QLatin1String("receiveStates"), receiveStates);
+    // Reports waiting for the data policy can't be sent by drain()
+    work.insert(QLatin1String("queuedReadReports"), m_readReportQueue.count() - m_readReportsDeferred);
+    work.insert(QLatin1String("readReportsInFlight"), m_readReportsInFlight);
+    return work;
+}
+
 void MmsHandler::onEventsUpdated(const QList<CommHistory::Event> &events)
 {
     const int count = events.count();
     DEBUG_(count << "event(s) updated");
 
+    QList<Event> readEvents;
     for (int i=0; i<count; i++) {
-        Event event(events.at(i));
+        const Event &event(events.at(i));
         DEBUG_(i << ":" << event.toString());
-        if (canSendReadReports(getModemPath(event))) {
-            if (MmsReadReportModel::acceptsEvent(event)) {
-                eventMarkedAsRead(event);
-            }
-        } else if (event.type() == Event::MMSEvent)
-            DEBUG_("can't send read report for" << event.id());
+        if (MmsReadReportModel::acceptsEvent(event))
+            readEvents.append(event);
     }
+
+    if (!readEvents.isEmpty())
+        eventsMarkedAsRead(readEvents);
 }
 
 void MmsHandler::onGroupsUpdatedFull(const QList<CommHistory::Group> &groups)
 {
     DEBUG_(groups.count() << "group(s) updated");
+
+    QList<int> groupIds;
     for (int i=0; i<groups.count(); i++) {
-        Group group(groups.at(i));
+        const Group &group(groups.at(i));
         DEBUG_(i << ":" << group.toString());
-        const int gid = group.id();
-        MmsReadReportModel model;
-        if (model.getEvents(gid)) {
-            const int count = model.count();
-            DEBUG_(count << "MMS event(s) found in group" << gid);
-            for (int j=0; j<count; j++) {
-                Event event(model.event(j));
-                if (canSendReadReports(getModemPath(event))) {
-                    eventMarkedAsRead(event);
-                } else {
-                    DEBUG_("can't send read report at the moment for" << event.id());
-                }
-            }
+        groupIds.append(group.id());
+    }
+
+    if (groupIds.isEmpty())
+        return;
+
+    // One query for all updated groups, it only returns events that
+    // still need a read report
+    QList<Event> readEvents;
+    if (!reader()->readReportEvents(groupIds, readEvents)) {
+        qWarning() << "Failed to query MMS events in" << groupIds.count() << "group(s)";
+        return;
+    }
+
+    // Events whose flag is cleared without a report are written back,
+    // those need all of their fields
+    for (int i=0; i<readEvents.count(); i++) {
+        if (m_readReportEvents.contains(readEvents.at(i).id())
+            || imsiSettings(readEvents.at(i).subscriberIdentity())->sendReadReports)
+            continue;
+
+        SingleEventModel model;
+        if (model.getEventById(readEvents.at(i).id()) && model.event().isValid()) {
+            readEvents[i] = model.event();
         } else {
-            qWarning() << "Failed to query MMS events in group" << gid;
+            qWarning() << "Failed to load MMS event" << readEvents.at(i).id();
+            readEvents.removeAt(i--);
         }
     }
+
+    if (!readEvents.isEmpty())
+        eventsMarkedAsRead(readEvents);
+}
+
+QVariantMap MmsHandler::duplicateFilterStatistics() const
+{
+    return m_locationFilter.statistics();
 }
 
 QString MmsHandler::accountPath(const QString &modemPath)
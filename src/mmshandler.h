@@ -25,26 +25,34 @@
 
 #include <QHash>
 #include <QMultiMap>
+#include <QQueue>
+#include <QSet>
+#include <QElapsedTimer>
+#include <QTimer>
 #include <CommHistory/event.h>
 #include <qofonomanager.h>
 #include <qofonoextmodemmanager.h>
 #include "messagehandlerbase.h"
 #include "mmspart.h"
+#include "mmslocationfilter.h"
+#include "shutdowncoordinator.h"
 
 namespace CommHistory {
     class Group;
 }
 
 class QDBusPendingCallWatcher;
-class MDConfGroup;
+class DatabaseReader;
 class MmsHandlerModem;
+class MmsHandlerImsiSettings;
 
-class MmsHandler : public MessageHandlerBase
+class MmsHandler : public MessageHandlerBase, public RTComLogger::ShutdownParticipant
 {
     Q_OBJECT
 
 public:
     explicit MmsHandler(QObject *parent);
+    ~MmsHandler();
 
 public Q_SLOTS:
     QString messageNotification(const QString &imsi, const QString &from, const QString &subject,
@@ -52,6 +60,8 @@ public Q_SLOTS:
     QString messageNotification(const QString &imsi, const QString &from, const QString &subject,
             uint expiry, const QByteArray &data, const QString &location);
     void messageReceiveStateChanged(const QString &recId, int state);
+    void messageReceiveProgress(const QString &recId, qulonglong bytesReceived, qulonglong bytesTotal);
+    int receiveProgress(const QString &recId, qulonglong &bytesReceived, qulonglong &bytesTotal);
     void messageReceived(const QString &recId, const QString &mmsId, const QString &from,
             const QStringList &to, const QStringList &cc, const QString &subj, uint date, int priority,
             const QString &cls, bool readReport, MmsPartList parts);
@@ -68,25 +78,68 @@ public Q_SLOTS:
             const QString &subject, MmsPartList parts);
     void sendMessageFromEvent(int eventId);
 
+    QVariantMap duplicateFilterStatistics() const;
+
+    /*!
+     * \brief Stores debounced receive states and sends queued read
+     * reports without waiting.
+     */
+    void drain();
+    QVariantMap pendingWork() const;
+
+Q_SIGNALS:
+    void receiveProgressChanged(const QString &recId, int state, qulonglong bytesReceived, qulonglong bytesTotal);
+
 private Q_SLOTS:
     void onOfonoAvailableChanged(bool available);
     void onModemAdded(QString path);
     void onModemRemoved(QString path);
     void onSendMessageFinished(QDBusPendingCallWatcher *call);
+    void onSendReadReportFinished(QDBusPendingCallWatcher *call);
     void onEventsUpdated(const QList<CommHistory::Event> &events);
     void onGroupsUpdatedFull(const QList<CommHistory::Group> &groups);
     void onStatusChanged(const QString &status);
     void onRoamingAllowedChanged(bool roaming);
+    void onSimChanged();
+    void onImsiSettingChanged();
+    void onReceiveStateTimeout();
 
 private:
+    // Transient receive state, written to the database only if it
+    // lasts longer than the debounce interval
+    struct ReceiveProgress {
+        int state;
+        CommHistory::Event::EventStatus status;
+        CommHistory::Event::EventStatus storedStatus;
+        qulonglong bytesReceived;
+        qulonglong bytesTotal;
+        QElapsedTimer changed;
+        QElapsedTimer updated;
+    };
+
+    struct ReadReport {
+        int eventId;
+        QString imsi;
+        QString mmsId;
+        QString recipient;
+    };
+
     void addAllModems();
     void addModem(const QString &path);
+    void updateImsiIndex();
+    ReceiveProgress *receiveProgressEntry(int eventId);
+    void expireReceiveStates();
+    const MmsHandlerImsiSettings *imsiSettings(const QString &imsi);
     QString getModemPath(const CommHistory::Event &event) const;
     QString getModemPath(const QString &imsi) const;
     QString getDefaultVoiceSim() const;
     void dataProhibitedChanged(const QString &path);
     static QDBusPendingCall callEngine(const QString &method, const QVariantList &args);
-    void eventMarkedAsRead(CommHistory::Event &event);
+    void eventsMarkedAsRead(const QList<CommHistory::Event> &events);
+    void flushReadReports();
+    void expireReadReports();
+    void storeReceiveStates(bool force);
+    DatabaseReader *reader();
 
     CommHistory::Event::EventStatus sendMessageFromEvent(CommHistory::Event &event);
     bool copyMmsPartFiles(const MmsPartList &parts, int eventId, QList<CommHistory::MessagePart> &eventParts, QString &freeText);
@@ -101,8 +154,24 @@ private:
     QSharedPointer<QOfonoManager> m_ofonoManager;
     QSharedPointer<QOfonoExtModemManager> m_ofonoExtModemManager;
     QHash<QString, MmsHandlerModem*> m_modems;
-    MDConfGroup *m_imsiSettings;
+    // IMSI -> modem path for all modems with a valid SIM
+    QHash<QString, QString> m_imsiModems;
+    QHash<QString, MmsHandlerImsiSettings*> m_imsiSettings;
     QMultiMap<QString, int> m_activeEvents;
+    MmsLocationFilter m_locationFilter;
+    QHash<int, ReceiveProgress> m_receiveProgress;
+    QTimer m_receiveStateTimer;
+    // Read reports waiting for mobile data or for a free engine call slot
+    QQueue<ReadReport> m_readReportQueue;
+    // Events with a queued or submitted read report, to avoid sending
+    // duplicates. Submitted reports expire if the engine never reports
+    // their status, queued and in flight ones have no expiry (0).
+    QHash<int, qint64> m_readReportEvents;
+    QElapsedTimer m_readReportClock;
+    int m_readReportsInFlight;
+    // Queued reports that the data policy held back in the last flush
+    int m_readReportsDeferred;
+    DatabaseReader *m_reader;
 };
 
 #endif // MMSHANDLER_H
@@ -0,0 +1,249 @@
+/******************************************************************************
+**
+** This file is part of commhistory-daemon.
+**
+** Copyright (C) 2026 Jolla Ltd.
+**
+** This library is free software; you can redistribute it and/or modify it
+** under the terms of the GNU Lesser General Public License version 2.1 as
+** published by the Free Software Foundation.
+**
+** This library is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+** or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+** License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this library; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+**
+******************************************************************************/
+
+#include "mmslocationfilter.h"
+#include "databasereader.h"
+#include "debug.h"
+
+#include <CommHistory/constants.h>
+#include <CommHistory/databaseio.h>
+#include <CommHistory/event.h>
+
+#include <QDBusConnection>
+#include <QRunnable>
+#include <QThread>
+
+#define DEBUG_(x) qCDebug(lcMms) << "MmsLocationFilter:" << x
+
+// Bits per expected element and number of probes, ~2% false positives
+static const int kBloomBitsPerElement = 8;
+static const int kBloomProbes = 4;
+static const int kBloomMinimumSize = 1 << 14;
+
+class MmsLocationSeedTask : public QRunnable
+{
+public:
+    explicit MmsLocationSeedTask(MmsLocationFilter *owner) : iOwner(owner) {}
+
+    void run()
+    {
+        QThread::currentThread()->setPriority(QThread::LowestPriority);
+        QStringList locations;
+        bool complete;
+        {
+            DatabaseReader reader(QLatin1String("commhistoryd-mmslocations"));
+            complete = reader.mmsIds(locations);
+        }
+        QMetaObject::invokeMethod(iOwner, "onSeeded", Qt::QueuedConnection,
+            Q_ARG(QStringList, locations), Q_ARG(bool, complete));
+    }
+
+private:
+    MmsLocationFilter *iOwner;
+};
+
+MmsLocationFilter::MmsLocationFilter(int lruCapacity, QObject *parent) :
+    QObject(parent),
+    m_seedingStarted(false),
+    m_bloomComplete(false),
+    m_lruCapacity(lruCapacity),
+    m_lruTick(0),
+    m_lookups(0),
+    m_lruHits(0),
+    m_bloomRejects(0),
+    m_databaseLookups(0),
+    m_databaseHits(0)
+{
+    m_pool.setMaxThreadCount(1);
+
+    QDBusConnection dbus(QDBusConnection::sessionBus());
+    dbus.connect(QString(), QString(), COMM_HISTORY_INTERFACE,
+        EVENT_DELETED_SIGNAL, this, SLOT(onEventDeleted(int)));
+    dbus.connect(QString(), QString(), COMM_HISTORY_INTERFACE,
+        GROUPS_DELETED_SIGNAL, this, SLOT(onGroupsDeleted(QList<int>)));
+}
+
+void MmsLocationFilter::onSeeded(const QStringList &locations, bool complete)
+{
+    int size = kBloomMinimumSize;
+    const int count = locations.count() + m_insertedWhileSeeding.count();
+    while (size < count * kBloomBitsPerElement * 2)
+        size <<= 1;
+    m_bloom.resize(size);
+
+    foreach (const QString &location, locations)
+        bloomInsert(location);
+    foreach (const QString &location, m_insertedWhileSeeding)
+        bloomInsert(location);
+    m_insertedWhileSeeding.clear();
+    m_bloomComplete = complete;
+
+    DEBUG_("seeded with" << locations.count() << "location(s)," << size << "bits"
+           << (m_bloomComplete ? "" : "(incomplete)"));
+}
+
+void MmsLocationFilter::bloomInsert(const QString &location)
+{
+    const uint size = m_bloom.size();
+    const uint h1 = qHash(location, 0);
+    const uint h2 = qHash(location, 0x9e3779b9) | 1;
+    for (int i = 0; i < kBloomProbes; i++)
+        m_bloom.setBit((h1 + i * h2) % size);
+}
+
+bool MmsLocationFilter::bloomContains(const QString &location) const
+{
+    const uint size = m_bloom.size();
+    const uint h1 = qHash(location, 0);
+    const uint h2 = qHash(location, 0x9e3779b9) | 1;
+    for (int i = 0; i < kBloomProbes; i++) {
+        if (!m_bloom.testBit((h1 + i * h2) % size))
+            return false;
+    }
+    return true;
+}
+
+bool MmsLocationFilter::lruTouch(const QString &location)
+{
+    QHash<QString, LruEntry>::iterator it = m_lru.find(location);
+    if (it == m_lru.end())
+        return false;
+
+    m_lruOrder.remove(it->tick);
+    it->tick = ++m_lruTick;
+    m_lruOrder.insert(it->tick, location);
+    return true;
+}
+
+void MmsLocationFilter::lruInsert(const QString &location, int eventId, int groupId)
+{
+    if (lruTouch(location)) {
+        m_lru[location].eventId = eventId;
+        m_lru[location].groupId = groupId;
+        return;
+    }
+
+    while (m_lru.count() >= m_lruCapacity && !m_lruOrder.isEmpty())
+        m_lru.remove(m_lruOrder.take(m_lruOrder.firstKey()));
+
+    LruEntry entry;
+    entry.tick = ++m_lruTick;
+    entry.eventId = eventId;
+    entry.groupId = groupId;
+    m_lru.insert(location, entry);
+    m_lruOrder.insert(entry.tick, location);
+}
+
+void MmsLocationFilter::lruRemove(QHash<QString, LruEntry>::iterator it)
+{
+    m_lruOrder.remove(it->tick);
+    m_lru.erase(it);
+}
+
+bool MmsLocationFilter::contains(const QString &location)
+{
+    if (!m_seedingStarted) {
+        m_seedingStarted = true;
+        m_pool.start(new MmsLocationSeedTask(this));
+    }
+
+    m_lookups++;
+    if (lruTouch(location)) {
+        m_lruHits++;
+        return true;
+    }
+
+    if (m_bloomComplete && !bloomContains(location)) {
+        m_bloomRejects++;
+        return false;
+    }
+
+    // Not seeded yet, a real duplicate or a bloom filter false positive
+    m_databaseLookups++;
+    CommHistory::Event event;
+    if (CommHistory::DatabaseIO::instance()->getEventByMmsId(location, event)) {
+        DEBUG_(location << "is already in the database, id =" << event.id());
+        m_databaseHits++;
+        lruInsert(location, event.id(), event.groupId());
+        return true;
+    }
+    return false;
+}
+
+void MmsLocationFilter::insert(const QString &location, int eventId, int groupId)
+{
+    // Before seeding starts, the seed query will find it in the database
+    if (!m_bloom.isEmpty())
+        bloomInsert(location);
+    else if (m_seedingStarted)
+        m_insertedWhileSeeding.append(location);
+    lruInsert(location, eventId, groupId);
+}
+
+void MmsLocationFilter::remove(const QString &location)
+{
+    // Bloom filter matches are confirmed from the database, the stale
+    // bit only costs a query
+    QHash<QString, LruEntry>::iterator it = m_lru.find(location);
+    if (it != m_lru.end())
+        lruRemove(it);
+}
+
+void MmsLocationFilter::onEventDeleted(int eventId)
+{
+    QHash<QString, LruEntry>::iterator it = m_lru.begin();
+    while (it != m_lru.end()) {
+        if (it->eventId == eventId) {
+            DEBUG_("event" << eventId << "deleted, forgetting" << it.key());
+            lruRemove(it);
+            return;
+        }
+        ++it;
+    }
+}
+
+void MmsLocationFilter::onGroupsDeleted(const QList<int> &groupIds)
+{
+    QHash<QString, LruEntry>::iterator it = m_lru.begin();
+    while (it != m_lru.end()) {
+        if (groupIds.contains(it->groupId)) {
+            m_lruOrder.remove(it->tick);
+            it = m_lru.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+QVariantMap MmsLocationFilter::statistics() const
+{
+    QVariantMap stats;
+    stats.insert(QLatin1String("lookups"), m_lookups);
+    stats.insert(QLatin1String("lruHits"), m_lruHits);
+    stats.insert(QLatin1String("bloomRejects"), m_bloomRejects);
+    stats.insert(QLatin1String("databaseLookups"), m_databaseLookups);
+    stats.insert(QLatin1String("databaseHits"), m_databaseHits);
+    stats.insert(QLatin1String("hitRate"), m_lookups ?
+        double(m_lookups - m_databaseLookups) / m_lookups : 0.0);
+    stats.insert(QLatin1String("lruSize"), m_lru.count());
+    stats.insert(QLatin1String("seeded"), !m_bloom.isEmpty());
+    return stats;
+}
@@ -0,0 +1,113 @@
+/******************************************************************************
+**
+** This file is part of commhistory-daemon.
+**
+** Copyright (C) 2026 Jolla Ltd.
+**
+** This library is free software; you can redistribute it and/or modify it
+** under the terms of the GNU Lesser General Public License version 2.1 as
+** published by the Free Software Foundation.
+**
+** This library is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+** or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+** License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this library; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+**
+******************************************************************************/
+
+#ifndef MMSLOCATIONFILTER_H
+#define MMSLOCATIONFILTER_H
+
+#include <QBitArray>
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <QVariantMap>
+
+/*!
+ * \class MmsLocationFilter
+ * \brief Detects repeated MMS WAP push notifications without hitting the
+ * database on every call.
+ *
+ * Recently accepted locations are kept in an exact LRU, which drops the
+ * entries of deleted events and groups. Everything else is checked
+ * against a bloom filter, which is seeded from the database on a worker
+ * thread after the first lookup. Until then, and for bloom filter
+ * matches that are not in the LRU, the database tells a duplicate from
+ * a false positive.
+ */
+class MmsLocationFilter : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit MmsLocationFilter(int lruCapacity = 256, QObject *parent = 0);
+
+    /*!
+     * \brief Returns true if a notification with this location has already
+     * been stored.
+     */
+    bool contains(const QString &location);
+
+    /*!
+     * \brief Records a location whose notification has just been stored
+     * as \a eventId in \a groupId.
+     */
+    void insert(const QString &location, int eventId, int groupId);
+
+    /*!
+     * \brief Forgets a location whose event no longer refers to it.
+     */
+    void remove(const QString &location);
+
+    QVariantMap statistics() const;
+
+private Q_SLOTS:
+    void onSeeded(const QStringList &locations, bool complete);
+    void onEventDeleted(int eventId);
+    void onGroupsDeleted(const QList<int> &groupIds);
+
+private:
+    struct LruEntry {
+        quint64 tick;
+        int eventId;
+        int groupId;
+    };
+
+    void bloomInsert(const QString &location);
+    bool bloomContains(const QString &location) const;
+    void lruInsert(const QString &location, int eventId, int groupId);
+    bool lruTouch(const QString &location);
+    void lruRemove(QHash<QString, LruEntry>::iterator it);
+
+private:
+    bool m_seedingStarted;
+    bool m_bloomComplete;
+    // Inserted while the seed query runs, added to the new bloom filter
+    QStringList m_insertedWhileSeeding;
+    QBitArray m_bloom;
+    int m_lruCapacity;
+    quint64 m_lruTick;
+    QHash<QString, LruEntry> m_lru;
+    QMap<quint64, QString> m_lruOrder;
+
+    quint64 m_lookups;
+    quint64 m_lruHits;
+    quint64 m_bloomRejects;
+    quint64 m_databaseLookups;
+    quint64 m_databaseHits;
+
+    // Last, so that a running seed query is waited for before the rest
+    // of the filter goes away
+    QThreadPool m_pool;
+};
+
+#endif // MMSLOCATIONFILTER_H
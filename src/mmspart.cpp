@@ -17,37 +17,51 @@
 ******************************************************************************/
 
 #include "mmspart.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
 #include <unistd.h>
 
-MmsPartFd::MmsPartFd(const QString path, const QString ct, const QString cid) :
-    file(path),
+class MmsPartFd::Handle {
+public:
+    explicit Handle(const QString &p) : path(p), fd(-1) {}
+    explicit Handle(int f) : fd(f) {}
+    ~Handle() { if (fd >= 0) ::close(fd); }
+
+    int open()
+    {
+        if (fd < 0 && !path.isEmpty()) {
+            fd = ::open(QFile::encodeName(path).constData(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0)
+                qWarning() << "Failed to open" << path << strerror(errno);
+        }
+        return fd;
+    }
+
+    QString path;
+    int fd;
+};
+
+MmsPartFd::MmsPartFd(const QString &path, const QString &ct, const QString &cid) :
     fileName(QFileInfo(path).fileName()),
     contentType(ct),
-    contentId(cid)
+    contentId(cid),
+    handle(new Handle(path))
 {
-    file.open(QIODevice::ReadOnly);
 }
 
-MmsPartFd::MmsPartFd(const MmsPartFd &that) :
-    fileName(that.fileName),
-    contentType(that.contentType),
-    contentId(that.contentId)
+bool MmsPartFd::isReadable() const
 {
-    if (that.file.isOpen()) {
-        file.open(dup(that.file.handle()), QIODevice::ReadOnly, QFileDevice::AutoCloseHandle);
-    }
+    if (handle.isNull())
+        return false;
+    if (handle->fd >= 0)
+        return true;
+    return access(QFile::encodeName(handle->path).constData(), R_OK) == 0;
 }
 
-MmsPartFd &MmsPartFd::operator=(const MmsPartFd &that)
+int MmsPartFd::fd() const
 {
-    fileName = that.fileName;
-    contentType = that.contentType;
-    contentId = that.contentId;
-    file.close();
-    if (that.file.isOpen()) {
-        file.open(dup(that.file.handle()), QIODevice::ReadOnly, QFileDevice::AutoCloseHandle);
-    }
-    return *this;
+    return handle.isNull() ? -1 : handle->open();
 }
 
 QDBusArgument &operator<<(QDBusArgument &arg, const MmsPart &part)
@@ -60,7 +74,7 @@ QDBusArgument &operator<<(QDBusArgument &arg, const MmsPart &part)
 
 QDBusArgument &operator<<(QDBusArgument &arg, const MmsPartFd &part)
 {
-    QDBusUnixFileDescriptor fd(part.file.handle());
+    QDBusUnixFileDescriptor fd(part.fd());
     arg.beginStructure();
     arg << fd << part.fileName << part.contentType << part.contentId;
     arg.endStructure();
@@ -82,9 +96,9 @@ const QDBusArgument &operator>>(const QDBusArgument &arg, MmsPartFd &part)
     arg >> fd >> part.fileName >> part.contentType >> part.contentId;
     arg.endStructure();
 
-    part.file.close();
+    part.handle.reset();
     if (fd.isValid()) {
-        part.file.open(dup(fd.fileDescriptor()), QIODevice::ReadOnly, QFileDevice::AutoCloseHandle);
+        part.handle.reset(new MmsPartFd::Handle(dup(fd.fileDescriptor())));
     }
     return arg;
 }
@@ -20,6 +20,7 @@
 #define MMSPART_H
 
 #include <QtDBus>
+#include <QSharedPointer>
 #include <QString>
 
 struct MmsPart {
@@ -28,18 +29,27 @@ struct MmsPart {
     QString contentId;
 };
 
+// Outgoing message part. Copies share a single reference-counted
+// descriptor, which is only opened when the part is marshalled and
+// closed when the last copy goes away.
 class MmsPartFd {
 public:
-    QFile file;
     QString fileName;
     QString contentType;
     QString contentId;
 
 public:
     MmsPartFd() {}
-    MmsPartFd(const QString path, const QString ct, const QString cid);
-    MmsPartFd(const MmsPartFd &that);
-    MmsPartFd &operator=(const MmsPartFd &that);
+    MmsPartFd(const QString &path, const QString &ct, const QString &cid);
+
+    bool isReadable() const;
+    int fd() const;
+
+private:
+    class Handle;
+    QSharedPointer<Handle> handle;
+
+    friend const QDBusArgument &operator>>(const QDBusArgument &arg, MmsPartFd &part);
 };
 
 QDBusArgument &operator<<(QDBusArgument &arg, const MmsPart &part);
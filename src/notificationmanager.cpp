@@ -29,7 +29,6 @@
 
 // CommHistory includes
 #include <CommHistory/commonutils.h>
-#include <CommHistory/GroupModel>
 #include <CommHistory/Group>
 
 // Telepathy includes
@@ -47,6 +46,10 @@
 // Our includes
 #include "qofonomanager.h"
 #include "notificationmanager.h"
+#include "messagetracer.h"
+#include "metrics.h"
+#include "dbuscallstats.h"
+#include "trafficrecorder.h"
 #include "locstrings.h"
 #include "constants.h"
 #include "debug.h"
@@ -66,7 +69,7 @@ NotificationManager::NotificationManager(QObject* parent)
         : QObject(parent)
         , m_Initialised(false)
         , m_contactResolver(0)
-        , m_GroupModel(0)
+        , m_GroupCache(0)
         , m_ngfClient(0)
         , m_ngfEvent(0)
 {
@@ -81,7 +84,7 @@ NotificationManager::~NotificationManager()
 
 void NotificationManager::addModem(QString path)
 {
-    DEBUG() << "NotificationManager::addModem" << path;
+    qCDebug(lcNotification) << "NotificationManager::addModem" << path;
     QOfonoMessageWaiting *mw = new QOfonoMessageWaiting(this);
     interfaces.insert(path, mw);
 
@@ -92,7 +95,7 @@ void NotificationManager::addModem(QString path)
     connect(mw, SIGNAL(validChanged(bool)), this, SLOT(slotValidChanged(bool)));
 
     if (mw->isValid()) {
-        DEBUG() << "NotificationManager::addModem, mwi interface already valid";
+        qCDebug(lcNotification) << "NotificationManager::addModem, mwi interface already valid";
         slotVoicemailWaitingChanged();
     }
 }
@@ -123,7 +126,7 @@ void NotificationManager::init()
     connect(ofono, SIGNAL(modemAdded(QString)), this, SLOT(slotModemAdded(QString)));
     connect(ofono, SIGNAL(modemRemoved(QString)), this, SLOT(slotModemRemoved(QString)));
     QStringList modems = ofono->modems();
-    DEBUG() << "Created modem manager";
+    qCDebug(lcNotification) << "Created modem manager";
     foreach (QString path, modems) {
         addModem(path);
     }
@@ -137,7 +140,7 @@ void NotificationManager::init()
     connect(service, SIGNAL(observedConversationsChanged(QList<CommHistoryService::Conversation>)),
                      SLOT(slotObservedConversationsChanged(QList<CommHistoryService::Conversation>)));
 
-    groupModel();
+    groupCache();
 
     m_Initialised = true;
 }
@@ -242,7 +245,7 @@ void NotificationManager::showNotification(const CommHistory::Event& event,
                                            CommHistory::Group::ChatType chatType,
                                            const QString &details)
 {
-    DEBUG() << Q_FUNC_INFO << event.id() << channelTargetId << chatType;
+    qCDebug(lcNotification) << Q_FUNC_INFO << event.id() << channelTargetId << chatType;
 
     if (event.type() == CommHistory::Event::SMSEvent
         || event.type() == CommHistory::Event::MMSEvent
@@ -250,6 +253,9 @@ void NotificationManager::showNotification(const CommHistory::Event& event,
     {
         bool inboxObserved = CommHistoryService::instance()->inboxObserved();
         if (inboxObserved || isCurrentlyObservedByUI(event, channelTargetId, chatType)) {
+            MessageTracer::instance()->step("text", event.messageToken(), "notificationSuppressed");
+            Metrics::instance()->increment(Metrics::NotificationsSuppressed);
+            Metrics::instance()->stop(Metrics::NotifyLatency, event.messageToken());
             if (!m_ngfClient->isConnected())
                 m_ngfClient->connect();
 
@@ -262,8 +268,9 @@ void NotificationManager::showNotification(const CommHistory::Event& event,
                 } else {
                     ngfEvent = &NgfdEventChat;
                 }
-                DEBUG() << Q_FUNC_INFO << "play ngf event: " << ngfEvent;
+                qCDebug(lcNotification) << Q_FUNC_INFO << "play ngf event: " << ngfEvent;
                 m_ngfEvent = m_ngfClient->play(*ngfEvent, properties);
+                DBusCallStats::instance()->count(QStringLiteral("com.nokia.NonGraphicFeedback1.Backend"), QStringLiteral("Play"));
             }
 
             return;
@@ -278,18 +285,14 @@ void NotificationManager::showNotification(const CommHistory::Event& event,
 
     // Get MUC topic from group
     QString chatName;
-    if (m_GroupModel && (chatType == CommHistory::Group::ChatTypeUnnamed ||
+    if (m_GroupCache && (chatType == CommHistory::Group::ChatTypeUnnamed ||
         chatType == CommHistory::Group::ChatTypeRoom)) {
-        for (int i = 0; i < m_GroupModel->rowCount(); i++) {
-            QModelIndex row = m_GroupModel->index(i, 0);
-            CommHistory::Group group = m_GroupModel->group(row);
-            if (group.isValid() && group.id() == event.groupId()) {
-                chatName = group.chatName();
-                if (chatName.isEmpty())
-                    chatName = txt_qtn_msg_group_chat;
-                DEBUG() << Q_FUNC_INFO << "Using chatName:" << chatName;
-                break;
-            }
+        CommHistory::Group group = m_GroupCache->groupById(event.groupId());
+        if (group.isValid()) {
+            chatName = group.chatName();
+            if (chatName.isEmpty())
+                chatName = txt_qtn_msg_group_chat;
+            qCDebug(lcNotification) << Q_FUNC_INFO << "Using chatName:" << chatName;
         }
     }
 
@@ -335,7 +338,7 @@ void NotificationManager::resolveNotification(PersonalNotification *pn)
         // Add notification immediately
         addNotification(pn);
     } else {
-        DEBUG() << Q_FUNC_INFO << "Trying to resolve contact for" << pn->account() << pn->remoteUid();
+        qCDebug(lcNotification) << Q_FUNC_INFO << "Trying to resolve contact for" << pn->account() << pn->remoteUid();
         m_unresolvedNotifications.append(pn);
         m_contactResolver->add(pn->recipient());
     }
@@ -347,11 +350,13 @@ void NotificationManager::playClass0SMSAlert()
         m_ngfClient->connect();
 
     m_ngfEvent = m_ngfClient->play(QLatin1Literal("sms"));
+    DBusCallStats::instance()->count(QStringLiteral("com.nokia.NonGraphicFeedback1.Backend"), QStringLiteral("Play"));
 
     // ask mce to undim the screen
     QString mceMethod = QString::fromLatin1(MCE_DISPLAY_ON_REQ);
     QDBusMessage msg = QDBusMessage::createMethodCall(MCE_SERVICE, MCE_REQUEST_PATH, MCE_REQUEST_IF, mceMethod);
     QDBusConnection::systemBus().call(msg, QDBus::NoBlock);
+    DBusCallStats::instance()->count(MCE_SERVICE, mceMethod);
 }
 
 void NotificationManager::requestClass0Notification(const CommHistory::Event &event)
@@ -365,6 +370,8 @@ void NotificationManager::requestClass0Notification(const CommHistory::Event &ev
     msg.setArguments(arguments);
     if (!QDBusConnection::sessionBus().callWithCallback(msg, this, 0, SLOT(slotClassZeroError(QDBusError)))) {
         qWarning() << "Unable to create class 0 SMS notification request";
+    } else {
+        DBusCallStats::instance()->count(msg.service(), msg.member());
     }
 }
 
@@ -423,7 +430,7 @@ static void removeListNotifications(
 
 void NotificationManager::removeNotifications(const QString &accountPath, const QList<int> &removeTypes)
 {
-    DEBUG() << Q_FUNC_INFO << "Removing notifications of account " << accountPath;
+    qCDebug(lcNotification) << Q_FUNC_INFO << "Removing notifications of account " << accountPath;
 
     // remove matched notifications
     removeListNotifications(&m_notifications, accountPath, removeTypes);
@@ -453,7 +460,7 @@ void NotificationManager::slotObservedConversationsChanged(const QList<CommHisto
 
 void NotificationManager::slotInboxObservedChanged()
 {
-    DEBUG() << Q_FUNC_INFO;
+    qCDebug(lcNotification) << Q_FUNC_INFO;
 
     // Cannot be passed as a parameter, because this slot is also used for m_notificationTimer
     bool observed = CommHistoryService::instance()->inboxObserved();
@@ -467,7 +474,7 @@ void NotificationManager::slotInboxObservedChanged()
         } else {
             // Filtering is in use, remove only notifications of that account whose threads are visible in inbox:
             QString filteredAccountPath = filteredInboxAccountPath();
-            DEBUG() << Q_FUNC_INFO << "Removing only notifications belonging to account " << filteredAccountPath;
+            qCDebug(lcNotification) << Q_FUNC_INFO << "Removing only notifications belonging to account " << filteredAccountPath;
             if (!filteredAccountPath.isEmpty())
                 removeNotifications(filteredAccountPath, removeTypes);
         }
@@ -503,7 +510,7 @@ void NotificationManager::removeNotificationToken(const QString &token)
 
 void NotificationManager::removeNotificationTypes(const QList<int> &types)
 {
-    DEBUG() << Q_FUNC_INFO << types;
+    qCDebug(lcNotification) << Q_FUNC_INFO << types;
 
     auto eraseFrom = std::find_if(m_notifications.begin(), m_notifications.end(), [&](PersonalNotification *notification) {
         return types.contains(notification->eventType());
@@ -738,11 +745,11 @@ void NotificationManager::setNotificationProperties(Notification *notification,
 
 void NotificationManager::slotContactResolveFinished()
 {
-    DEBUG() << Q_FUNC_INFO;
+    qCDebug(lcNotification) << Q_FUNC_INFO;
 
     // All events are now resolved
     foreach (PersonalNotification *notification, m_unresolvedNotifications) {
-        DEBUG() << "Resolved contact for notification" << notification->account() << notification->remoteUid() << notification->contactId();
+        qCDebug(lcNotification) << "Resolved contact for notification" << notification->account() << notification->remoteUid() << notification->contactId();
         notification->updateRecipientData();
         addNotification(notification);
     }
@@ -750,14 +757,30 @@ void NotificationManager::slotContactResolveFinished()
     m_unresolvedNotifications.clear();
 }
 
+// Captured for bm_replay
+static void recordContactsChanged(bool infoOnly, const RecipientList &recipients)
+{
+    TrafficRecorder *recorder = TrafficRecorder::instance();
+    if (!recorder->isRecording())
+        return;
+
+    QVariantList recorded;
+    for (int i = 0; i < recipients.count(); i++) {
+        const Recipient recipient(recipients.value(i));
+        recorded.append(QVariant(QStringList() << recipient.localUid() << recipient.remoteUid()));
+    }
+    recorder->record(TrafficRecorder::ContactsChanged, QVariantList() << infoOnly << QVariant(recorded));
+}
+
 void NotificationManager::slotContactChanged(const RecipientList &recipients)
 {
-    DEBUG() << Q_FUNC_INFO << recipients;
+    qCDebug(lcNotification) << Q_FUNC_INFO << recipients;
+    recordContactsChanged(false, recipients);
 
     // Check all existing notifications and update if necessary
     foreach (PersonalNotification *notification, m_notifications) {
         if (recipients.contains(notification->recipient())) {
-            DEBUG() << "Contact changed for notification" << notification->account() << notification->remoteUid() << notification->contactId();
+            qCDebug(lcNotification) << "Contact changed for notification" << notification->account() << notification->remoteUid() << notification->contactId();
             notification->updateRecipientData();
         }
     }
@@ -765,12 +788,13 @@ void NotificationManager::slotContactChanged(const RecipientList &recipients)
 
 void NotificationManager::slotContactInfoChanged(const RecipientList &recipients)
 {
-    DEBUG() << Q_FUNC_INFO << recipients;
+    qCDebug(lcNotification) << Q_FUNC_INFO << recipients;
+    recordContactsChanged(true, recipients);
 
     // Check all existing notifications and update if necessary
     foreach (PersonalNotification *notification, m_notifications) {
         if (recipients.contains(notification->recipient())) {
-            DEBUG() << "Contact info changed for notification" << notification->account() << notification->remoteUid() << notification->contactId();
+            qCDebug(lcNotification) << "Contact info changed for notification" << notification->account() << notification->remoteUid() << notification->contactId();
             notification->updateRecipientData();
         }
     }
@@ -781,35 +805,34 @@ void NotificationManager::slotClassZeroError(const QDBusError &error)
     qWarning() << "Class 0 SMS notification failed:" << error.message();
 }
 
-CommHistory::GroupModel* NotificationManager::groupModel()
+GroupCache* NotificationManager::groupCache()
 {
-    if (!m_GroupModel) {
-        m_GroupModel = new CommHistory::GroupModel(this);
-        m_GroupModel->setResolveContacts(GroupManager::DoNotResolve);
-        connect(m_GroupModel,
+    if (!m_GroupCache) {
+        m_GroupCache = new GroupCache(this);
+        connect(m_GroupCache,
                 SIGNAL(rowsAboutToBeRemoved(const QModelIndex&, int, int)),
                 this,
                 SLOT(slotGroupRemoved(const QModelIndex&, int, int)));
-        connect(m_GroupModel,
+        connect(m_GroupCache,
                 SIGNAL(dataChanged(const QModelIndex&, const QModelIndex&)),
                 this,
                 SLOT(slotGroupDataChanged(const QModelIndex&, const QModelIndex&)));
-        if (!m_GroupModel->getGroups()) {
+        if (!m_GroupCache->getGroups()) {
             qCritical() << "Failed to request group ";
-            delete m_GroupModel;
-            m_GroupModel = 0;
+            delete m_GroupCache;
+            m_GroupCache = 0;
         }
     }
 
-    return m_GroupModel;
+    return m_GroupCache;
 }
 
 void NotificationManager::slotGroupRemoved(const QModelIndex &index, int start, int end)
 {
-    DEBUG() << Q_FUNC_INFO;
+    qCDebug(lcNotification) << Q_FUNC_INFO;
     for (int i = start; i <= end; i++) {
-        QModelIndex row = m_GroupModel->index(i, 0, index);
-        Group group = m_GroupModel->group(row);
+        QModelIndex row = m_GroupCache->index(i, 0, index);
+        Group group = m_GroupCache->group(row);
         if (group.isValid() && !group.recipients().isEmpty()) {
             removeConversationNotifications(group.recipients().value(0), group.chatType());
         }
@@ -823,12 +846,12 @@ void NotificationManager::showVoicemailNotification(int count)
 
 void NotificationManager::slotGroupDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight)
 {
-    DEBUG() << Q_FUNC_INFO;
+    qCDebug(lcNotification) << Q_FUNC_INFO;
 
     // Update MUC notifications if MUC topic has changed
     for (int i = topLeft.row(); i <= bottomRight.row(); i++) {
-        QModelIndex row = m_GroupModel->index(i, 0);
-        CommHistory::Group group = m_GroupModel->group(row);
+        QModelIndex row = m_GroupCache->index(i, 0);
+        CommHistory::Group group = m_GroupCache->group(row);
         if (group.isValid()) {
             const Recipient &groupRecipient(group.recipients().value(0));
 
@@ -844,7 +867,7 @@ void NotificationManager::slotGroupDataChanged(const QModelIndex &topLeft, const
                             newChatName = group.chatName();
 
                         if (!newChatName.isEmpty()) {
-                            DEBUG() << Q_FUNC_INFO << "Changing chat name to" << newChatName;
+                            qCDebug(lcNotification) << Q_FUNC_INFO << "Changing chat name to" << newChatName;
                             pn->setChatName(newChatName);
                         }
                     }
@@ -866,7 +889,7 @@ void NotificationManager::slotVoicemailWaitingChanged()
     const bool waiting(mw->voicemailWaiting());
     const int messageCount(mw->voicemailMessageCount());
 
-    DEBUG() << Q_FUNC_INFO << waiting << messageCount;
+    qCDebug(lcNotification) << Q_FUNC_INFO << waiting << messageCount;
 
     uint currentId = 0;
 
@@ -878,10 +901,10 @@ void NotificationManager::slotVoicemailWaitingChanged()
             if (waiting) {
                 // The notification is already present; do nothing
                 currentId = n->replacesId();
-                DEBUG() << "Extant voicemail waiting notification:" << n->replacesId();
+                qCDebug(lcNotification) << "Extant voicemail waiting notification:" << n->replacesId();
             } else {
                 // Close this notification
-                DEBUG() << "Closing voicemail waiting notification:" << n->replacesId();
+                qCDebug(lcNotification) << "Closing voicemail waiting notification:" << n->replacesId();
                 n->close();
             }
         }
@@ -932,14 +955,17 @@ void NotificationManager::slotVoicemailWaitingChanged()
                                                               << dbusAction("app", QString(), service, path, iface, method, args));
 
         voicemailNotification.setReplacesId(currentId);
-        voicemailNotification.publish();
-        DEBUG() << (currentId ? "Updated" : "Created") << "voicemail waiting notification:" << voicemailNotification.replacesId();
+        {
+            DBusSyncCall accounting(QStringLiteral("org.freedesktop.Notifications"), QStringLiteral("Notify"));
+            voicemailNotification.publish();
+        }
+        qCDebug(lcNotification) << (currentId ? "Updated" : "Created") << "voicemail waiting notification:" << voicemailNotification.replacesId();
     }
 }
 
 void NotificationManager::slotModemsChanged(QStringList modems)
 {
-    DEBUG() << "NotificationManager::slotModemsChanged";
+    qCDebug(lcNotification) << "NotificationManager::slotModemsChanged";
     qDeleteAll(interfaces.values());
     interfaces.clear();
     foreach (QString path, modems)
@@ -948,20 +974,20 @@ void NotificationManager::slotModemsChanged(QStringList modems)
 
 void NotificationManager::slotModemAdded(QString path)
 {
-    DEBUG() << "NotificationManager::slotModemAdded: " << path;
+    qCDebug(lcNotification) << "NotificationManager::slotModemAdded: " << path;
     delete interfaces.take(path);
     addModem(path);
 }
 
 void NotificationManager::slotModemRemoved(QString path)
 {
-    DEBUG() << "NotificationManager::slotModemRemoved: " << path;
+    qCDebug(lcNotification) << "NotificationManager::slotModemRemoved: " << path;
     delete interfaces.take(path);
 }
 
 void NotificationManager::slotValidChanged(bool valid)
 {
-    DEBUG() << "NotificationManager::slotValidChanged to: " << valid;
+    qCDebug(lcNotification) << "NotificationManager::slotValidChanged to: " << valid;
     QOfonoMessageWaiting *mw = (QOfonoMessageWaiting*)sender();
     if (mw->isValid()) {
         slotVoicemailWaitingChanged();
@@ -39,7 +39,6 @@
 
 #include <CommHistory/Event>
 #include <CommHistory/Group>
-#include <CommHistory/GroupModel>
 #include <CommHistory/ContactListener>
 #include <CommHistory/ContactResolver>
 #include <CommHistory/Recipient>
@@ -47,6 +46,7 @@
 // our includes
 #include "commhistoryservice.h"
 #include "personalnotification.h"
+#include "groupcache.h"
 
 namespace Ngf {
     class Client;
@@ -96,7 +96,7 @@ public:
      * \brief return group model with all conversations
      * \returns group model pointer
      */
-    CommHistory::GroupModel* groupModel();
+    GroupCache* groupCache();
 
     /*!
      * \brief Show voicemail notification or removes it if count is 0
@@ -172,7 +172,7 @@ private:
 
     CommHistory::ContactResolver *m_contactResolver;
     QSharedPointer<CommHistory::ContactListener> m_contactListener;
-    CommHistory::GroupModel *m_GroupModel;
+    GroupCache *m_GroupCache;
 
     Ngf::Client *m_ngfClient;
     quint32 m_ngfEvent;
@@ -182,6 +182,7 @@ private:
 
 #ifdef UNIT_TEST
     friend class Ut_NotificationManager;
+    friend class Bm_NotificationManager;
 #endif
 };
 
@@ -23,6 +23,9 @@
 
 #include "personalnotification.h"
 #include "notificationmanager.h"
+#include "messagetracer.h"
+#include "metrics.h"
+#include "dbuscallstats.h"
 #include "locstrings.h"
 #include "constants.h"
 #include "debug.h"
@@ -174,16 +177,24 @@ void PersonalNotification::publishNotification()
         m_notification->setUrgency(Notification::Low);
     }
 
-    m_notification->publish();
+    {
+        DBusSyncCall accounting(QStringLiteral("org.freedesktop.Notifications"), QStringLiteral("Notify"));
+        m_notification->publish();
+    }
+    MessageTracer::instance()->step("text", m_eventToken, "notificationPublished");
+    Metrics::instance()->increment(Metrics::NotificationsPublished);
+    foreach (const QString &token, m_unpublishedTokens)
+        Metrics::instance()->stop(Metrics::NotifyLatency, token);
+    m_unpublishedTokens.clear();
 
     setHasPendingEvents(false);
 
-    DEBUG() << m_notification->replacesId() << m_notification->category() << m_notification->summary() << m_notification->body();
+    qCDebug(lcNotification) << m_notification->replacesId() << m_notification->category() << m_notification->summary() << m_notification->body();
 }
 
 void PersonalNotification::removeNotification()
 {
-    DEBUG() << "removing notification" << m_notification;
+    qCDebug(lcNotification) << "removing notification" << m_notification;
     if (m_notification) {
         m_notification->close();
         m_notification->deleteLater();
@@ -378,6 +389,8 @@ void PersonalNotification::setEventToken(const QString &eventToken)
 {
     if (m_eventToken != eventToken) {
         m_eventToken = eventToken;
+        if (!eventToken.isEmpty())
+            m_unpublishedTokens.append(eventToken);
         setHasPendingEvents(true);
     }
 }
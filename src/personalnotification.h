@@ -26,6 +26,7 @@
 
 #include <QObject>
 #include <QString>
+#include <QStringList>
 #include <QMetaType>
 
 #include "serialisable.h"
@@ -145,6 +146,8 @@ private:
     bool m_hasPendingEvents;
     QString m_chatName;
     QString m_eventToken;
+    // Tokens merged into this notification since it was last published
+    QStringList m_unpublishedTokens;
     QString m_smsReplaceNumber;
     bool m_hidden;
     bool m_restored;
@@ -0,0 +1,230 @@
+/******************************************************************************
+**
+** This file is part of commhistory-daemon.
+**
+** Copyright (C) 2026 Jolla Ltd.
+**
+** This library is free software; you can redistribute it and/or modify it
+** under the terms of the GNU Lesser General Public License version 2.1 as
+** published by the Free Software Foundation.
+**
+** This library is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+** or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+** License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this library; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+**
+******************************************************************************/
+
+
+#include "shutdowncoordinator.h"
+#include "debug.h"
+
+#include <QCoreApplication>
+#include <QSocketNotifier>
+
+#include <unistd.h>
+
+#define DEBUG_(x) qCDebug(lcDaemon) << "ShutdownCoordinator:" << x
+
+using namespace RTComLogger;
+
+// Default time allowed for draining, well below the stop timeout of systemd
+static const int kDefaultDeadlineMs = 3000;
+static const int kPollIntervalMs = 20;
+
+static ShutdownCoordinator *coordinator = 0;
+
+ShutdownCoordinator* ShutdownCoordinator::instance()
+{
+    if (!coordinator)
+        coordinator = new ShutdownCoordinator(QCoreApplication::instance());
+    return coordinator;
+}
+
+ShutdownCoordinator::ShutdownCoordinator(QObject *parent)
+    : QObject(parent),
+      m_notifier(0),
+      m_deadline(kDefaultDeadlineMs),
+      m_shuttingDown(false)
+{
+    m_pollTimer.setInterval(kPollIntervalMs);
+    connect(&m_pollTimer, SIGNAL(timeout()), SLOT(checkDrained()));
+}
+
+ShutdownCoordinator::~ShutdownCoordinator()
+{
+    coordinator = 0;
+}
+
+void ShutdownCoordinator::setSignalSocket(int fd)
+{
+    delete m_notifier;
+    m_notifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+    connect(m_notifier, SIGNAL(activated(int)), SLOT(onSignalActivated(int)));
+}
+
+void ShutdownCoordinator::setDeadline(int msecs)
+{
+    m_deadline = qMax(0, msecs);
+}
+
+int ShutdownCoordinator::deadline() const
+{
+    return m_deadline;
+}
+
+void ShutdownCoordinator::addParticipant(const QString &name, ShutdownParticipant *participant)
+{
+    Participant entry;
+    entry.name = name;
+    entry.participant = participant;
+    m_participants.append(entry);
+
+    // Late comers are drained right away
+    if (m_shuttingDown)
+        participant->drain();
+}
+
+void ShutdownCoordinator::removeParticipant(ShutdownParticipant *participant)
+{
+    // Listeners are deleted with the application after the coordinator
+    if (!coordinator)
+        return;
+
+    QList<Participant> &participants(coordinator->m_participants);
+    QList<Participant>::iterator it = participants.begin();
+    while (it != participants.end()) {
+        if (it->participant == participant)
+            it = participants.erase(it);
+        else
+            ++it;
+    }
+}
+
+bool ShutdownCoordinator::isShuttingDown() const
+{
+    return m_shuttingDown;
+}
+
+QVariantMap ShutdownCoordinator::report() const
+{
+    return m_report;
+}
+
+void ShutdownCoordinator::onSignalActivated(int fd)
+{
+    char a;
+    if (::read(fd, &a, sizeof(a)) < 1)
+        qWarning() << "Failed to read term signal";
+
+    if (m_shuttingDown) {
+        qWarning() << "Second SIGTERM, not waiting for pending work";
+        finish();
+    } else {
+        shutdown();
+    }
+}
+
+void ShutdownCoordinator::shutdown()
+{
+    if (m_shuttingDown)
+        return;
+
+    m_shuttingDown = true;
+    m_elapsed.start();
+    m_initial = collectPending();
+    DEBUG_("draining" << m_participants.count() << "participant(s), deadline" << m_deadline << "ms");
+
+    // Draining one participant may delete others, so each one is looked
+    // up again before it is drained
+    QList<ShutdownParticipant*> participants;
+    foreach (const Participant &entry, m_participants)
+        participants.append(entry.participant);
+    foreach (ShutdownParticipant *participant, participants) {
+        if (isParticipant(participant))
+            participant->drain();
+    }
+
+    checkDrained();
+    if (m_report.isEmpty())
+        m_pollTimer.start();
+}
+
+bool ShutdownCoordinator::isParticipant(ShutdownParticipant *participant) const
+{
+    foreach (const Participant &entry, m_participants) {
+        if (entry.participant == participant)
+            return true;
+    }
+    return false;
+}
+
+QVariantMap ShutdownCoordinator::collectPending() const
+{
+    // Summed over participants with the same name
+    QVariantMap pending;
+    foreach (const Participant &entry, m_participants) {
+        const QVariantMap work(entry.participant->pendingWork());
+        for (QVariantMap::const_iterator it = work.constBegin(); it != work.constEnd(); ++it) {
+            const QString key(entry.name + QLatin1Char('/') + it.key());
+            pending.insert(key, pending.value(key).toInt() + it.value().toInt());
+        }
+    }
+    return pending;
+}
+
+void ShutdownCoordinator::checkDrained()
+{
+    if (!m_report.isEmpty())
+        return;
+
+    const QVariantMap pending(collectPending());
+    bool empty = true;
+    foreach (const QVariant &count, pending) {
+        if (count.toInt() > 0) {
+            empty = false;
+            break;
+        }
+    }
+
+    if (empty || m_elapsed.elapsed() >= m_deadline)
+        finish();
+}
+
+void ShutdownCoordinator::finish()
+{
+    if (!m_report.isEmpty())
+        return;
+
+    m_pollTimer.stop();
+
+    const QVariantMap pending(collectPending());
+    QVariantMap drained;
+    QVariantMap abandoned;
+
+    // Work that appeared during the drain is not in the initial snapshot
+    QVariantMap kinds(m_initial);
+    kinds.unite(pending);
+    foreach (const QString &key, kinds.uniqueKeys()) {
+        const int before = m_initial.value(key).toInt();
+        const int left = pending.value(key).toInt();
+        if (before > left)
+            drained.insert(key, before - left);
+        if (left > 0)
+            abandoned.insert(key, left);
+    }
+
+    m_report.insert(QLatin1String("drained"), drained);
+    m_report.insert(QLatin1String("abandoned"), abandoned);
+    m_report.insert(QLatin1String("elapsed"), m_elapsed.isValid() ? m_elapsed.elapsed() : 0);
+
+    DEBUG_("drained in" << m_report.value(QLatin1String("elapsed")).toLongLong() << "ms:" << drained);
+    if (!abandoned.isEmpty())
+        qCritical() << "Exiting with pending work, it is recovered at next start if possible:" << abandoned;
+
+    emit finished(m_report);
+}
@@ -0,0 +1,136 @@
+/******************************************************************************
+**
+** This file is part of commhistory-daemon.
+**
+** Copyright (C) 2026 Jolla Ltd.
+**
+** This library is free software; you can redistribute it and/or modify it
+** under the terms of the GNU Lesser General Public License version 2.1 as
+** published by the Free Software Foundation.
+**
+** This library is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+** or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+** License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this library; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+**
+******************************************************************************/
+
+
+#ifndef SHUTDOWNCOORDINATOR_H
+#define SHUTDOWNCOORDINATOR_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QList>
+#include <QString>
+#include <QTimer>
+#include <QVariantMap>
+
+class QSocketNotifier;
+
+namespace RTComLogger
+{
+
+/*!
+ * \class ShutdownParticipant
+ * \brief Implemented by objects holding work that is lost if the daemon
+ * exits before it is written out.
+ */
+class ShutdownParticipant
+{
+public:
+    virtual ~ShutdownParticipant() {}
+
+    /*!
+     * \brief Starts writing out pending work right away instead of
+     * waiting for batching or retry timers. Must not block.
+     */
+    virtual void drain() = 0;
+
+    /*!
+     * \brief Kind of work => number of items not written out yet.
+     */
+    virtual QVariantMap pendingWork() const = 0;
+};
+
+/*!
+ * \class ShutdownCoordinator
+ * \brief Drains pending work of all participants on SIGTERM before the
+ * main loop is quit.
+ *
+ * The main loop keeps running until every participant reports no pending
+ * work or the deadline passes, whichever comes first. A second SIGTERM
+ * ends the drain immediately. What was drained and what was abandoned is
+ * logged and passed in finished().
+ */
+class ShutdownCoordinator : public QObject
+{
+    Q_OBJECT
+
+public:
+    static ShutdownCoordinator* instance();
+
+    /*!
+     * \brief Watches \a fd, the reading end of the SIGTERM socket pair.
+     */
+    void setSignalSocket(int fd);
+
+    void setDeadline(int msecs);
+    int deadline() const;
+
+    void addParticipant(const QString &name, ShutdownParticipant *participant);
+
+    /*!
+     * \brief Safe to call from destructors run after the coordinator
+     * itself is gone.
+     */
+    static void removeParticipant(ShutdownParticipant *participant);
+
+    bool isShuttingDown() const;
+
+    /*!
+     * \brief "drained" and "abandoned" maps of participant/kind => count,
+     * and "elapsed" milliseconds, of the last shutdown.
+     */
+    QVariantMap report() const;
+
+public Q_SLOTS:
+    void shutdown();
+
+Q_SIGNALS:
+    void finished(const QVariantMap &report);
+
+private Q_SLOTS:
+    void onSignalActivated(int fd);
+    void checkDrained();
+
+private:
+    explicit ShutdownCoordinator(QObject *parent);
+    ~ShutdownCoordinator();
+
+    struct Participant {
+        QString name;
+        ShutdownParticipant *participant;
+    };
+
+    bool isParticipant(ShutdownParticipant *participant) const;
+    QVariantMap collectPending() const;
+    void finish();
+
+    QList<Participant> m_participants;
+    QSocketNotifier *m_notifier;
+    QTimer m_pollTimer;
+    QElapsedTimer m_elapsed;
+    int m_deadline;
+    bool m_shuttingDown;
+    QVariantMap m_initial;
+    QVariantMap m_report;
+};
+
+} // namespace RTComLogger
+
+#endif // SHUTDOWNCOORDINATOR_H
@@ -21,7 +21,9 @@
 
 #include "smartmessaging.h"
 #include "notificationmanager.h"
+#include "eventmodelpool.h"
 #include "constants.h"
+#include "debug.h"
 
 #include <CommHistory/event.h>
 #include <CommHistory/messagepart.h>
@@ -32,7 +34,7 @@
 #define VCARD_CONTENT_TYPE  "text/x-vcard"
 #define VCARD_EXTENSION     "vcf"
 
-#define DEBUG_(x) qDebug() << "SmartMessaging:" << x
+#define DEBUG_(x) qCDebug(lcText) << "SmartMessaging:" << x
 
 using namespace CommHistory;
 using namespace RTComLogger;
@@ -194,8 +196,8 @@ void SmartMessaging::onReceiveBusinessCard(const QByteArray &vcard, const QVaria
         return;
     }
 
-    EventModel model;
-    if (!model.addEvent(event)) {
+    PooledEventModel model;
+    if (!model->addEvent(event)) {
         qCritical() << "Failed to save vCard notification event; message dropped" << event.toString();
         return;
     }
@@ -203,15 +205,15 @@ void SmartMessaging::onReceiveBusinessCard(const QByteArray &vcard, const QVaria
     MessagePart part;
     if (!save(event.id(), vcard, part)) {
         qWarning() << "Failed to store vCard";
-        model.deleteEvent(event.id());
+        model->deleteEvent(event.id());
         return;
     }
 
     event.setStatus(Event::ReceivedStatus);
     event.setMessageParts(QList<MessagePart>() << part);
-    if (!model.modifyEvent(event)) {
+    if (!model->modifyEvent(event)) {
         qCritical() << "Failed to update vCard event:" << event.toString();
-        model.deleteEvent(event.id());
+        model->deleteEvent(event.id());
     }
 
     NotificationManager::instance()->showNotification(event, from, Group::ChatTypeP2P);
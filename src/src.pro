@@ -31,7 +31,7 @@ TARGET = commhistoryd
 # -----------------------------------------------------------------------------
 # dependencies
 # -----------------------------------------------------------------------------
-QT += dbus contacts versit
+QT += dbus sql contacts versit
 QT -= gui
 
 PKGCONFIG += ngf-qt5 mce nemonotifications-qt5
@@ -72,8 +72,22 @@ HEADERS += logger.h \
            lastdialedcache.h \
            debug.h \
            fscleanup.h \
+           calljournal.h \
+           eventmodelpool.h \
+           eventstorage.h \
+           startupscheduler.h \
+           groupcache.h \
+           shutdowncoordinator.h \
+           asynclogger.h \
+           messagetracer.h \
+           metrics.h \
+           dbuscallstats.h \
+           trafficrecorder.h \
+           stalldetector.h \
            mmshandler.h \
            mmspart.h \
+           mmslocationfilter.h \
+           databasereader.h \
            messagehandlerbase.h \
            smartmessaging.h
 
@@ -97,8 +111,23 @@ SOURCES += main.cpp \
            accountpresenceservice.cpp \
            lastdialedcache.cpp \
            fscleanup.cpp \
+           calljournal.cpp \
+           eventmodelpool.cpp \
+           eventstorage.cpp \
+           startupscheduler.cpp \
+           groupcache.cpp \
+           shutdowncoordinator.cpp \
+           asynclogger.cpp \
+           debug.cpp \
+           messagetracer.cpp \
+           metrics.cpp \
+           dbuscallstats.cpp \
+           trafficrecorder.cpp \
+           stalldetector.cpp \
            mmshandler.cpp \
            mmspart.cpp \
+           mmslocationfilter.cpp \
+           databasereader.cpp \
            messagehandlerbase.cpp \
            smartmessaging.cpp
 
@@ -202,6 +231,15 @@ cli_connection_moc_cpp.variable_out = SOURCES
 cli_connection_moc_cpp.commands = true
 QMAKE_EXTRA_COMPILERS += cli_connection_moc_cpp
 
+# -----------------------------------------------------------------------------
+# "make startup-benchmark" starts the daemon, runs all startup stages and
+# prints the per-stage timings. No other instance may be running.
+# -----------------------------------------------------------------------------
+startup_benchmark.target = startup-benchmark
+startup_benchmark.depends = $$TARGET
+startup_benchmark.commands = ./$$TARGET --startup-benchmark
+QMAKE_EXTRA_TARGETS += startup_benchmark
+
 # -----------------------------------------------------------------------------
 # common installation setup
 # NOTE: remember to set headers.files before this include to have the headers
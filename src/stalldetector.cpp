@@ -0,0 +1,194 @@
+/******************************************************************************
+**
+** This file is part of commhistory-daemon.
+**
+** Copyright (C) 2026 Jolla Ltd.
+**
+** This library is free software; you can redistribute it and/or modify it
+** under the terms of the GNU Lesser General Public License version 2.1 as
+** published by the Free Software Foundation.
+**
+** This library is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+** or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+** License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this library; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+**
+******************************************************************************/
+
+
+#include "stalldetector.h"
+#include "debug.h"
+
+#include <QCoreApplication>
+#include <QEvent>
+#include <QThread>
+
+#include <algorithm>
+
+#define DEBUG_(x) qCDebug(lcDaemon) << "StallDetector:" << x
+
+using namespace RTComLogger;
+
+// How often the event loop latency is sampled
+#define PROBE_INTERVAL_MS 50
+// Culprits listed in the statistics
+#define WORST_CULPRITS 10
+
+class StallDetector::Watchdog : public QThread
+{
+public:
+    explicit Watchdog(StallDetector *detector)
+        : m_detector(detector), m_stop(0) {}
+
+    void stop()
+    {
+        m_stop.store(1);
+        wait();
+    }
+
+protected:
+    void run()
+    {
+        const int checkInterval = qMax(10, m_detector->m_threshold / 2);
+        while (!m_stop.load()) {
+            msleep(checkInterval);
+
+            // Only the first sample of a stall is kept, later ones may
+            // already see nested event processing
+            const qint64 silent = m_detector->m_clock.elapsed() - m_detector->m_heartbeat.load();
+            if (silent > m_detector->m_threshold && !m_detector->m_stallClass.load()) {
+                m_detector->m_stallEvent.store(m_detector->m_deliveringEvent.load());
+                m_detector->m_stallClass.store(m_detector->m_deliveringClass.load());
+            }
+        }
+    }
+
+private:
+    StallDetector *m_detector;
+    QAtomicInt m_stop;
+};
+
+StallDetector::StallDetector(int thresholdMs, QObject *parent)
+    : QObject(parent),
+      m_threshold(thresholdMs),
+      m_lastProbe(0),
+      m_stalls(0),
+      m_stalledMs(0),
+      m_heartbeat(0),
+      m_deliveringClass(0),
+      m_deliveringEvent(0),
+      m_stallClass(0),
+      m_stallEvent(0)
+{
+    m_clock.start();
+
+    QCoreApplication::instance()->installEventFilter(this);
+
+    m_probeTimer.setInterval(PROBE_INTERVAL_MS);
+    connect(&m_probeTimer, SIGNAL(timeout()), SLOT(probe()));
+    m_probeTimer.start();
+
+    m_watchdog = new Watchdog(this);
+    m_watchdog->start(QThread::LowPriority);
+
+    DEBUG_("watching for stalls over" << m_threshold << "ms");
+}
+
+StallDetector::~StallDetector()
+{
+    m_watchdog->stop();
+    delete m_watchdog;
+}
+
+bool StallDetector::eventFilter(QObject *object, QEvent *event)
+{
+    // Sees every event delivered on the main thread, keep it cheap
+    m_deliveringClass.store(object->metaObject()->className());
+    m_deliveringEvent.store(event->type());
+    return false;
+}
+
+void StallDetector::probe()
+{
+    const qint64 now = m_clock.elapsed();
+
+    if (m_lastProbe) {
+        const qint64 late = now - m_lastProbe - PROBE_INTERVAL_MS;
+        m_latency.record(qMax(qint64(0), late));
+
+        if (late >= m_threshold) {
+            const char *className = m_stallClass.load();
+            const QString culprit(className ? describe(className, m_stallEvent.load())
+                                            : QStringLiteral("unknown"));
+
+            Culprit &entry(m_culprits[culprit]);
+            entry.count++;
+            entry.totalMs += late;
+            entry.worstMs = qMax(entry.worstMs, late);
+            m_stalls++;
+            m_stalledMs += late;
+
+            qWarning() << "Main loop stalled for" << late << "ms in" << culprit;
+        }
+    }
+
+    m_lastProbe = now;
+    m_stallClass.store(0);
+    m_heartbeat.store(now);
+}
+
+QString StallDetector::describe(const char *className, int eventType) const
+{
+    QString type;
+    switch (eventType) {
+    case QEvent::Timer:
+        type = QStringLiteral("timer");
+        break;
+    case QEvent::MetaCall:
+        type = QStringLiteral("queued call");
+        break;
+    case QEvent::SockAct:
+        type = QStringLiteral("socket");
+        break;
+    case QEvent::DeferredDelete:
+        type = QStringLiteral("deferred delete");
+        break;
+    default:
+        type = QStringLiteral("event ") + QString::number(eventType);
+        break;
+    }
+    return QLatin1String(className) + QStringLiteral(" (") + type + QLatin1Char(')');
+}
+
+static bool worseThan(const QVariant &a, const QVariant &b)
+{
+    return a.toMap().value(QStringLiteral("worstMs")).toLongLong()
+            > b.toMap().value(QStringLiteral("worstMs")).toLongLong();
+}
+
+QVariantMap StallDetector::statistics() const
+{
+    QVariantList culprits;
+    for (QHash<QString, Culprit>::const_iterator it = m_culprits.constBegin(); it != m_culprits.constEnd(); ++it) {
+        QVariantMap culprit;
+        culprit.insert(QStringLiteral("culprit"), it.key());
+        culprit.insert(QStringLiteral("count"), it->count);
+        culprit.insert(QStringLiteral("totalMs"), it->totalMs);
+        culprit.insert(QStringLiteral("worstMs"), it->worstMs);
+        culprits.append(culprit);
+    }
+    std::sort(culprits.begin(), culprits.end(), worseThan);
+    culprits = culprits.mid(0, WORST_CULPRITS);
+
+    QVariantMap result;
+    result.insert(QStringLiteral("thresholdMs"), m_threshold);
+    result.insert(QStringLiteral("count"), m_stalls);
+    result.insert(QStringLiteral("totalMs"), m_stalledMs);
+    result.insert(QStringLiteral("latencyMs"), m_latency.toMap());
+    result.insert(QStringLiteral("worst"), culprits);
+    return result;
+}
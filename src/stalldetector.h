@@ -0,0 +1,106 @@
+/******************************************************************************
+**
+** This file is part of commhistory-daemon.
+**
+** Copyright (C) 2026 Jolla Ltd.
+**
+** This library is free software; you can redistribute it and/or modify it
+** under the terms of the GNU Lesser General Public License version 2.1 as
+** published by the Free Software Foundation.
+**
+** This library is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+** or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+** License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this library; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+**
+******************************************************************************/
+
+
+#ifndef STALLDETECTOR_H
+#define STALLDETECTOR_H
+
+#include <QObject>
+#include <QAtomicInteger>
+#include <QAtomicPointer>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QTimer>
+#include <QVariantMap>
+
+#include "metrics.h"
+
+class QEvent;
+
+namespace RTComLogger
+{
+
+/*!
+ * \class StallDetector
+ * \brief Finds out when and why the main loop stops processing events.
+ *
+ * A timer on the main thread measures how late it fires, which gives
+ * the event loop latency. The event filter installed on the application
+ * remembers which object and event type is being delivered. A watchdog
+ * thread notices when the timer has not fired for the threshold and
+ * takes note of that delivery as the culprit. Stalls are counted per
+ * culprit and reported through Metrics as "stalls".
+ *
+ * The probe wakes the device every PROBE_INTERVAL_MS, so the detector
+ * is only created when asked for with --stall-threshold.
+ */
+class StallDetector : public QObject
+{
+    Q_OBJECT
+
+public:
+    StallDetector(int thresholdMs, QObject *parent);
+    ~StallDetector();
+
+    /*!
+     * \brief Stall count and time, event loop latency and the culprits
+     * with the longest stalls.
+     */
+    QVariantMap statistics() const;
+
+protected:
+    bool eventFilter(QObject *object, QEvent *event);
+
+private Q_SLOTS:
+    void probe();
+
+private:
+    class Watchdog;
+
+    struct Culprit {
+        int count;
+        qint64 totalMs;
+        qint64 worstMs;
+    };
+
+    QString describe(const char *className, int eventType) const;
+
+    int m_threshold;
+    QElapsedTimer m_clock;
+    QTimer m_probeTimer;
+    LatencyHistogram m_latency;
+    qint64 m_lastProbe;
+    int m_stalls;
+    qint64 m_stalledMs;
+    QHash<QString, Culprit> m_culprits;
+
+    // Shared with the watchdog thread
+    QAtomicInteger<qint64> m_heartbeat;
+    QAtomicPointer<const char> m_deliveringClass;
+    QAtomicInt m_deliveringEvent;
+    QAtomicPointer<const char> m_stallClass;
+    QAtomicInt m_stallEvent;
+    Watchdog *m_watchdog;
+};
+
+} // namespace RTComLogger
+
+#endif // STALLDETECTOR_H
@@ -0,0 +1,100 @@
+/******************************************************************************
+**
+** This file is part of commhistory-daemon.
+**
+** Copyright (C) 2026 Jolla Ltd.
+**
+** This library is free software; you can redistribute it and/or modify it
+** under the terms of the GNU Lesser General Public License version 2.1 as
+** published by the Free Software Foundation.
+**
+** This library is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+** or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+** License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this library; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+**
+******************************************************************************/
+
+#include "startupscheduler.h"
+#include "debug.h"
+
+#include <QTimer>
+
+#define DEBUG_(x) qCDebug(lcDaemon) << "StartupScheduler:" << x
+
+using namespace RTComLogger;
+
+StartupScheduler::StartupScheduler(QObject *parent)
+    : QObject(parent),
+      m_readyMs(-1),
+      m_completeMs(-1)
+{
+    m_timer.start();
+}
+
+void StartupScheduler::run(const QString &name, const std::function<void()> &stage)
+{
+    QElapsedTimer timer;
+    timer.start();
+    stage();
+    qint64 ms = timer.elapsed();
+    m_timings.append(qMakePair(name, ms));
+    DEBUG_(name << "took" << ms << "ms");
+}
+
+void StartupScheduler::runNow(const QString &name, const std::function<void()> &stage)
+{
+    run(name, stage);
+}
+
+void StartupScheduler::schedule(Priority priority, const QString &name, const std::function<void()> &stage)
+{
+    Stage entry;
+    entry.priority = priority;
+    entry.name = name;
+    entry.run = stage;
+
+    // Keep the order of stages with the same priority
+    QList<Stage>::iterator it = m_stages.begin();
+    while (it != m_stages.end() && it->priority <= priority)
+        ++it;
+    m_stages.insert(it, entry);
+}
+
+void StartupScheduler::start()
+{
+    m_readyMs = m_timer.elapsed();
+    DEBUG_("ready in" << m_readyMs << "ms," << m_stages.count() << "stage(s) deferred");
+    QTimer::singleShot(0, this, SLOT(runNextStage()));
+}
+
+void StartupScheduler::runNextStage()
+{
+    if (!m_stages.isEmpty()) {
+        Stage stage = m_stages.takeFirst();
+        run(stage.name, stage.run);
+    }
+
+    // Let pending events through between stages
+    if (!m_stages.isEmpty()) {
+        QTimer::singleShot(0, this, SLOT(runNextStage()));
+    } else {
+        m_completeMs = m_timer.elapsed();
+        DEBUG_("startup complete in" << m_completeMs << "ms");
+        Q_EMIT finished();
+    }
+}
+
+QVariantMap StartupScheduler::timings() const
+{
+    QVariantMap result;
+    for (int i = 0; i < m_timings.count(); i++)
+        result.insert(m_timings.at(i).first, m_timings.at(i).second);
+    result.insert("ready", m_readyMs);
+    result.insert("complete", m_completeMs);
+    return result;
+}
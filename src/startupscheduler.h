@@ -0,0 +1,98 @@
+/******************************************************************************
+**
+** This file is part of commhistory-daemon.
+**
+** Copyright (C) 2026 Jolla Ltd.
+**
+** This library is free software; you can redistribute it and/or modify it
+** under the terms of the GNU Lesser General Public License version 2.1 as
+** published by the Free Software Foundation.
+**
+** This library is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+** or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+** License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this library; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+**
+******************************************************************************/
+
+#ifndef STARTUPSCHEDULER_H
+#define STARTUPSCHEDULER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QList>
+#include <QPair>
+#include <QString>
+#include <QVariantMap>
+
+#include <functional>
+
+namespace RTComLogger
+{
+
+/*!
+ * \class StartupScheduler
+ * \brief Runs daemon initialization in stages.
+ *
+ * Whatever is needed to accept channels and MMS engine calls is run
+ * right away with runNow(). Everything else is queued with schedule()
+ * and run one stage per main loop iteration once the loop is running,
+ * higher priorities first. Each stage is timed.
+ */
+class StartupScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Priority {
+        HighPriority,
+        NormalPriority,
+        LowPriority
+    };
+
+    explicit StartupScheduler(QObject *parent = 0);
+
+    void runNow(const QString &name, const std::function<void()> &stage);
+    void schedule(Priority priority, const QString &name, const std::function<void()> &stage);
+
+    /*!
+     * \brief Starts running the scheduled stages from the main loop.
+     * Timings of the synchronous part are logged at this point.
+     */
+    void start();
+
+    /*!
+     * \brief Stage name => milliseconds spent in it, plus "ready" and
+     * "complete" milliseconds since the scheduler was created.
+     */
+    QVariantMap timings() const;
+
+Q_SIGNALS:
+    void finished();
+
+private Q_SLOTS:
+    void runNextStage();
+
+private:
+    struct Stage {
+        Priority priority;
+        QString name;
+        std::function<void()> run;
+    };
+
+    void run(const QString &name, const std::function<void()> &stage);
+
+    QElapsedTimer m_timer;
+    QList<Stage> m_stages;
+    QList<QPair<QString, qint64> > m_timings;
+    qint64 m_readyMs;
+    qint64 m_completeMs;
+};
+
+} // namespace RTComLogger
+
+#endif // STARTUPSCHEDULER_H
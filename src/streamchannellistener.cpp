@@ -22,6 +22,7 @@
 
 #include "streamchannellistener.h"
 #include "notificationmanager.h"
+#include "calljournal.h"
 #include "debug.h"
 
 // libcommhistory
@@ -36,7 +37,9 @@
 #define STREAM_CHANNEL_INITIAL_VIDEO_PROPERTY TP_QT_IFACE_CHANNEL_TYPE_STREAMED_MEDIA+QLatin1String(".InitialVideo")
 #define SUBSCRIBER_ID_PROPERTY_NAME ("SubscriberIdentity")
 
-#define SAVING_INTERVAL 5*60000 // 5 minute
+// The duration goes to the call journal, which is cheap to update, and
+// to the database only when the call ends
+#define SAVING_INTERVAL 10000 // 10 seconds
 
 using namespace RTComLogger;
 using namespace CommHistory;
@@ -51,10 +54,13 @@ StreamChannelListener::StreamChannelListener(const Tp::AccountPtr &account,
       m_callStartTime(0),
       m_EventAdded(false),
       m_LoggingTimerId(0),
+      m_JournalSlot(-1),
+      m_FinalEventPending(false),
+      m_PendingCommits(0),
       m_eventCommitted(false),
       m_pProxy(0)
 {
-    DEBUG() << __PRETTY_FUNCTION__;
+    qCDebug(lcCall) << __PRETTY_FUNCTION__;
 
     invocationContextFinished();
 
@@ -86,7 +92,7 @@ StreamChannelListener::StreamChannelListener(const Tp::AccountPtr &account,
     if (spProp.isValid()) {
         const Tp::ServicePoint sp = qdbus_cast<Tp::ServicePoint>(spProp);
         if (sp.servicePointType == Tp::ServicePointTypeEmergency) {
-            DEBUG() << Q_FUNC_INFO << "*** EMERGENCY CALL, service =" << sp.service;
+            qCDebug(lcCall) << Q_FUNC_INFO << "*** EMERGENCY CALL, service =" << sp.service;
             m_Event.setIsEmergencyCall(true);
         }
     }
@@ -103,11 +109,13 @@ StreamChannelListener::StreamChannelListener(const Tp::AccountPtr &account,
 
 StreamChannelListener::~StreamChannelListener()
 {
+    // A slot still in use here has a duration that never reached the
+    // database, it is left for CallJournal::replay()
 }
 
 void StreamChannelListener::callStarted()
 {
-    DEBUG() << Q_FUNC_INFO;
+    qCDebug(lcCall) << Q_FUNC_INFO;
 
     if (m_CallStarted)
         return;
@@ -125,15 +133,17 @@ void StreamChannelListener::callStarted()
 #endif
     m_callStartTime = tp.tv_sec;
 
-    DEBUG() << Q_FUNC_INFO << m_Event.startTime();
+    qCDebug(lcCall) << Q_FUNC_INFO << m_Event.startTime();
 
-    if (addEvent())
+    if (addEvent()) {
+        m_JournalSlot = CallJournal::instance()->begin(m_Event.id(), m_Event.endTime());
         m_LoggingTimerId = startTimer(SAVING_INTERVAL);
+    }
 }
 
 void StreamChannelListener::callEnded()
 {
-    DEBUG() << Q_FUNC_INFO;
+    qCDebug(lcCall) << Q_FUNC_INFO;
 
     m_CallEnded = true;
 
@@ -151,6 +161,7 @@ void StreamChannelListener::callEnded()
     }
 
     m_Event.setEndTime(endTime);
+    CallJournal::instance()->update(m_JournalSlot, endTime);
 
     if (m_LoggingTimerId > 0) {
         killTimer(m_LoggingTimerId);
@@ -160,7 +171,7 @@ void StreamChannelListener::callEnded()
 
 void StreamChannelListener::channelReady()
 {
-    DEBUG() << __PRETTY_FUNCTION__;
+    qCDebug(lcCall) << __PRETTY_FUNCTION__;
 
     Tp::StreamedMediaChannelPtr mediaChannel = Tp::StreamedMediaChannelPtr::dynamicCast(m_Channel);
 
@@ -192,7 +203,7 @@ void StreamChannelListener::channelReady()
                 const Tp::ServicePoint sp = servicePointIf->property(
                         CURRENT_SERVICE_POINT_PROPERTY_NAME).value<Tp::ServicePoint>();
                 if (sp.servicePointType == Tp::ServicePointTypeEmergency) {
-                    DEBUG() << Q_FUNC_INFO << "*** EMERGENCY CALL, service =" << sp.service;
+                    qCDebug(lcCall) << Q_FUNC_INFO << "*** EMERGENCY CALL, service =" << sp.service;
                     m_Event.setIsEmergencyCall(true);
                 }
             }
@@ -213,7 +224,7 @@ void StreamChannelListener::slotGroupMembersChanged(
     Q_UNUSED(groupRemotePendingMembersAdded)
     Q_UNUSED(details)
 
-    DEBUG() << __PRETTY_FUNCTION__;
+    qCDebug(lcCall) << __PRETTY_FUNCTION__;
 
     Tp::StreamedMediaChannelPtr mediaChannel = Tp::StreamedMediaChannelPtr::dynamicCast(m_Channel);
 
@@ -244,7 +255,7 @@ void StreamChannelListener::slotGroupMembersChanged(
 
                 if ( (locallyMissed || remotelyMissed)
                     && m_Direction == CommHistory::Event::Inbound) {
-                    DEBUG() << "call missed";
+                    qCDebug(lcCall) << "call missed";
                     m_Event.setIsMissedCall(true);
                 }
 
@@ -296,7 +307,7 @@ void StreamChannelListener::slotStreamStateChanged(const Tp::StreamedMediaStream
 void StreamChannelListener::invalidated(Tp::DBusProxy *proxy,
             const QString &errorName, const QString &errorMessage)
 {
-    DEBUG() << __PRETTY_FUNCTION__ << errorName << errorMessage;
+    qCDebug(lcCall) << __PRETTY_FUNCTION__ << errorName << errorMessage;
 
     QDateTime currentTime = QDateTime::currentDateTime();
 
@@ -322,9 +333,15 @@ void StreamChannelListener::invalidated(Tp::DBusProxy *proxy,
             m_Event.setIsMissedCall(true);
     }
 
-    if (addEvent() && m_Event.isMissedCall()) {
-        NotificationManager* nManager = NotificationManager::instance();
-        nManager->showNotification(m_Event);
+    // Set before the write, the commit may be reported synchronously
+    m_FinalEventPending = true;
+    if (addEvent()) {
+        if (m_Event.isMissedCall()) {
+            NotificationManager* nManager = NotificationManager::instance();
+            nManager->showNotification(m_Event);
+        }
+    } else {
+        m_FinalEventPending = false;
     }
 
     // don't quit and destroy the event model before the final call
@@ -343,17 +360,26 @@ void StreamChannelListener::timerEvent(QTimerEvent *event)
 {
     if (event->timerId() == m_LoggingTimerId && m_EventAdded) {
         m_Event.setEndTime(QDateTime::currentDateTime());
-        m_eventCommitted = false;
-        eventModel().modifyEvent(m_Event);
+        if (m_JournalSlot >= 0) {
+            CallJournal::instance()->update(m_JournalSlot, m_Event.endTime());
+        } else {
+            // No journal, fall back to saving the duration in the database
+            m_eventCommitted = false;
+            m_PendingCommits++;
+            if (!eventModel().modifyEvent(m_Event))
+                m_PendingCommits--;
+        }
     }
 }
 
 bool StreamChannelListener::addEvent()
 {
-    DEBUG() << __PRETTY_FUNCTION__;
+    qCDebug(lcCall) << __PRETTY_FUNCTION__;
 
     bool result = false;
 
+    // Counted first, the commit may be reported synchronously
+    m_PendingCommits++;
     if (m_EventAdded) {
         m_eventCommitted = false;
         result = eventModel().modifyEvent(m_Event);
@@ -363,6 +389,7 @@ bool StreamChannelListener::addEvent()
     }
 
     if (result == false) {
+        m_PendingCommits--;
         qCritical() << "failed to add event";
     }
 
@@ -371,10 +398,10 @@ bool StreamChannelListener::addEvent()
 
 void StreamChannelListener::slotServicePointChanged(const Tp::ServicePoint &servicePoint)
 {
-    DEBUG() << Q_FUNC_INFO;
+    qCDebug(lcCall) << Q_FUNC_INFO;
 
     if (servicePoint.servicePointType == Tp::ServicePointTypeEmergency) {
-        DEBUG() << Q_FUNC_INFO << "*** EMERGENCY CALL, service =" << servicePoint.service;
+        qCDebug(lcCall) << Q_FUNC_INFO << "*** EMERGENCY CALL, service =" << servicePoint.service;
         m_Event.setIsEmergencyCall(true);
     }
 }
@@ -382,9 +409,21 @@ void StreamChannelListener::slotServicePointChanged(const Tp::ServicePoint &serv
 void StreamChannelListener::slotEventsCommitted(QList<CommHistory::Event> events, bool successful)
 {
     Q_UNUSED(events);
-    Q_UNUSED(successful);
 
-    DEBUG() << Q_FUNC_INFO;
+    qCDebug(lcCall) << Q_FUNC_INFO << successful;
+
+    if (m_PendingCommits > 0)
+        m_PendingCommits--;
+
+    // Earlier writes are reported first
+    if (m_FinalEventPending && !m_PendingCommits) {
+        m_FinalEventPending = false;
+        // The duration is in the database now
+        if (successful && m_JournalSlot >= 0) {
+            CallJournal::instance()->end(m_JournalSlot);
+            m_JournalSlot = -1;
+        }
+    }
 
     if (m_pProxy) {
         ChannelListener::invalidated(m_pProxy, m_errorName, m_errorMessage);
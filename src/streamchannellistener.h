@@ -82,6 +82,12 @@ private:
     CommHistory::Event m_Event;
     bool m_EventAdded;
     int m_LoggingTimerId;
+    int m_JournalSlot;
+    // The final write is queued, the journal slot is ended once it is
+    // committed and kept for CallJournal::replay() if it fails
+    bool m_FinalEventPending;
+    // Writes not yet reported by eventsCommitted
+    int m_PendingCommits;
 
     bool m_eventCommitted;
     Tp::DBusProxy *m_pProxy;
@@ -32,11 +32,9 @@
 
 // libcommhistory
 #include <CommHistory/EventModel>
-#include <CommHistory/GroupModel>
 #include <CommHistory/Event>
 #include <CommHistory/Group>
 #include <CommHistory/commonutils.h>
-#include <CommHistory/SingleEventModel>
 #include <CommHistory/DatabaseIO>
 #include <CommHistory/ConversationModel>
 
@@ -62,6 +60,12 @@
 
 #include "textchannellistener.h"
 #include "notificationmanager.h"
+#include "groupcache.h"
+#include "messagetracer.h"
+#include "metrics.h"
+#include "dbuscallstats.h"
+#include "eventstorage.h"
+#include "trafficrecorder.h"
 #include "locstrings.h"
 #include "constants.h"
 #include "debug.h"
@@ -211,6 +215,36 @@ void showErrorNote(const QString &errorMsg, const QString &category = ErrorCateg
     }
 }
 
+QVariantList recordedParts(const Tp::MessagePartList &parts)
+{
+    QVariantList result;
+    foreach (const Tp::MessagePart &part, parts) {
+        QVariantMap values;
+        for (Tp::MessagePart::const_iterator it = part.constBegin(); it != part.constEnd(); ++it)
+            values.insert(it.key(), TrafficRecorder::plainValue(it.value().variant()));
+        result.append(values);
+    }
+    return result;
+}
+
+void recordReceivedMessage(const QString &channelPath, const Tp::ReceivedMessage &message)
+{
+    TrafficRecorder *recorder = TrafficRecorder::instance();
+    if (!recorder->isRecording())
+        return;
+
+    QString senderId;
+    uint senderHandle = 0;
+    if (message.sender()) {
+        senderId = message.sender()->id();
+        if (!message.sender()->handle().isEmpty())
+            senderHandle = message.sender()->handle().first();
+    }
+    recorder->record(TrafficRecorder::TextMessageReceived,
+                     QVariantList() << channelPath << senderId << senderHandle
+                                    << QVariant(recordedParts(message.parts())));
+}
+
 } // anonymous namespace
 
 QMultiHash<QString,uint> TextChannelListener::m_pendingMessageIds;
@@ -220,7 +254,7 @@ TextChannelListener::TextChannelListener(const Tp::AccountPtr &account,
                                          const Tp::MethodInvocationContextPtr<> &context,
                                          QObject *parent)
     : ChannelListener(account, channel, context, parent),
-      m_GroupModel(0),
+      m_GroupCache(0),
       m_GroupRequested(false),
       m_ShowOfflineChatError(true),
       m_isClassZeroSMS(false),
@@ -230,14 +264,15 @@ TextChannelListener::TextChannelListener(const Tp::AccountPtr &account,
       m_FailedSaveCount(0),
       m_pConversationModel(0)
 {
-    DEBUG() << __PRETTY_FUNCTION__;
+    qCDebug(lcText) << __PRETTY_FUNCTION__;
+    ShutdownCoordinator::instance()->addParticipant(QLatin1String("TextChannelListener"), this);
     makeChannelReady(Tp::TextChannel::FeatureMessageQueue
                      | Tp::TextChannel::FeatureMessageSentSignal);
 }
 
 void TextChannelListener::channelListenerReady()
 {
-    DEBUG() << __PRETTY_FUNCTION__;
+    qCDebug(lcText) << __PRETTY_FUNCTION__;
 
     if (m_IsGroupChat)
         handleTpProperties();
@@ -266,10 +301,26 @@ void TextChannelListener::channelListenerReady()
 
         QVariant property = properties.value(TP_QT_IFACE_CHANNEL_INTERFACE_SMS + QLatin1String(".Flash"), QVariant());
         if(property.isValid() && property.value<bool>() == true) {
-            DEBUG() << __FUNCTION__ << "Channel contains class 0 property";
+            qCDebug(lcText) << __FUNCTION__ << "Channel contains class 0 property";
             m_isClassZeroSMS = true;
         }
 
+        TrafficRecorder *recorder = TrafficRecorder::instance();
+        if (recorder->isRecording()) {
+            QStringList members;
+            if (m_IsGroupChat) {
+                foreach (const Tp::ContactPtr &contact, textChannel->groupContacts())
+                    members.append(contact->id());
+            }
+            recorder->record(TrafficRecorder::TextChannelOpened,
+                             QVariantList() << m_Account->objectPath() << m_Account->protocolName()
+                                            << m_Channel->objectPath() << targetId()
+                                            << uint(m_Channel->targetHandleType()) << m_Channel->isRequested()
+                                            << members);
+            foreach (const Tp::ReceivedMessage &message, textChannel->messageQueue())
+                recordReceivedMessage(m_Channel->objectPath(), message);
+        }
+
         handleMessages();
     } else {
         qCritical() << Q_FUNC_INFO << "Wrong channel - Null";
@@ -290,21 +341,25 @@ bool TextChannelListener::checkStoredMessagesIf()
 void TextChannelListener::requestConversationId()
 {
     if (!m_GroupRequested) {
-        m_GroupModel = NotificationManager::instance()->groupModel();
-        if (m_GroupModel) {
+        // The daemon-wide cache finds the group, the full properties of
+        // this conversation's group come with the update signals
+        m_GroupCache = NotificationManager::instance()->groupCache();
+        if (m_GroupCache) {
             m_GroupRequested = true;
 
-            connect(m_GroupModel, SIGNAL(rowsAboutToBeRemoved(const QModelIndex&,int,int)),
+            connect(m_GroupCache, SIGNAL(rowsAboutToBeRemoved(const QModelIndex&,int,int)),
                     SLOT(slotGroupRemoved(const QModelIndex&,int,int)));
-            connect(m_GroupModel, SIGNAL(dataChanged(const QModelIndex&,const QModelIndex&)),
+            connect(m_GroupCache, SIGNAL(dataChanged(const QModelIndex&,const QModelIndex&)),
                     SLOT(slotGroupDataChanged(const QModelIndex&,const QModelIndex&)));
-            connect(m_GroupModel, SIGNAL(rowsInserted(const QModelIndex &, int, int)),
+            connect(m_GroupCache, SIGNAL(groupsUpdated(const QList<CommHistory::Group>&)),
+                    SLOT(slotGroupsUpdated(const QList<CommHistory::Group>&)));
+            connect(m_GroupCache, SIGNAL(rowsInserted(const QModelIndex &, int, int)),
                     this, SLOT(slotGroupInserted(const QModelIndex &, int, int)));
 
-            if (m_GroupModel->isReady()) {
+            if (m_GroupCache->isReady()) {
                 slotOnModelReady(true);
             } else {
-                connect(m_GroupModel, SIGNAL(modelReady(bool)), SLOT(slotOnModelReady(bool)));
+                connect(m_GroupCache, SIGNAL(modelReady(bool)), SLOT(slotOnModelReady(bool)));
             }
         } else {
             qCritical() << "Failed to create group model";
@@ -314,6 +369,25 @@ void TextChannelListener::requestConversationId()
 
 TextChannelListener::~TextChannelListener()
 {
+    ShutdownCoordinator::removeParticipant(this);
+}
+
+void TextChannelListener::drain()
+{
+    qCDebug(lcText) << Q_FUNC_INFO;
+    if (!m_failedSaveEvents.isEmpty())
+        slotSaveFailedEvents();
+    slotExpungeMessages();
+}
+
+QVariantMap TextChannelListener::pendingWork() const
+{
+    QVariantMap work;
+    work.insert(QLatin1String("expungeTokens"), m_expungeTokens.count());
+    work.insert(QLatin1String("failedSaveEvents"), m_failedSaveEvents.count());
+    work.insert(QLatin1String("uncommittedEvents"), m_commitingEvents.count());
+    work.insert(QLatin1String("replaceMessages"), m_replaceMessages.count());
+    return work;
 }
 
 void TextChannelListener::slotGroupDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight)
@@ -329,16 +403,13 @@ void TextChannelListener::slotGroupDataChanged(const QModelIndex &topLeft, const
     bool pendingGroupsHandled = false;
 
     for (int i = topLeft.row(); i <= bottomRight.row(); i++) {
-        QModelIndex row = m_GroupModel->index(i, 0);
-        CommHistory::Group group = m_GroupModel->group(row);
+        QModelIndex row = m_GroupCache->index(i, 0);
+        CommHistory::Group group = m_GroupCache->group(row);
         if (group.isValid()) {
             if (m_pendingGroups.contains(group.id())) {
                 pendingGroupsHandled = true;
                 m_pendingGroups.removeAll(group.id());
             }
-
-            if (m_Group.id() == group.id())
-                m_Group = group;
         }
     }
 
@@ -348,30 +419,44 @@ void TextChannelListener::slotGroupDataChanged(const QModelIndex &topLeft, const
     tryToClose();
 }
 
+void TextChannelListener::slotGroupsUpdated(const QList<CommHistory::Group> &groups)
+{
+    // The cache rows only have some of the properties, keep the full group
+    if (!m_Group.isValid())
+        return;
+
+    foreach (const CommHistory::Group &group, groups) {
+        if (group.id() == m_Group.id()) {
+            m_Group = group;
+            break;
+        }
+    }
+}
+
 void TextChannelListener::slotGroupInserted(const QModelIndex &index, int start, int end)
 {
-    DEBUG() << Q_FUNC_INFO << "Account path handled by this listener: " << m_Account->objectPath();
-    DEBUG() << Q_FUNC_INFO << "Target handled by this listener: " << targetId();
+    qCDebug(lcText) << Q_FUNC_INFO << "Account path handled by this listener: " << m_Account->objectPath();
+    qCDebug(lcText) << Q_FUNC_INFO << "Target handled by this listener: " << targetId();
 
     updateCurrentGroup(start, end, index);
 }
 
 void TextChannelListener::slotGroupRemoved(const QModelIndex &index, int start, int end)
 {
-    DEBUG() << Q_FUNC_INFO << "Account path handled by this listener: " << m_Account->objectPath();
-    DEBUG() << Q_FUNC_INFO << "Target handled by this listener: " << targetId();
+    qCDebug(lcText) << Q_FUNC_INFO << "Account path handled by this listener: " << m_Account->objectPath();
+    qCDebug(lcText) << Q_FUNC_INFO << "Target handled by this listener: " << targetId();
 
     if (!m_Group.isValid())
     {
-        DEBUG() << Q_FUNC_INFO << "Group is not valid!";
+        qCDebug(lcText) << Q_FUNC_INFO << "Group is not valid!";
         return;
     }
 
     for (int i = start; i <= end; i++) {
-        QModelIndex row = m_GroupModel->index(i, 0, index);
-        CommHistory::Group group = m_GroupModel->group(row);
+        QModelIndex row = m_GroupCache->index(i, 0, index);
+        CommHistory::Group group = m_GroupCache->group(row);
         if (group == m_Group) {
-            DEBUG() << Q_FUNC_INFO << "Removed group belongs to this listener!";
+            qCDebug(lcText) << Q_FUNC_INFO << "Removed group belongs to this listener!";
             m_Group.setId(-1); // Invalidate the current group in this listener.
             break;
         }
@@ -380,17 +465,17 @@ void TextChannelListener::slotGroupRemoved(const QModelIndex &index, int start,
 
 int TextChannelListener::groupId()
 {
-    DEBUG() << Q_FUNC_INFO;
+    qCDebug(lcText) << Q_FUNC_INFO;
     if (!m_Group.isValid()) {
-        DEBUG() << Q_FUNC_INFO << "Group is not valid!";
+        qCDebug(lcText) << Q_FUNC_INFO << "Group is not valid!";
 
-        if (m_GroupModel->isReady()
+        if (m_GroupCache->isReady()
             && m_Account) { // m_Account not need to be ready
 
             CommHistory::Group group;
             group.setLocalUid(m_Account->objectPath());
 
-            DEBUG() << Q_FUNC_INFO << targetId();
+            qCDebug(lcText) << Q_FUNC_INFO << targetId();
             group.setRecipients(Recipient(m_Account->objectPath(), targetId()));
 
             if (m_IsGroupChat) {
@@ -406,14 +491,14 @@ int TextChannelListener::groupId()
                     group.setChatName(m_GroupChatName);
             }
 
-            if (!m_GroupModel->addGroup(group)) {
+            if (!m_GroupCache->addGroup(group)) {
 
                 qCritical() << Q_FUNC_INFO << "error adding group";
             }
             else {
 
                 m_Group = group;
-                DEBUG() << Q_FUNC_INFO << "added new group:" << m_Group.id();
+                qCDebug(lcText) << Q_FUNC_INFO << "added new group:" << m_Group.id();
             }
         }
         else {
@@ -439,7 +524,7 @@ void TextChannelListener::handleTpProperties()
 
 void TextChannelListener::slotListPropertiesFinished(QDBusPendingCallWatcher *watcher)
 {
-    DEBUG() << Q_FUNC_INFO;
+    qCDebug(lcText) << Q_FUNC_INFO;
 
     QDBusPendingReply<Tp::PropertySpecList> reply = *watcher;
     if (!reply.isValid()) {
@@ -464,7 +549,7 @@ void TextChannelListener::slotListPropertiesFinished(QDBusPendingCallWatcher *wa
         && (m_Properties.value(CHANNEL_PROPERTY_SUBJECT_CONTACT).flags & Tp::PropertyFlagRead))
         propIds << m_Properties.value(CHANNEL_PROPERTY_SUBJECT_CONTACT).propertyID;
 
-    DEBUG() << Q_FUNC_INFO << propIds;
+    qCDebug(lcText) << Q_FUNC_INFO << propIds;
 
     if (!propIds.isEmpty()) {
         QDBusPendingCall getPropertyCall = m_PropertiesIf->GetProperties(propIds);
@@ -480,7 +565,7 @@ void TextChannelListener::slotGetPropertiesFinished(QDBusPendingCallWatcher *wat
 {
     QDBusPendingReply<Tp::PropertyValueList> reply = *watcher;
     if (!reply.isValid()) {
-        DEBUG() << Q_FUNC_INFO << "GetProperties failed:" << reply.error();
+        qCDebug(lcText) << Q_FUNC_INFO << "GetProperties failed:" << reply.error();
         watcher->deleteLater();
         return;
     }
@@ -490,9 +575,9 @@ void TextChannelListener::slotGetPropertiesFinished(QDBusPendingCallWatcher *wat
 
 void TextChannelListener::slotOnModelReady(bool status)
 {
-    DEBUG() << __PRETTY_FUNCTION__ << m_Account->objectPath() << targetId();
+    qCDebug(lcText) << __PRETTY_FUNCTION__ << m_Account->objectPath() << targetId();
 
-    disconnect(m_GroupModel, SIGNAL(modelReady(bool)),
+    disconnect(m_GroupCache, SIGNAL(modelReady(bool)),
                this, SLOT(slotOnModelReady(bool)));
 
     if (!status) {
@@ -502,7 +587,7 @@ void TextChannelListener::slotOnModelReady(bool status)
 
     // if group exist, read group id right away
     // otherwise add a new group only when a new message(received/sent) comes
-    const int groupCount = m_GroupModel->rowCount();
+    const int groupCount = m_GroupCache->rowCount();
     if (groupCount > 0 && m_Account) {
         updateCurrentGroup(0, groupCount - 1);
     }
@@ -512,24 +597,27 @@ void TextChannelListener::slotOnModelReady(bool status)
 
 void TextChannelListener::slotMessageReceived(const Tp::ReceivedMessage &message)
 {
-    Q_UNUSED(message);
-    DEBUG() << __PRETTY_FUNCTION__;
+    qCDebug(lcText) << __PRETTY_FUNCTION__;
+    MessageTracer::instance()->begin("text", message.messageToken(), "received");
+    Metrics::instance()->increment(Metrics::MessagesReceived);
+    Metrics::instance()->start(Metrics::NotifyLatency, message.messageToken());
+    recordReceivedMessage(m_Channel->objectPath(), message);
 
     handleMessages();
 }
 
 void TextChannelListener::slotPendingMessageRemoved(const Tp::ReceivedMessage &message)
 {
-    DEBUG() << __PRETTY_FUNCTION__;
+    qCDebug(lcText) << __PRETTY_FUNCTION__;
 
     uint id = pendingId(message);
 
-    DEBUG() << __PRETTY_FUNCTION__ << "Pending message (pending id = " << id << ") having content "
-             << message.text() << " acked and removed from channel's message queue.";
+    qCDebug(lcText) << __PRETTY_FUNCTION__ << "Pending message (pending id = " << id << ") having content "
+                    << message.text() << " acked and removed from channel's message queue.";
 
     if (m_pendingMessageIds.remove(m_Channel->objectPath(), id) > 0) {
-        DEBUG() << __PRETTY_FUNCTION__ << "Removing message from channel " << m_Channel->objectPath()
-                 << " having pending id " << id << " from pending messages list of all text channel listeners";
+        qCDebug(lcText) << __PRETTY_FUNCTION__ << "Removing message from channel " << m_Channel->objectPath()
+                        << " having pending id " << id << " from pending messages list of all text channel listeners";
     }
 }
 
@@ -562,15 +650,16 @@ void TextChannelListener::handleMessages()
         }
     }
 
-    DEBUG() << __PRETTY_FUNCTION__ << "Number of messages in local message queue: " << m_messageQueue.size();
+    qCDebug(lcText) << __PRETTY_FUNCTION__ << "Number of messages in local message queue: " << m_messageQueue.size();
 
     foreach(Tp::ReceivedMessage message, m_messageQueue) {
         CommHistory::Event event;
         Tp::ChannelTextMessageType type = message.messageType();
         bool wait = false;
 
-        DEBUG() << __PRETTY_FUNCTION__ << "Handling message from channel " << m_Channel->objectPath()
-                 << " with content " << message.text() << " and with pending id " << pendingId(message);
+        qCDebug(lcText) << __PRETTY_FUNCTION__ << "Handling message from channel " << m_Channel->objectPath()
+                        << " with content " << message.text() << " and with pending id " << pendingId(message);
+        MessageTracer::instance()->step("text", message.messageToken(), "handleMessages");
 
         switch (type) {
         case Tp::ChannelTextMessageTypeDeliveryReport: {
@@ -583,6 +672,7 @@ void TextChannelListener::handleMessages()
                 }
 
                 if (event.isValid()) {
+                    Metrics::instance()->increment(Metrics::DeliveryReportsHandled);
                     int groupId = event.groupId();
                     modifyEvents[groupId] << event;
                     modifyMessages[groupId] << message;
@@ -594,15 +684,17 @@ void TextChannelListener::handleMessages()
                     modifyTokens[groupId].insertMulti(event.id(), token);
 
                 } else {
-                    DEBUG() << __PRETTY_FUNCTION__ << "Ignoring recovered message from delivery echo";
+                    qCDebug(lcText) << __PRETTY_FUNCTION__ << "Ignoring recovered message from delivery echo";
                 }
 
                 break;
             case DeliveryHandlingFailed:
+                Metrics::instance()->increment(Metrics::DeliveryReportsFailed);
                 expungeMessage(message.messageToken());
                 processedMessages << message;
                 break;
             case DeliveryHandlingPending:
+                Metrics::instance()->increment(Metrics::DeliveryReportsPending);
                 wait = true;
                 break;
             default:
@@ -618,14 +710,14 @@ void TextChannelListener::handleMessages()
 
             // class 0 sms
             if (m_isClassZeroSMS) {
-                DEBUG() << __FUNCTION__ << "Handling class 0 sms";
+                qCDebug(lcText) << __FUNCTION__ << "Handling class 0 sms";
                 processedMessages << message;
                 nManager->playClass0SMSAlert();
                 nManager->requestClass0Notification(event);
                 expungeMessage(event.messageToken());
             // Replace sms
             } else if (!replaceTypeValue.isEmpty()) {
-                DEBUG() << __FUNCTION__ << "Replace type of sms";
+                qCDebug(lcText) << __FUNCTION__ << "Replace type of sms";
                 m_replaceEvents << event;
                 m_replaceMessages << message;
                 hasReplaceMessage = true;
@@ -724,7 +816,7 @@ void TextChannelListener::handleMessages()
         break;
         }
         default:
-            DEBUG() << "onMessageReceived: type " << type << " not supported";
+            qCDebug(lcText) << "onMessageReceived: type " << type << " not supported";
             break;
         }
 
@@ -743,8 +835,11 @@ void TextChannelListener::handleMessages()
     if (!addEvents.isEmpty()) {
         if (eventModel().addEvents(addEvents)) {
             processedMessages << addMessages;
-            foreach (CommHistory::Event e, addEvents)
+            foreach (CommHistory::Event e, addEvents) {
                 m_EventTokens.insertMulti(e.id(), e.messageToken());
+                MessageTracer::instance()->step("text", e.messageToken(), "addEventsQueued");
+                Metrics::instance()->start(Metrics::CommitLatency, e.messageToken());
+            }
         } else {
             qWarning() << "Adding events failed";
         }
@@ -792,7 +887,7 @@ CommHistory::ConversationModel& TextChannelListener::conversationModel()
 
 void TextChannelListener::slotConvModelReady(bool success)
 {
-    DEBUG() << __FUNCTION__;
+    qCDebug(lcText) << __FUNCTION__;
 
     if (success && !m_replaceEvents.isEmpty()) {
         CommHistory::Event event = m_replaceEvents.takeFirst();
@@ -814,7 +909,7 @@ void TextChannelListener::slotConvModelReady(bool success)
 
 void TextChannelListener::slotConvEventsCommitted(const QList<CommHistory::Event> &events, bool success)
 {
-    DEBUG() << __FUNCTION__;
+    qCDebug(lcText) << __FUNCTION__;
 
     disconnect(&conversationModel(), SIGNAL(eventsCommitted(const QList<CommHistory::Event> &, bool)),
             this, SLOT(slotConvEventsCommitted(const QList<CommHistory::Event> &, bool)));
@@ -878,33 +973,13 @@ bool TextChannelListener::getEventForToken(const QString &token,
                                            int groupId,
                                            CommHistory::Event &event)
 {
-    CommHistory::SingleEventModel model;
-    model.setQueryMode(CommHistory::SingleEventModel::SyncQuery);
-    model.setPropertyMask(deliveryHandlingProperties);
-
-    if (model.getEventByTokens(token, mmsId, groupId)) {
-        if (model.rowCount() > 0)
-            event = model.event();
-        return true;
-    } else {
-        qWarning() << "Failed query single event model";
-        return false;
-    }
+    return EventStorage::instance()->getEventByTokens(token, mmsId, groupId,
+                                                      deliveryHandlingProperties, event);
 }
 
 bool TextChannelListener::getEventById(int eventId, CommHistory::Event &event)
 {
-    CommHistory::SingleEventModel model;
-    model.setQueryMode(CommHistory::SingleEventModel::SyncQuery);
-
-    if (model.getEventById(eventId)) {
-        if (model.rowCount() > 0)
-            event = model.event();
-        return true;
-    } else {
-        qWarning() << "Failed query single event model";
-        return false;
-    }
+    return EventStorage::instance()->getEventById(eventId, event);
 }
 
 TextChannelListener::DeliveryHandlingStatus TextChannelListener::handleDeliveryReport(const Tp::ReceivedMessage &message,
@@ -912,7 +987,7 @@ TextChannelListener::DeliveryHandlingStatus TextChannelListener::handleDeliveryR
 {
     DeliveryHandlingStatus result = DeliveryHandlingFailed;
 
-    DEBUG() << "[DELIVERY] Handling delivery report";
+    qCDebug(lcText) << "[DELIVERY] Handling delivery report";
     if (message.messageToken().isNull()) {
         qWarning() << "[DELIVERY] Trying to handler delivery report, while message token is empty";
         return result;
@@ -929,10 +1004,10 @@ TextChannelListener::DeliveryHandlingStatus TextChannelListener::handleDeliveryR
         qWarning() << "[DELIVERY] Cannot fetch delivery token";
     }
 
-    DEBUG() << "[DELIVERY] Message token is: " << deliveryToken;
+    qCDebug(lcText) << "[DELIVERY] Message token is: " << deliveryToken;
 
     if (pendingCommit(deliveryToken)) {
-        DEBUG() << "[DELIVERY] Original message is not committed yet, wait for it";
+        qCDebug(lcText) << "[DELIVERY] Original message is not committed yet, wait for it";
         return DeliveryHandlingPending;
     }
 
@@ -967,7 +1042,7 @@ TextChannelListener::DeliveryHandlingStatus TextChannelListener::handleDeliveryR
 
             event.setReportDelivery(true);
 
-            DEBUG() << "Message recovered from delivery-echo" << event.toString();
+            qCDebug(lcText) << "Message recovered from delivery-echo" << event.toString();
         }
     }
 
@@ -977,8 +1052,8 @@ TextChannelListener::DeliveryHandlingStatus TextChannelListener::handleDeliveryR
         return result;
     }
 
-    DEBUG() << "[DELIVERY] Event match: id:" << event.id()
-             << "token:" << event.messageToken();
+    qCDebug(lcText) << "[DELIVERY] Event match: id:" << event.id()
+                    << "token:" << event.messageToken();
 
     // If variant is not valid, then we cant update status
     if (!status.isValid())
@@ -993,7 +1068,7 @@ TextChannelListener::DeliveryHandlingStatus TextChannelListener::handleDeliveryR
         deliveryTime = QDateTime::currentDateTime();
 
     int deliveryStatus = status.value<int>();
-    DEBUG() << "[DELIVERY] Message delivery status: " << deliveryStatus;
+    qCDebug(lcText) << "[DELIVERY] Message delivery status: " << deliveryStatus;
 
 
     if ((deliveryStatus == Tp::DeliveryStatusRead)
@@ -1071,7 +1146,7 @@ bool TextChannelListener::areRemotePartiesOffline()
 void TextChannelListener::handleMessageFailed(const Tp::ReceivedMessage &message,
                                               const CommHistory::Event &event)
 {
-    DEBUG() << __PRETTY_FUNCTION__ << "message type:" << message.messageType();
+    qCDebug(lcText) << __PRETTY_FUNCTION__ << "message type:" << message.messageType();
 
     // if the received message is a delivery report
     if (message.messageType() == Tp::ChannelTextMessageTypeDeliveryReport) {
@@ -1083,10 +1158,10 @@ void TextChannelListener::handleMessageFailed(const Tp::ReceivedMessage &message
         QString dbusError = part.value(DELIVERY_DBUSERROR).variant().toString();
         QString errorMessage = part.value(DELIVERY_ERRORMESSAGE).variant().toString();
 
-        DEBUG() << "status:"        << status
-                 << "message token:" << messageToken
-                 << "dbus error:"    << dbusError
-                 << "error message:" << errorMessage;
+        qCDebug(lcText) << "status:"        << status
+                        << "message token:" << messageToken
+                        << "dbus error:"    << dbusError
+                        << "error message:" << errorMessage;
 
         // dont show notes for perm. failed mms messages
         if(event.type() == CommHistory::Event::MMSEvent &&
@@ -1143,7 +1218,7 @@ void TextChannelListener::handleMessageFailed(const Tp::ReceivedMessage &message
                 category = ErrorCategory;
             }
 
-            DEBUG() << "error message shown to user:" << errorMsgToUser;
+            qCDebug(lcText) << "error message shown to user:" << errorMsgToUser;
             showErrorNote(errorMsgToUser, category);
         }
     }
@@ -1207,8 +1282,8 @@ void TextChannelListener::handleReceivedMessage(const Tp::ReceivedMessage &messa
         remoteId = targetId();
     }
 
-    DEBUG() << "Handling received message: " << remoteId << (fromSelf ? "<-" : "->")
-             << m_Account->objectPath() << messageText;
+    qCDebug(lcText) << "Handling received message: " << remoteId << (fromSelf ? "<-" : "->")
+                    << m_Account->objectPath() << messageText;
 
     fillEventFromMessage(message, event);
     event.setRecipients(Recipient(m_Account->objectPath(), remoteId));
@@ -1240,7 +1315,7 @@ void TextChannelListener::handleReceivedMessage(const Tp::ReceivedMessage &messa
     event.setEndTime(receivedTime);
 
     event.setMessageToken(message.messageToken());
-    DEBUG() << "Message token is: " << message.messageToken();
+    qCDebug(lcText) << "Message token is: " << message.messageToken();
 
     const Tp::MessagePart &header(message.header());
     const QString subscriberId(subscriberIdentity(header));
@@ -1252,6 +1327,14 @@ void TextChannelListener::slotMessageSent(const Tp::Message &message,
                                         Tp::MessageSendingFlags flags,
                                         const QString &messageToken)
 {
+    Metrics::instance()->increment(Metrics::MessagesSent);
+    TrafficRecorder *recorder = TrafficRecorder::instance();
+    if (recorder->isRecording()) {
+        recorder->record(TrafficRecorder::TextMessageSent,
+                         QVariantList() << m_Channel->objectPath() << uint(flags) << messageToken
+                                        << QVariant(recordedParts(message.parts())));
+    }
+
     QString messageText = message.text();
     QString remoteUid = targetId();
 
@@ -1259,11 +1342,11 @@ void TextChannelListener::slotMessageSent(const Tp::Message &message,
         qCritical() << "Empty target id";
 
     int existingEventId = message.header().value("x-commhistory-event-id", QDBusVariant(-1)).variant().toInt();
-    DEBUG() << "Handling sent message: " << m_Account->objectPath() << "->" << remoteUid << messageText;
+    qCDebug(lcText) << "Handling sent message: " << m_Account->objectPath() << "->" << remoteUid << messageText;
 
     CommHistory::Event event;
     if (existingEventId >= 0 && getEventById(existingEventId, event) && event.isValid()) {
-        DEBUG() << "Sent message has an existing event" << existingEventId;
+        qCDebug(lcText) << "Sent message has an existing event" << existingEventId;
     } else {
         fillEventFromMessage(message, event);
         event.setIsRead(true);
@@ -1284,7 +1367,7 @@ void TextChannelListener::slotMessageSent(const Tp::Message &message,
     event.setEndTime(sentTime);
 
     event.setMessageToken(messageToken);
-    DEBUG() << "Message token is: " << messageToken;
+    qCDebug(lcText) << "Message token is: " << messageToken;
 
     const QVariantMap properties = m_Channel->immutableProperties();
     const QVariant &siProp = properties.value(SUBSCRIBER_ID_PROPERTY_NAME);
@@ -1321,7 +1404,7 @@ void TextChannelListener::slotMessageSent(const Tp::Message &message,
 
 void TextChannelListener::saveMessage(CommHistory::Event &event)
 {
-    DEBUG() << Q_FUNC_INFO << event.toString();
+    qCDebug(lcText) << Q_FUNC_INFO << event.toString();
 
     if (event.id() >= 0) {
         if (!eventModel().modifyEvent(event)) {
@@ -1349,7 +1432,7 @@ void TextChannelListener::expungeMessage(const QString &token)
 void TextChannelListener::updateGroupChatName(ChangedChannelProperty changedChannelProperty,
                                               bool suppressGroupChatEvents)
 {
-    DEBUG() << Q_FUNC_INFO;
+    qCDebug(lcText) << Q_FUNC_INFO;
 
     if (changedChannelProperty == ChannelName)
         m_GroupChatName = m_ChannelName;
@@ -1357,28 +1440,28 @@ void TextChannelListener::updateGroupChatName(ChangedChannelProperty changedChan
     else if (changedChannelProperty == ChannelSubject)
         m_GroupChatName = m_ChannelSubject;
 
-    DEBUG() << Q_FUNC_INFO << "New group chat name is" << m_GroupChatName;
+    qCDebug(lcText) << Q_FUNC_INFO << "New group chat name is" << m_GroupChatName;
 
     if (m_Group.isValid()) {
 
-        DEBUG() << Q_FUNC_INFO << "Current group chat name for this group is" << m_Group.chatName();
+        qCDebug(lcText) << Q_FUNC_INFO << "Current group chat name for this group is" << m_Group.chatName();
 
         if (m_GroupChatName != m_Group.chatName()) {
 
-            DEBUG() << Q_FUNC_INFO << "updating group chat name...";
+            qCDebug(lcText) << Q_FUNC_INFO << "updating group chat name...";
             m_Group.setChatName(m_GroupChatName);
 
-            if (m_GroupModel) {
+            if (m_GroupCache) {
 
                 // Group is already in the database
                 CommHistory::Group modGroup;
                 modGroup.setId(m_Group.id());
                 modGroup.setChatName(m_Group.chatName());
-                if (!m_GroupModel->modifyGroup(modGroup))
+                if (!m_GroupCache->modifyGroup(modGroup))
                     qCritical() << "failed to modify group in database";
 
                 if (suppressGroupChatEvents) {
-                    DEBUG() << Q_FUNC_INFO << "NOT creating group chat event";
+                    qCDebug(lcText) << Q_FUNC_INFO << "NOT creating group chat event";
                     return;
                 }
 
@@ -1398,7 +1481,7 @@ void TextChannelListener::updateGroupChatName(ChangedChannelProperty changedChan
                         }
 
 
-                DEBUG() << Q_FUNC_INFO << "Chat room topic was changed by" << remoteId;
+                qCDebug(lcText) << Q_FUNC_INFO << "Chat room topic was changed by" << remoteId;
 
                 // Create a temporary CommHistory::Event for showing chat room
                 // topic change to the user in MUI conversation thread
@@ -1445,56 +1528,65 @@ void TextChannelListener::sendGroupChatEvent(const QString &message)
 
     if ( !eventModel().addEvent( event, true ) )
     {
-        DEBUG() << "*** Adding group chat event message to data model has been failed.";
+        qCDebug(lcText) << "*** Adding group chat event message to data model has been failed.";
      }
 }
 
 void TextChannelListener::updateCurrentGroup(int start, int end, const QModelIndex &parent)
 {
-    DEBUG() << __PRETTY_FUNCTION__ << start << end;
+    qCDebug(lcText) << __PRETTY_FUNCTION__ << start << end;
 
     const Recipient recipient(m_Account->objectPath(), targetId());
     int fallbackRow = -1;
     int row = start;
     for ( ; row <= end; row++) {
-        const QModelIndex &index = m_GroupModel->index(row, 0, parent);
-        const CommHistory::Group &group = m_GroupModel->group(index);
+        const QModelIndex &index = m_GroupCache->index(row, 0, parent);
+        const CommHistory::Group &group = m_GroupCache->group(index);
 
-        DEBUG() << Q_FUNC_INFO << "Inserted group's account: " << group.localUid();
-        DEBUG() << Q_FUNC_INFO << "Inserted group's first target: " << group.recipients().value(0).remoteUid();
+        qCDebug(lcText) << Q_FUNC_INFO << "Inserted group's account: " << group.localUid();
+        qCDebug(lcText) << Q_FUNC_INFO << "Inserted group's first target: " << group.recipients().value(0).remoteUid();
 
         if (group.isValid()) {
             const CommHistory::RecipientList &recipients = group.recipients();
             if (recipients.count() > 1) {
-                DEBUG() << Q_FUNC_INFO << "has multiple recipients" << recipients.count();
+                qCDebug(lcText) << Q_FUNC_INFO << "has multiple recipients" << recipients.count();
                 // This is a multi-member group; prefer to continue searching for an exact match
                 if (fallbackRow == -1 && recipients.containsMatch(recipient)) {
-                    DEBUG() << Q_FUNC_INFO << "set fallbackRow" << fallbackRow;
+                    qCDebug(lcText) << Q_FUNC_INFO << "set fallbackRow" << fallbackRow;
                     fallbackRow = row;
                 }
             } else if (recipients.containsMatch(recipient)) {
                 m_Group = group;
-                DEBUG() << Q_FUNC_INFO << "found existing group:" << m_Group.id();
+                qCDebug(lcText) << Q_FUNC_INFO << "found existing group:" << m_Group.id();
                 break;
             }
         }
     }
     if (row == end) {
         if (fallbackRow != -1) {
-            m_Group = m_GroupModel->group(m_GroupModel->index(fallbackRow, 0));
-            DEBUG() << Q_FUNC_INFO << "found existing multi-member group:" << m_Group.id();
+            m_Group = m_GroupCache->group(m_GroupCache->index(fallbackRow, 0));
+            qCDebug(lcText) << Q_FUNC_INFO << "found existing multi-member group:" << m_Group.id();
         } else {
-            DEBUG() << Q_FUNC_INFO << "no existing group found for targetId:" << targetId();
+            qCDebug(lcText) << Q_FUNC_INFO << "no existing group found for targetId:" << targetId();
         }
     }
 }
 
 void TextChannelListener::slotEventsCommitted(QList<CommHistory::Event> events, bool status)
 {
-    DEBUG() << Q_FUNC_INFO << status;
+    qCDebug(lcText) << Q_FUNC_INFO << status;
+
+    if (status) {
+        Metrics::instance()->increment(Metrics::CommitBatches);
+        Metrics::instance()->increment(Metrics::CommittedEvents, events.count());
+    }
 
     bool removed = false;
     foreach (CommHistory::Event e, events) {
+        MessageTracer::instance()->step("text", e.messageToken(), status ? "eventsCommitted" : "commitFailed");
+        // Failed writes are measured again when they are retried
+        if (status)
+            Metrics::instance()->stop(Metrics::CommitLatency, e.messageToken());
         if (m_EventTokens.contains(e.id())) {
             QString token = m_EventTokens.values(e.id()).last();
             if (status)
@@ -1507,10 +1599,12 @@ void TextChannelListener::slotEventsCommitted(QList<CommHistory::Event> events,
 
     if (!status) {
         qCritical() << "Failed to save message";
+        Metrics::instance()->increment(Metrics::SaveFailures, events.count());
         // try to redeliver incoming messages
         if (!events.isEmpty()
             && events.first().direction() == CommHistory::Event::Inbound) {
             if (m_FailedSaveCount++ < MAX_SAVE_ATTEMPTS) {
+                Metrics::instance()->increment(Metrics::SaveRetries);
                 m_failedSaveEvents << events;
                 QTimer::singleShot(m_FailedSaveCount*RESAVE_INTERVAL,
                                    this,
@@ -1530,10 +1624,16 @@ void TextChannelListener::slotEventsCommitted(QList<CommHistory::Event> events,
 
 void TextChannelListener::slotSaveFailedEvents()
 {
-    DEBUG() << Q_FUNC_INFO;
+    qCDebug(lcText) << Q_FUNC_INFO;
+    // Already saved by a drain on shutdown
+    if (m_failedSaveEvents.isEmpty())
+        return;
+
     if (eventModel().addEvents(m_failedSaveEvents)) {
-        foreach (CommHistory::Event e, m_failedSaveEvents)
+        foreach (CommHistory::Event e, m_failedSaveEvents) {
             m_EventTokens.insertMulti(e.id(), e.messageToken());
+            Metrics::instance()->start(Metrics::CommitLatency, e.messageToken());
+        }
     }
     m_failedSaveEvents.clear();
 }
@@ -1548,8 +1648,13 @@ void TextChannelListener::slotExpungeMessages()
             m_Connection->interface<CommHistoryTp::Client::ConnectionInterfaceStoredMessagesInterface>();
 
     if (storedMessages) {
-        DEBUG() << Q_FUNC_INFO << m_expungeTokens;
-        storedMessages->ExpungeMessages(m_expungeTokens);
+        qCDebug(lcText) << Q_FUNC_INFO << m_expungeTokens;
+        DBusCallStats::instance()->track(storedMessages->service(), QStringLiteral("ExpungeMessages"),
+                                         storedMessages->ExpungeMessages(m_expungeTokens));
+        Metrics::instance()->increment(Metrics::ExpungeCalls);
+        Metrics::instance()->increment(Metrics::ExpungedMessages, m_expungeTokens.count());
+        foreach (const QString &token, m_expungeTokens)
+            MessageTracer::instance()->end("text", token, "expunged");
         m_expungeTokens.clear();
     } else {
         qCritical() << Q_FUNC_INFO << "No stored messages interface present";
@@ -1560,7 +1665,7 @@ void TextChannelListener::slotExpungeMessages()
 
 void TextChannelListener::slotPresenceChanged(const Tp::Presence &presence)
 {
-    DEBUG() << Q_FUNC_INFO;
+    qCDebug(lcText) << Q_FUNC_INFO;
 
     Tp::Contact *contact = qobject_cast<Tp::Contact *>(sender());
     if (!contact) {
@@ -1591,7 +1696,7 @@ void TextChannelListener::slotPresenceChanged(const Tp::Presence &presence)
     QString newStatusMessage = m_PresenceStatuses.value(contact->id()).second;
 
     if (!newStatusMessage.isEmpty() && groupId() != -1) {
-        DEBUG() << Q_FUNC_INFO << "Preparing status message event.";
+        qCDebug(lcText) << Q_FUNC_INFO << "Preparing status message event.";
         CommHistory::Event event;
         event.setType(CommHistory::Event::StatusMessageEvent);
         event.setDirection(CommHistory::Event::Inbound);
@@ -1605,18 +1710,18 @@ void TextChannelListener::slotPresenceChanged(const Tp::Presence &presence)
 
         if (!eventModel().addEvent(event, true)) {
 
-            DEBUG() << "*** Adding status message to data model has been failed.";
+            qCDebug(lcText) << "*** Adding status message to data model has been failed.";
         }
     }
 }
 
 void TextChannelListener::channelReady()
 {
-    DEBUG() << Q_FUNC_INFO;
+    qCDebug(lcText) << Q_FUNC_INFO;
 
     if (m_Channel && m_Connection) {
         if (m_Channel->targetHandleType() == Tp::HandleTypeRoom) {
-            DEBUG() << Q_FUNC_INFO << "group chat: HandleTypeRoom";
+            qCDebug(lcText) << Q_FUNC_INFO << "group chat: HandleTypeRoom";
             m_IsGroupChat = true;
             m_GroupHandleType = Tp::HandleTypeRoom;
         } else if (m_Channel->targetHandleType() == Tp::HandleTypeNone
@@ -1626,8 +1731,8 @@ void TextChannelListener::channelReady()
             m_GroupHandleType = Tp::HandleTypeNone;
             m_PersistentId = m_Channel->immutableProperties().value(
                 TELEPATHY_CHANNEL_INTERFACE_PERSISTENT_ID).toString();
-            DEBUG() << Q_FUNC_INFO << "group chat: HandleTypeNone, PersistentId ="
-                     << m_PersistentId;
+            qCDebug(lcText) << Q_FUNC_INFO << "group chat: HandleTypeNone, PersistentId ="
+                            << m_PersistentId;
 
             if (m_PersistentId.isEmpty()) {
                 qCritical() << Q_FUNC_INFO << "No persistent id for Tp::HandleTypeNone groupchat";
@@ -1722,7 +1827,7 @@ void TextChannelListener::channelReady()
 
 void TextChannelListener::slotContactsReady(Tp::PendingOperation* operation)
 {
-    DEBUG() << Q_FUNC_INFO << channel();
+    qCDebug(lcText) << Q_FUNC_INFO << channel();
 
     if (operation && operation->isError()) {
         qWarning() << "No presence contacts" << operation->errorMessage();
@@ -1752,7 +1857,7 @@ void TextChannelListener::slotContactsReady(Tp::PendingOperation* operation)
 
 void TextChannelListener::slotPropertiesChanged(const Tp::PropertyValueList &props, bool listProps)
 {
-    DEBUG() << Q_FUNC_INFO << listProps;
+    qCDebug(lcText) << Q_FUNC_INFO << listProps;
     ChangedChannelProperty changedProperty = None;
 
     foreach (Tp::PropertyValue value, props) {
@@ -1760,20 +1865,20 @@ void TextChannelListener::slotPropertiesChanged(const Tp::PropertyValueList &pro
             if (value.identifier == m_Properties.value(CHANNEL_PROPERTY_NAME).propertyID) {
                 m_ChannelName = value.value.variant().toString();
                 changedProperty = ChannelName;
-                DEBUG() << Q_FUNC_INFO << "name changed:" << m_ChannelName;
+                qCDebug(lcText) << Q_FUNC_INFO << "name changed:" << m_ChannelName;
             }
         }
         if (m_Properties.contains(CHANNEL_PROPERTY_SUBJECT)) {
             if (value.identifier == m_Properties.value(CHANNEL_PROPERTY_SUBJECT).propertyID) {
                 m_ChannelSubject = value.value.variant().toString();
                 changedProperty = ChannelSubject;
-                DEBUG() << Q_FUNC_INFO << "subject changed:" << m_ChannelSubject;
+                qCDebug(lcText) << Q_FUNC_INFO << "subject changed:" << m_ChannelSubject;
             }
         }
         if (m_Properties.contains(CHANNEL_PROPERTY_SUBJECT_CONTACT)) {
             if (value.identifier == m_Properties.value(CHANNEL_PROPERTY_SUBJECT_CONTACT).propertyID) {
                 m_ChannelSubjectContactHandle = value.value.variant().toUInt();
-                DEBUG() << Q_FUNC_INFO << "handle of the contact who changed the subject:" << m_ChannelSubjectContactHandle;
+                qCDebug(lcText) << Q_FUNC_INFO << "handle of the contact who changed the subject:" << m_ChannelSubjectContactHandle;
             }
         }
     }
@@ -1789,7 +1894,7 @@ void TextChannelListener::slotGroupMembersChanged(
         const Tp::Contacts &groupMembersRemoved,
         const Tp::Channel::GroupMemberChangeDetails &details)
 {
-    DEBUG() << Q_FUNC_INFO;
+    qCDebug(lcText) << Q_FUNC_INFO;
 
     Q_UNUSED(groupLocalPendingMembersAdded);
     Q_UNUSED(groupRemotePendingMembersAdded);
@@ -1809,12 +1914,12 @@ void TextChannelListener::slotGroupMembersChanged(
 
                 if (contact == m_Channel->groupSelfContact()) {
 
-                    DEBUG() << "YOU've been banned/kicked by" << details.actor()->alias();
+                    qCDebug(lcText) << "YOU've been banned/kicked by" << details.actor()->alias();
                     sendGroupChatEvent(txt_qtn_msg_group_chat_you_removed(details.actor()->alias()));
                 }
                 else {
 
-                    DEBUG() << contact->alias() << "has been banned/kicked by" << details.actor()->alias();
+                    qCDebug(lcText) << contact->alias() << "has been banned/kicked by" << details.actor()->alias();
                     sendGroupChatEvent(txt_qtn_msg_group_chat_person_removed(details.actor()->alias(), contact->alias()));
                     m_PresenceStatuses.remove(contact->id());
                 }
@@ -1823,7 +1928,7 @@ void TextChannelListener::slotGroupMembersChanged(
             // otherwise fall back to normal _leave_
             else {
 
-                DEBUG() << contact->alias() << "has left the channel";
+                qCDebug(lcText) << contact->alias() << "has left the channel";
                 sendGroupChatEvent(txt_qtn_msg_group_chat_remote_left(contact->alias()));
                 m_PresenceStatuses.remove(contact->id());
             }
@@ -1853,7 +1958,7 @@ void TextChannelListener::slotGroupMembersChanged(
 
 void TextChannelListener::slotJoinedGroupChat(Tp::PendingOperation *operation)
 {
-    DEBUG() << Q_FUNC_INFO << channel();
+    qCDebug(lcText) << Q_FUNC_INFO << channel();
 
     if (operation && operation->isError()) {
         qWarning() << "No contacts" << operation->errorMessage();
@@ -1867,7 +1972,7 @@ void TextChannelListener::slotJoinedGroupChat(Tp::PendingOperation *operation)
             // Ignore self contact. In that case "You have joined..." message
             // should be shown instead (by messaging-ui)
             if (contacts.value(i) != m_Channel->groupSelfContact()) {
-                DEBUG() << contacts.value(i)->alias() << "joined";
+                qCDebug(lcText) << contacts.value(i)->alias() << "joined";
                 sendGroupChatEvent(txt_qtn_msg_group_chat_remote_joined(contacts.value(i)->alias()));
             }
         }
@@ -1885,8 +1990,8 @@ void TextChannelListener::slotHandleOwnersFetched(Tp::PendingOperation *op)
                 i.next();
                 if (i.value() == handleOwner->handle().first()) {
                     m_HandleOwnerNames.insert(i.key(), handleOwner->id());
-                    DEBUG() << Q_FUNC_INFO << "added handle owner:"
-                             << i.key() << handleOwner->id();
+                    qCDebug(lcText) << Q_FUNC_INFO << "added handle owner:"
+                                    << i.key() << handleOwner->id();
                     break;
                 }
             }
@@ -1930,6 +2035,8 @@ void TextChannelListener::tryToClose()
 
 void TextChannelListener::closed()
 {
+    TrafficRecorder::instance()->record(TrafficRecorder::TextChannelClosed,
+                                        QVariantList() << m_Channel->objectPath());
     m_pendingMessageIds.remove(m_Channel->objectPath());
     ChannelListener::closed();
 }
@@ -1937,7 +2044,7 @@ void TextChannelListener::closed()
 void TextChannelListener::finishedWithError(const QString& errorName,
                                             const QString& errorMessage)
 {
-    DEBUG() << Q_FUNC_INFO;
+    qCDebug(lcText) << Q_FUNC_INFO;
     if (!m_InvocationContext.isNull())
         m_InvocationContext->setFinishedWithError(errorName, errorMessage);
 
@@ -1952,14 +2059,14 @@ CommHistory::Group TextChannelListener::getGroupById(int groupId) const
     if (m_Group.isValid() && m_Group.id() == groupId)
         return m_Group;
 
-    if (!m_GroupModel || !m_GroupModel->isReady()) {
+    if (!m_GroupCache || !m_GroupCache->isReady()) {
         qWarning() << Q_FUNC_INFO << "Can't read group model";
         return CommHistory::Group();
     }
 
-    for (int row = 0; row < m_GroupModel->rowCount(); row++) {
-        QModelIndex index = m_GroupModel->index(row, 0);
-        CommHistory::Group group = m_GroupModel->group(index);
+    for (int row = 0; row < m_GroupCache->rowCount(); row++) {
+        QModelIndex index = m_GroupCache->index(row, 0);
+        CommHistory::Group group = m_GroupCache->group(index);
         if (group.isValid() && group.id() == groupId)
             return group;
     }
@@ -29,10 +29,10 @@
 #include <CommHistory/Group>
 
 #include "channellistener.h"
+#include "shutdowncoordinator.h"
 #include "constants.h"
 
 namespace CommHistory {
-    class GroupModel;
     class Event;
     class SingleEventModel;
     class ConversationModel;
@@ -52,12 +52,14 @@ namespace Tp {
 namespace RTComLogger
 {
 
+class GroupCache;
+
 /*!
  * \class TextChannelListener
  * \brief class responsible for listening and logging activity on a text channel
  * chats, sms
  */
-class TextChannelListener : public ChannelListener
+class TextChannelListener : public ChannelListener, public ShutdownParticipant
 {
     Q_OBJECT
 
@@ -70,6 +72,12 @@ public:
 
     virtual ~TextChannelListener();
 
+    /*!
+     * \brief Retries failed saves and expunges stored messages right away.
+     */
+    void drain();
+    QVariantMap pendingWork() const;
+
 Q_SIGNALS:
     /*!
      * \brief emitted when message saving fails
@@ -86,6 +94,7 @@ private Q_SLOTS:
     void slotGroupRemoved(const QModelIndex &index, int start, int end);
     void slotGroupInserted(const QModelIndex &index, int start, int end);
     void slotGroupDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight);
+    void slotGroupsUpdated(const QList<CommHistory::Group> &groups);
     void slotEventsCommitted(QList<CommHistory::Event> events, bool status);
     void slotContactsReady(Tp::PendingOperation* operation);
     void slotPropertiesChanged(const Tp::PropertyValueList &props, bool listProps = false);
@@ -178,7 +187,7 @@ private:
     // TODO: only for 1-1 chat, should be fixed later
     Tp::ContactPtr m_TargetContact;
 
-    CommHistory::GroupModel *m_GroupModel;
+    GroupCache *m_GroupCache;
     CommHistory::Group m_Group;
     bool m_GroupRequested;
 
@@ -230,6 +239,8 @@ private:
     CommHistory::ConversationModel* m_pConversationModel;
 #ifdef UNIT_TEST
     friend class Ut_TextChannelListener;
+    friend class Bm_TextChannelListener;
+    friend class Bm_Replay;
 #endif
 };
 
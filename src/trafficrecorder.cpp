@@ -0,0 +1,184 @@
+/******************************************************************************
+**
+** This file is part of commhistory-daemon.
+**
+** Copyright (C) 2026 Jolla Ltd.
+**
+** This library is free software; you can redistribute it and/or modify it
+** under the terms of the GNU Lesser General Public License version 2.1 as
+** published by the Free Software Foundation.
+**
+** This library is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+** or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+** License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this library; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+**
+******************************************************************************/
+
+
+
+#include "trafficrecorder.h"
+#include "debug.h"
+
+#include <QDateTime>
+#include <QDBusArgument>
+#include <QDBusVariant>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+using namespace RTComLogger;
+
+#define TRAFFIC_LOG_MAGIC 0x43484454 // "CHDT"
+#define TRAFFIC_LOG_VERSION 1
+// Bounds how much of the log a crash can lose
+#define TRAFFIC_LOG_FLUSH_INTERVAL_US 1000000
+
+TrafficRecorder* TrafficRecorder::instance()
+{
+    static TrafficRecorder* recorder = 0;
+    if (!recorder)
+        recorder = new TrafficRecorder;
+    return recorder;
+}
+
+TrafficRecorder::TrafficRecorder()
+    : m_lastFlushUs(0)
+{
+}
+
+bool TrafficRecorder::start(const QString &fileName)
+{
+    stop();
+
+    // Message contents are recorded, keep the log private
+    QByteArray path(QFile::encodeName(fileName));
+    int fd = open(path.constData(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        qWarning() << "Failed to open traffic log" << fileName << strerror(errno);
+        return false;
+    }
+
+    m_file.setFileName(fileName);
+    if (!m_file.open(fd, QIODevice::WriteOnly, QFileDevice::AutoCloseHandle)) {
+        qWarning() << "Failed to open traffic log" << fileName << m_file.errorString();
+        close(fd);
+        return false;
+    }
+
+    m_stream.setDevice(&m_file);
+    m_stream.setVersion(QDataStream::Qt_5_0);
+    m_stream << quint32(TRAFFIC_LOG_MAGIC) << quint32(TRAFFIC_LOG_VERSION)
+             << QDateTime::currentMSecsSinceEpoch();
+    m_timer.start();
+    m_lastFlushUs = 0;
+    DEBUG() << "Recording traffic to" << fileName;
+    return true;
+}
+
+void TrafficRecorder::stop()
+{
+    if (!isRecording())
+        return;
+
+    m_stream.setDevice(0);
+    m_file.close();
+}
+
+void TrafficRecorder::record(Kind kind, const QVariantList &args)
+{
+    if (!isRecording())
+        return;
+
+    const qint64 timestampUs = m_timer.nsecsElapsed() / 1000;
+    m_stream << quint8(kind) << timestampUs << args;
+    if (m_stream.status() != QDataStream::Ok) {
+        qWarning() << "Failed to write traffic log, recording stopped" << m_file.errorString();
+        stop();
+        return;
+    }
+
+    if (timestampUs - m_lastFlushUs > TRAFFIC_LOG_FLUSH_INTERVAL_US) {
+        m_file.flush();
+        m_lastFlushUs = timestampUs;
+    }
+}
+
+QVariant TrafficRecorder::plainValue(const QVariant &value)
+{
+    if (value.userType() == qMetaTypeId<QDBusVariant>())
+        return plainValue(value.value<QDBusVariant>().variant());
+    if (value.userType() != qMetaTypeId<QDBusArgument>())
+        return value;
+
+    const QDBusArgument arg = value.value<QDBusArgument>();
+    switch (arg.currentType()) {
+    case QDBusArgument::ArrayType: {
+        QVariantList list;
+        arg.beginArray();
+        while (!arg.atEnd())
+            list.append(plainValue(arg.asVariant()));
+        arg.endArray();
+        return list;
+    }
+    case QDBusArgument::StructureType: {
+        QVariantList list;
+        arg.beginStructure();
+        while (!arg.atEnd())
+            list.append(plainValue(arg.asVariant()));
+        arg.endStructure();
+        return list;
+    }
+    case QDBusArgument::MapType: {
+        QVariantMap map;
+        arg.beginMap();
+        while (!arg.atEnd()) {
+            arg.beginMapEntry();
+            const QString key(arg.asVariant().toString());
+            map.insert(key, plainValue(arg.asVariant()));
+            arg.endMapEntry();
+        }
+        arg.endMap();
+        return map;
+    }
+    default:
+        return plainValue(arg.asVariant());
+    }
+}
+
+qint64 TrafficRecorder::readHeader(QDataStream &stream)
+{
+    quint32 magic = 0, version = 0;
+    qint64 started = -1;
+
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream >> magic >> version >> started;
+    if (stream.status() != QDataStream::Ok || magic != TRAFFIC_LOG_MAGIC) {
+        qWarning() << "Not a traffic log";
+        return -1;
+    }
+    if (version != TRAFFIC_LOG_VERSION) {
+        qWarning() << "Unsupported traffic log version" << version;
+        return -1;
+    }
+    return started;
+}
+
+bool TrafficRecorder::readRecord(QDataStream &stream, Record &record)
+{
+    quint8 kind = 0;
+    stream >> kind >> record.timestampUs >> record.args;
+
+    // A truncated last record is expected if the daemon was killed
+    if (stream.status() != QDataStream::Ok)
+        return false;
+
+    record.kind = static_cast<Kind>(kind);
+    return true;
+}
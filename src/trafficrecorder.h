@@ -0,0 +1,107 @@
+/******************************************************************************
+**
+** This file is part of commhistory-daemon.
+**
+** Copyright (C) 2026 Jolla Ltd.
+**
+** This library is free software; you can redistribute it and/or modify it
+** under the terms of the GNU Lesser General Public License version 2.1 as
+** published by the Free Software Foundation.
+**
+** This library is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+** or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+** License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this library; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+**
+******************************************************************************/
+
+
+
+#ifndef TRAFFICRECORDER_H
+#define TRAFFICRECORDER_H
+
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QString>
+#include <QVariantList>
+
+namespace RTComLogger
+{
+
+/*!
+ * \class TrafficRecorder
+ * \brief Writes the inputs the daemon sees to a binary log, which the
+ * bm_replay benchmark feeds back through the Telepathy stubs.
+ *
+ * The log is a QDataStream of TRAFFIC_LOG_MAGIC, TRAFFIC_LOG_VERSION and
+ * the wall clock time recording started at, followed by records of a
+ * kind, microseconds since the start and a list of arguments. D-Bus
+ * wrappers are removed from the arguments, message parts are written
+ * as lists of QVariantMaps. Recording is off unless the daemon is
+ * started with --record <file>. Only used from the main thread.
+ */
+class TrafficRecorder
+{
+public:
+    enum Kind {
+        // account path, protocol, channel path, target id,
+        // target handle type, requested, group member ids
+        TextChannelOpened = 1,
+        // channel path, sender id, sender handle, message parts
+        TextMessageReceived,
+        // channel path, sending flags, message token, message parts
+        TextMessageSent,
+        // channel path
+        TextChannelClosed,
+        // MmsHandler slot name followed by its arguments
+        MmsEngineCall,
+        // list of [local uid, remote uid, chat type]
+        ObservedConversationsChanged,
+        // observed, filter account
+        InboxObservedChanged,
+        // infoOnly, list of [local uid, remote uid]
+        ContactsChanged
+    };
+
+    struct Record {
+        Kind kind;
+        qint64 timestampUs;
+        QVariantList args;
+    };
+
+    static TrafficRecorder* instance();
+
+    bool start(const QString &fileName);
+    void stop();
+    bool isRecording() const { return m_file.isOpen(); }
+
+    void record(Kind kind, const QVariantList &args);
+
+    /*!
+     * \brief Unwraps QDBusVariant and QDBusArgument values, recursively.
+     */
+    static QVariant plainValue(const QVariant &value);
+
+    /*!
+     * \brief Reads the log header, returns the start time in ms since the epoch or -1.
+     */
+    static qint64 readHeader(QDataStream &stream);
+    static bool readRecord(QDataStream &stream, Record &record);
+
+private:
+    TrafficRecorder();
+
+    QFile m_file;
+    QDataStream m_stream;
+    QElapsedTimer m_timer;
+    qint64 m_lastFlushUs;
+};
+
+} // namespace RTComLogger
+
+#endif // TRAFFICRECORDER_H
@@ -67,6 +67,16 @@ public:
         return m_DeliveredMessages;
     }
 
+    QList<int>& ut_getDeliverCallSizes()
+    {
+        return m_DeliverCallSizes;
+    }
+
+    QList<int>& ut_getExpungeCallSizes()
+    {
+        return m_ExpungeCallSizes;
+    }
+
 public Q_SLOTS:
     /**
      * Begins a call to the D-Bus method "DeliverStoredMessages" on the remote object.
@@ -80,6 +90,7 @@ public Q_SLOTS:
     inline QDBusPendingReply<> DeliverStoredMessages(const QStringList& storedMessageTokens)
     {
         m_DeliveredMessages << storedMessageTokens;
+        m_DeliverCallSizes << storedMessageTokens.size();
 
         QList<QVariant> argumentList;
         argumentList << QVariant::fromValue(storedMessageTokens);
@@ -98,6 +109,7 @@ public Q_SLOTS:
     inline QDBusPendingReply<> ExpungeMessages(const QStringList& storedMessageTokens)
     {
         m_ExpungedMessages << storedMessageTokens;
+        m_ExpungeCallSizes << storedMessageTokens.size();
 
         QList<QVariant> argumentList;
         argumentList << QVariant::fromValue(storedMessageTokens);
@@ -146,6 +158,8 @@ Q_SIGNALS:
 private:
     QStringList m_ExpungedMessages;
     QStringList m_DeliveredMessages;
+    QList<int> m_DeliverCallSizes;
+    QList<int> m_ExpungeCallSizes;
 
 };
 }
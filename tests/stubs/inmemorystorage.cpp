@@ -0,0 +1,206 @@
+/******************************************************************************
+**
+** This file is part of commhistory-daemon.
+**
+** Copyright (C) 2026 Jolla Ltd.
+**
+** This library is free software; you can redistribute it and/or modify it
+** under the terms of the GNU Lesser General Public License version 2.1 as
+** published by the Free Software Foundation.
+**
+** This library is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+** or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+** License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this library; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+**
+******************************************************************************/
+
+
+#include "inmemorystorage.h"
+
+#include <QElapsedTimer>
+#include <QThread>
+#include <QTimer>
+
+using namespace RTComLogger;
+using namespace CommHistory;
+
+InMemoryEventModel::InMemoryEventModel(InMemoryStorage *storage)
+    : m_storage(storage)
+{
+}
+
+void InMemoryEventModel::commit(const QList<Event> &events, bool successful)
+{
+    // Reported asynchronously, as the real model does
+    QTimer::singleShot(m_storage->commitDelay(), this, [this, events, successful]() {
+        emit eventsCommitted(events, successful);
+    });
+}
+
+bool InMemoryEventModel::addEvent(Event &event, bool toModelOnly)
+{
+    QList<Event> events;
+    events << event;
+    if (!addEvents(events, toModelOnly))
+        return false;
+    event = events.first();
+    return true;
+}
+
+bool InMemoryEventModel::addEvents(QList<Event> &events, bool toModelOnly)
+{
+    if (toModelOnly)
+        return EventModel::addEvents(events, true);
+
+    commit(events, m_storage->write(events, true));
+    return true;
+}
+
+bool InMemoryEventModel::modifyEvent(Event &event)
+{
+    QList<Event> events;
+    events << event;
+    return modifyEvents(events);
+}
+
+bool InMemoryEventModel::modifyEvents(QList<Event> &events)
+{
+    commit(events, m_storage->write(events, false));
+    return true;
+}
+
+bool InMemoryEventModel::modifyEventsInGroup(QList<Event> &events, Group group)
+{
+    for (int i = 0; i < events.size(); i++)
+        events[i].setGroupId(group.id());
+    return modifyEvents(events);
+}
+
+bool InMemoryEventModel::deleteEvent(int id)
+{
+    m_storage->remove(id);
+    return true;
+}
+
+bool InMemoryEventModel::deleteEvent(Event &event)
+{
+    return deleteEvent(event.id());
+}
+
+InMemoryStorage::InMemoryStorage()
+    : m_nextId(1),
+      m_latencyUs(0),
+      m_commitDelayMs(0),
+      m_failEvery(0),
+      m_failNext(0),
+      m_writes(0),
+      m_failures(0)
+{
+}
+
+void InMemoryStorage::clear()
+{
+    m_events.clear();
+    m_tokens.clear();
+    m_writes = 0;
+    m_failures = 0;
+}
+
+void InMemoryStorage::block() const
+{
+    if (m_latencyUs <= 0)
+        return;
+
+    // Busy wait, sleeping is too coarse for the short latencies
+    QElapsedTimer timer;
+    timer.start();
+    while (timer.nsecsElapsed() < m_latencyUs * 1000LL)
+        ;
+}
+
+bool InMemoryStorage::write(QList<Event> &events, bool add)
+{
+    block();
+
+    m_writes++;
+    if (m_failNext > 0 || (m_failEvery > 0 && m_writes % m_failEvery == 0)) {
+        if (m_failNext > 0)
+            m_failNext--;
+        m_failures++;
+        // Ids are handed out even when the transaction is rolled back
+        if (add) {
+            for (int i = 0; i < events.size(); i++)
+                events[i].setId(m_nextId++);
+        }
+        return false;
+    }
+
+    for (int i = 0; i < events.size(); i++) {
+        Event &event(events[i]);
+        if (add)
+            event.setId(m_nextId++);
+        m_events.insert(event.id(), event);
+        if (!event.messageToken().isEmpty())
+            m_tokens.insert(event.messageToken(), event.id());
+    }
+    return true;
+}
+
+void InMemoryStorage::remove(int eventId)
+{
+    QHash<int, Event>::iterator it = m_events.find(eventId);
+    if (it == m_events.end())
+        return;
+
+    m_tokens.remove(it->messageToken());
+    m_events.erase(it);
+}
+
+void InMemoryStorage::open()
+{
+}
+
+EventModel* InMemoryStorage::createEventModel()
+{
+    return new InMemoryEventModel(this);
+}
+
+bool InMemoryStorage::getEventByTokens(const QString &token, const QString &mmsId, int groupId,
+                                       const Event::PropertySet &properties, Event &event)
+{
+    Q_UNUSED(properties);
+    block();
+
+    if (!token.isEmpty()) {
+        QHash<QString, int>::const_iterator it = m_tokens.constFind(token);
+        if (it != m_tokens.constEnd()) {
+            event = m_events.value(it.value());
+            return true;
+        }
+    }
+
+    if (!mmsId.isEmpty()) {
+        foreach (const Event &e, m_events) {
+            if (e.mmsId() == mmsId && e.groupId() == groupId) {
+                event = e;
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+bool InMemoryStorage::getEventById(int eventId, Event &event)
+{
+    block();
+
+    QHash<int, Event>::const_iterator it = m_events.constFind(eventId);
+    if (it != m_events.constEnd())
+        event = it.value();
+    return true;
+}
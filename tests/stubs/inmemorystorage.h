@@ -0,0 +1,136 @@
+/******************************************************************************
+**
+** This file is part of commhistory-daemon.
+**
+** Copyright (C) 2026 Jolla Ltd.
+**
+** This library is free software; you can redistribute it and/or modify it
+** under the terms of the GNU Lesser General Public License version 2.1 as
+** published by the Free Software Foundation.
+**
+** This library is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+** or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+** License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this library; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+**
+******************************************************************************/
+
+
+#ifndef INMEMORYSTORAGE_H
+#define INMEMORYSTORAGE_H
+
+#include <QHash>
+#include <QList>
+#include <QString>
+
+#include <CommHistory/Event>
+#include <CommHistory/EventModel>
+#include <CommHistory/Group>
+
+#include "eventstorage.h"
+
+namespace RTComLogger {
+
+class InMemoryStorage;
+
+/*!
+ * \class InMemoryEventModel
+ * \brief EventModel whose writes go to an InMemoryStorage. The commit is
+ * reported with eventsCommitted() like the database backed model does.
+ */
+class InMemoryEventModel : public CommHistory::EventModel
+{
+public:
+    explicit InMemoryEventModel(InMemoryStorage *storage);
+
+    bool addEvent(CommHistory::Event &event, bool toModelOnly = false);
+    bool addEvents(QList<CommHistory::Event> &events, bool toModelOnly = false);
+    bool modifyEvent(CommHistory::Event &event);
+    bool modifyEvents(QList<CommHistory::Event> &events);
+    bool modifyEventsInGroup(QList<CommHistory::Event> &events, CommHistory::Group group);
+    bool deleteEvent(int id);
+    bool deleteEvent(CommHistory::Event &event);
+
+private:
+    void commit(const QList<CommHistory::Event> &events, bool successful);
+
+    InMemoryStorage *m_storage;
+};
+
+/*!
+ * \class InMemoryStorage
+ * \brief Test-only event storage without disk I/O.
+ *
+ * Writes and lookups take a fixed, configurable time and the commit is
+ * reported after a configurable delay, so a run costs the same every
+ * time and daemon CPU time can be told apart from database time.
+ * Failures are injected for every nth write or for the next writes; a
+ * failed write is reported through eventsCommitted() and not stored.
+ */
+class InMemoryStorage : public EventStorage
+{
+public:
+    InMemoryStorage();
+
+    /*!
+     * \brief Time every write and lookup blocks the caller, like a
+     * synchronous SQLite statement would.
+     */
+    void setLatency(int usecs) { m_latencyUs = usecs; }
+
+    /*!
+     * \brief Delay from a write to its eventsCommitted(), 0 reports it
+     * on the next event loop pass.
+     */
+    void setCommitDelay(int msecs) { m_commitDelayMs = msecs; }
+
+    /*!
+     * \brief Fails every \a n th write, 0 disables.
+     */
+    void setFailEvery(int n) { m_failEvery = n; }
+    void failNext(int count) { m_failNext = count; }
+
+    int commitDelay() const { return m_commitDelayMs; }
+
+    QList<CommHistory::Event> events() const { return m_events.values(); }
+    int writes() const { return m_writes; }
+    int failures() const { return m_failures; }
+    void clear();
+
+    // EventStorage
+    void open();
+    CommHistory::EventModel* createEventModel();
+    bool getEventByTokens(const QString &token, const QString &mmsId, int groupId,
+                          const CommHistory::Event::PropertySet &properties,
+                          CommHistory::Event &event);
+    bool getEventById(int eventId, CommHistory::Event &event);
+
+private:
+    friend class InMemoryEventModel;
+
+    /*!
+     * \brief Stores \a events, assigning ids to new ones.
+     * \return false if the write was chosen to fail.
+     */
+    bool write(QList<CommHistory::Event> &events, bool add);
+    void remove(int eventId);
+    void block() const;
+
+    QHash<int, CommHistory::Event> m_events;
+    QHash<QString, int> m_tokens;
+    int m_nextId;
+    int m_latencyUs;
+    int m_commitDelayMs;
+    int m_failEvery;
+    int m_failNext;
+    int m_writes;
+    int m_failures;
+};
+
+}
+
+#endif // INMEMORYSTORAGE_H
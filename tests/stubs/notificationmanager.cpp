@@ -2,6 +2,7 @@
 #include <QCoreApplication>
 
 #include "notificationmanager.h"
+#include "groupcache.h"
 
 using namespace RTComLogger;
 
@@ -20,6 +21,13 @@ NotificationManager::NotificationManager(QObject *parent) :
         delete m_GroupModel;
         m_GroupModel = 0;
     }
+
+    m_GroupCache = new GroupCache(this);
+    if (!m_GroupCache->getGroups()) {
+        qCritical() << "Failed to request group cache";
+        delete m_GroupCache;
+        m_GroupCache = 0;
+    }
 }
 
 NotificationManager* NotificationManager::instance()
@@ -68,9 +76,9 @@ void NotificationManager::removeConversationNotifications(const CommHistory::Rec
 {
 }
 
-CommHistory::GroupModel* NotificationManager::groupModel()
+GroupCache* NotificationManager::groupCache()
 {
-    return m_GroupModel;
+    return m_GroupCache;
 }
 
 QContactManager* NotificationManager::contactManager()
@@ -16,6 +16,8 @@ namespace CommHistory {
 
 namespace RTComLogger {
 
+class GroupCache;
+
 class NotificationManager : public QObject
 {
     Q_OBJECT
@@ -31,7 +33,7 @@ public:
     void removeNotificationToken(const QString &token);
     void removeConversationNotifications(const CommHistory::Recipient &recipient,
                                          CommHistory::Group::ChatType chatType=CommHistory::Group::ChatType::ChatTypeP2P);
-    CommHistory::GroupModel* groupModel();
+    GroupCache* groupCache();
     void showVoicemailNotification(int count);
     void playClass0SMSAlert();
     void requestClass0Notification(const CommHistory::Event &event);
@@ -49,6 +51,7 @@ public:
     static NotificationManager* m_pInstance;
     QContactManager *m_pContactManager;
     CommHistory::GroupModel *m_GroupModel;
+    GroupCache *m_GroupCache;
 };
 
 }
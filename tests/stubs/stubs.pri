@@ -27,6 +27,7 @@ HEADERS += $$PWD/TelepathyQt/streamed-media-channel.h
 HEADERS += $$PWD/TelepathyQt/account-set.h
 HEADERS += $$PWD/TpExtensions/cli-connection.h
 HEADERS += $$PWD/notificationmanager.h
+HEADERS += $$PWD/../../src/groupcache.h
 
 SOURCES += $$PWD/TelepathyQt/pending-operation.cpp
 SOURCES += $$PWD/TelepathyQt/ready-object.cpp
@@ -48,3 +49,4 @@ SOURCES += $$PWD/TelepathyQt/pending-contacts.cpp
 SOURCES += $$PWD/TelepathyQt/cli-properties.cpp
 SOURCES += $$PWD/TelepathyQt/streamed-media-channel.cpp
 SOURCES += $$PWD/notificationmanager.cpp
+SOURCES += $$PWD/../../src/groupcache.cpp
@@ -26,7 +26,8 @@ TEMPLATE = subdirs
 SUBDIRS = ut_notificationmanager \
           ut_textchannellistener \
           ut_streamchannellistener \
-          ut_messagereviver
+          ut_messagereviver \
+          ut_metrics
 
 # make sure the destination path exists
 !system( mkdir -p $${OUT_PWD}/bin ) : \
@@ -159,4 +159,106 @@ void Ut_MessageReviver::revive()
     QVERIFY(sm->ut_getExpungedMessages().contains("mrtc1"));
 }
 
+void Ut_MessageReviver::reviveMany()
+{
+    ConnectionUtils utils;
+    MessageReviver reviver(&utils);
+
+    Tp::ConnectionPtr conn(new Tp::Connection());
+    conn->ut_setIsReady(true);
+    conn->ut_setIsValid(true);
+
+    conn->ut_setInterfaces(QStringList()
+                           << CommHistoryTp::Client::ConnectionInterfaceStoredMessagesInterface::staticInterfaceName());
+
+    CommHistoryTp::Client::ConnectionInterfaceStoredMessagesInterface *sm = conn->optionalInterface<CommHistoryTp::Client::ConnectionInterfaceStoredMessagesInterface>();
+
+    // More than fit into a single lookup or D-Bus call
+    QStringList tokens;
+    tokens << "mrtc1";
+    for (int i = 0; i < 1200; i++)
+        tokens << QString("mrtc-many-%1").arg(i);
+
+    reviver.updateTokens(tokens, conn);
+    reviver.updateTokens(tokens, conn);
+
+    QStringList delivered = sm->ut_getDeliveredMessages();
+    QCOMPARE(delivered.size(), 1200);
+    QVERIFY(!delivered.contains("mrtc1"));
+    QVERIFY(delivered.contains("mrtc-many-0"));
+    QVERIFY(delivered.contains("mrtc-many-1199"));
+    QCOMPARE(sm->ut_getExpungedMessages(), QStringList() << "mrtc1");
+
+    // Split into calls of at most MAX_TOKENS_PER_CALL tokens
+    QCOMPARE(sm->ut_getDeliverCallSizes().size(), 12);
+    foreach (int size, sm->ut_getDeliverCallSizes())
+        QVERIFY(size <= 100);
+    QCOMPARE(sm->ut_getExpungeCallSizes(), QList<int>() << 1);
+}
+
+void Ut_MessageReviver::drained()
+{
+    ConnectionUtils utils;
+    MessageReviver reviver(&utils);
+
+    Tp::ConnectionPtr conn(new Tp::Connection());
+    conn->ut_setIsReady(true);
+    conn->ut_setIsValid(true);
+
+    conn->ut_setInterfaces(QStringList()
+                           << CommHistoryTp::Client::ConnectionInterfaceStoredMessagesInterface::staticInterfaceName());
+
+    CommHistoryTp::Client::ConnectionInterfaceStoredMessagesInterface *sm = conn->optionalInterface<CommHistoryTp::Client::ConnectionInterfaceStoredMessagesInterface>();
+
+    QMetaObject::invokeMethod(&reviver,
+                              "checkConnection",
+                              Qt::DirectConnection,
+                              Q_ARG(Tp::ConnectionPtr, conn));
+
+    QStringList tokens;
+    tokens << "mrtc5" << "mrtc6";
+    reviver.updateTokens(tokens, conn);
+    QCOMPARE(reviver.m_TimerConnections.size(), 1);
+
+    // Listeners handled everything before the recheck
+    emit sm->MessagesExpunged(tokens);
+    QVERIFY(reviver.m_TimerConnections.isEmpty());
+    QVERIFY(reviver.m_MessageTokens.isEmpty());
+    QVERIFY(sm->ut_getDeliveredMessages().isEmpty());
+}
+
+void Ut_MessageReviver::partiallyExpunged()
+{
+    ConnectionUtils utils;
+    MessageReviver reviver(&utils);
+
+    Tp::ConnectionPtr conn(new Tp::Connection());
+    conn->ut_setIsReady(true);
+    conn->ut_setIsValid(true);
+
+    conn->ut_setInterfaces(QStringList()
+                           << CommHistoryTp::Client::ConnectionInterfaceStoredMessagesInterface::staticInterfaceName());
+
+    CommHistoryTp::Client::ConnectionInterfaceStoredMessagesInterface *sm = conn->optionalInterface<CommHistoryTp::Client::ConnectionInterfaceStoredMessagesInterface>();
+
+    QMetaObject::invokeMethod(&reviver,
+                              "checkConnection",
+                              Qt::DirectConnection,
+                              Q_ARG(Tp::ConnectionPtr, conn));
+
+    QStringList tokens;
+    tokens << "mrtc7" << "mrtc8";
+    reviver.updateTokens(tokens, conn);
+
+    // The token set stays as fetched so that the recheck sees it stable
+    emit sm->MessagesExpunged(QStringList() << "mrtc7");
+    QCOMPARE(reviver.m_TimerConnections.size(), 1);
+    QCOMPARE(reviver.m_MessageTokens.value(conn->objectPath()).size(), 2);
+
+    reviver.updateTokens(tokens, conn);
+    QCOMPARE(sm->ut_getDeliveredMessages(), QStringList() << "mrtc8");
+    QVERIFY(sm->ut_getExpungedMessages().isEmpty());
+    QVERIFY(reviver.m_ExpungedTokens.isEmpty());
+}
+
 QTEST_MAIN(Ut_MessageReviver)
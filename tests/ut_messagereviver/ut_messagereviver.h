@@ -47,6 +47,9 @@ private Q_SLOTS:
 // Test functions
 private Q_SLOTS:
     void revive();
+    void reviveMany();
+    void drained();
+    void partiallyExpunged();
 
 private:
     CommHistory::GroupModel groupModel;
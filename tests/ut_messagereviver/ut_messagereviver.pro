@@ -39,10 +39,18 @@ INCLUDEPATH = ../stubs/ $${INCLUDEPATH}
 TARGET = ut_messagereviver
 
 TEST_SOURCES += $$COMMHISTORYDSRCDIR/messagereviver.cpp \
-                $$COMMHISTORYDSRCDIR/connectionutils.cpp
+                $$COMMHISTORYDSRCDIR/connectionutils.cpp \
+                $$COMMHISTORYDSRCDIR/databasereader.cpp \
+                $$COMMHISTORYDSRCDIR/debug.cpp \
+                $$COMMHISTORYDSRCDIR/metrics.cpp \
+                $$COMMHISTORYDSRCDIR/dbuscallstats.cpp
 
 TEST_HEADERS += $$COMMHISTORYDSRCDIR/messagereviver.h \
-                $$COMMHISTORYDSRCDIR/connectionutils.h
+                $$COMMHISTORYDSRCDIR/connectionutils.h \
+                $$COMMHISTORYDSRCDIR/databasereader.h \
+                $$COMMHISTORYDSRCDIR/debug.h \
+                $$COMMHISTORYDSRCDIR/metrics.h \
+                $$COMMHISTORYDSRCDIR/dbuscallstats.h
 
 HEADERS     += ut_messagereviver.h \
             $$TEST_HEADERS
@@ -51,7 +59,7 @@ SOURCES     += ut_messagereviver.cpp \
             $$TEST_SOURCES
 
 DESTDIR = ../bin
-QT += dbus
+QT += dbus sql
 QT -= gui
 
 # End of File
@@ -0,0 +1,105 @@
+/******************************************************************************
+**
+** This file is part of commhistory-daemon.
+**
+** Copyright (C) 2026 Jolla Ltd.
+**
+** This library is free software; you can redistribute it and/or modify it
+** under the terms of the GNU Lesser General Public License version 2.1 as
+** published by the Free Software Foundation.
+**
+** This library is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+** or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+** License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this library; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+**
+******************************************************************************/
+
+// INCLUDES
+#include "ut_metrics.h"
+
+#include <QTest>
+
+#include "metrics.h"
+
+using namespace RTComLogger;
+
+void Ut_Metrics::linearBuckets()
+{
+    // Values below 32 are reported exactly
+    for (qint64 value = 0; value < 32; value++) {
+        LatencyHistogram histogram;
+        histogram.record(value);
+        QCOMPARE(histogram.count(), qint64(1));
+        QCOMPARE(histogram.valueAtPercentile(50), value);
+    }
+}
+
+void Ut_Metrics::logBuckets_data()
+{
+    QTest::addColumn<qint64>("value");
+
+    QTest::newRow("first log bucket") << qint64(32);
+    QTest::newRow("inside bucket") << qint64(45);
+    QTest::newRow("power of two") << qint64(1024);
+    QTest::newRow("below power of two") << qint64(1023);
+    QTest::newRow("one second") << qint64(1000000);
+    QTest::newRow("one hour") << Q_INT64_C(3600000000);
+}
+
+void Ut_Metrics::logBuckets()
+{
+    QFETCH(qint64, value);
+
+    // Two values so the result is the bucket value, not clamped to min/max
+    LatencyHistogram histogram;
+    histogram.record(value);
+    histogram.record(value * 4);
+
+    const qint64 reported = histogram.valueAtPercentile(50);
+    QVERIFY2(qAbs(reported - value) * 100 <= value * 7,
+             qPrintable(QString("%1 reported as %2").arg(value).arg(reported)));
+}
+
+void Ut_Metrics::percentiles()
+{
+    LatencyHistogram histogram;
+    for (qint64 value = 1; value <= 1000; value++)
+        histogram.record(value);
+
+    QCOMPARE(histogram.count(), qint64(1000));
+    QVERIFY(qAbs(histogram.valueAtPercentile(50) - 500) <= 35);
+    QVERIFY(qAbs(histogram.valueAtPercentile(90) - 900) <= 63);
+    QVERIFY(qAbs(histogram.valueAtPercentile(99) - 990) <= 70);
+    QCOMPARE(histogram.valueAtPercentile(100), qint64(1000));
+
+    const QVariantMap map(histogram.toMap());
+    QCOMPARE(map.value("min").toLongLong(), qint64(1));
+    QCOMPARE(map.value("max").toLongLong(), qint64(1000));
+    QCOMPARE(map.value("mean").toLongLong(), qint64(500));
+
+    histogram.reset();
+    QCOMPARE(histogram.count(), qint64(0));
+    QCOMPARE(histogram.valueAtPercentile(50), qint64(0));
+}
+
+void Ut_Metrics::outOfRange()
+{
+    // Values past the last bucket are counted there
+    const qint64 huge = Q_INT64_C(1) << 62;
+    LatencyHistogram histogram;
+    histogram.record(1);
+    histogram.record(huge);
+
+    QCOMPARE(histogram.count(), qint64(2));
+    QCOMPARE(histogram.valueAtPercentile(50), qint64(1));
+    QVERIFY(histogram.valueAtPercentile(100) > Q_INT64_C(1) << 40);
+    QVERIFY(histogram.valueAtPercentile(100) <= huge);
+    QCOMPARE(histogram.toMap().value("max").toLongLong(), huge);
+}
+
+QTEST_GUILESS_MAIN(Ut_Metrics)
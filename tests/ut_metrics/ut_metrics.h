@@ -0,0 +1,44 @@
+/******************************************************************************
+**
+** This file is part of commhistory-daemon.
+**
+** Copyright (C) 2026 Jolla Ltd.
+**
+** This library is free software; you can redistribute it and/or modify it
+** under the terms of the GNU Lesser General Public License version 2.1 as
+** published by the Free Software Foundation.
+**
+** This library is distributed in the hope that it will be useful, but
+** WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+** or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public
+** License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this library; if not, write to the Free Software Foundation, Inc.,
+** 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+**
+******************************************************************************/
+
+#ifndef UT_METRICS_H
+#define UT_METRICS_H
+
+// INCLUDES
+#include <QObject>
+
+namespace RTComLogger {
+
+class Ut_Metrics : public QObject
+{
+    Q_OBJECT
+
+// Test functions
+private Q_SLOTS:
+    void linearBuckets();
+    void logBuckets_data();
+    void logBuckets();
+    void percentiles();
+    void outOfRange();
+};
+
+}
+#endif // UT_METRICS_H
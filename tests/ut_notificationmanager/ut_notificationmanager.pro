@@ -39,11 +39,25 @@ PKGCONFIG += mlocale5 TelepathyQt5 ngf-qt5 nemonotifications-qt5
 TEST_SOURCES += $$COMMHISTORYDSRCDIR/notificationmanager.cpp \
                 $$COMMHISTORYDSRCDIR/personalnotification.cpp \
                 $$COMMHISTORYDSRCDIR/serialisable.cpp \
-                $$COMMHISTORYDSRCDIR/commhistoryservice.cpp
+                $$COMMHISTORYDSRCDIR/commhistoryservice.cpp \
+                $$COMMHISTORYDSRCDIR/groupcache.cpp \
+                $$COMMHISTORYDSRCDIR/debug.cpp \
+                $$COMMHISTORYDSRCDIR/asynclogger.cpp \
+                $$COMMHISTORYDSRCDIR/messagetracer.cpp \
+                $$COMMHISTORYDSRCDIR/metrics.cpp \
+                $$COMMHISTORYDSRCDIR/dbuscallstats.cpp \
+                $$COMMHISTORYDSRCDIR/trafficrecorder.cpp
 TEST_HEADERS += $$COMMHISTORYDSRCDIR/notificationmanager.h \
                 $$COMMHISTORYDSRCDIR/personalnotification.h \
                 $$COMMHISTORYDSRCDIR/serialisable.h \
-                $$COMMHISTORYDSRCDIR/commhistoryservice.h
+                $$COMMHISTORYDSRCDIR/commhistoryservice.h \
+                $$COMMHISTORYDSRCDIR/groupcache.h \
+                $$COMMHISTORYDSRCDIR/debug.h \
+                $$COMMHISTORYDSRCDIR/asynclogger.h \
+                $$COMMHISTORYDSRCDIR/messagetracer.h \
+                $$COMMHISTORYDSRCDIR/metrics.h \
+                $$COMMHISTORYDSRCDIR/dbuscallstats.h \
+                $$COMMHISTORYDSRCDIR/trafficrecorder.h
 
 HEADERS     += ut_notificationmanager.h \
             $$TEST_HEADERS
@@ -39,10 +39,18 @@ INCLUDEPATH = ../stubs/ $${INCLUDEPATH}
 TARGET = ut_streamchannellistener
 
 TEST_SOURCES += $$COMMHISTORYDSRCDIR/streamchannellistener.cpp \
-                $$COMMHISTORYDSRCDIR/channellistener.cpp
+                $$COMMHISTORYDSRCDIR/channellistener.cpp \
+                $$COMMHISTORYDSRCDIR/calljournal.cpp \
+                $$COMMHISTORYDSRCDIR/eventmodelpool.cpp \
+                $$COMMHISTORYDSRCDIR/eventstorage.cpp \
+                $$COMMHISTORYDSRCDIR/debug.cpp
 
 TEST_HEADERS += $$COMMHISTORYDSRCDIR/streamchannellistener.h \
-                $$COMMHISTORYDSRCDIR/channellistener.h
+                $$COMMHISTORYDSRCDIR/channellistener.h \
+                $$COMMHISTORYDSRCDIR/calljournal.h \
+                $$COMMHISTORYDSRCDIR/eventmodelpool.h \
+                $$COMMHISTORYDSRCDIR/eventstorage.h \
+                $$COMMHISTORYDSRCDIR/debug.h
 
 HEADERS     += ut_streamchannellistener.h \
             $$TEST_HEADERS
@@ -29,6 +29,7 @@
 #include <QTest>
 #include <QTime>
 #include <QSignalSpy>
+#include <QTemporaryDir>
 #include <QUuid>
 
 #include "TelepathyQt/Types"
@@ -45,6 +46,8 @@
 
 #include "textchannellistener.h"
 #include "notificationmanager.h"
+#include "inmemorystorage.h"
+#include "trafficrecorder.h"
 
 // constants
 #define IM_USERNAME QLatin1String("dut@localhost")
@@ -1151,4 +1154,164 @@ void Ut_TextChannelListener::supersedes()
     QCOMPARE(nm->postedNotifications.last().chatType, CommHistory::Group::ChatTypeP2P);
 }
 
+namespace {
+
+// Installs an event storage for the scope, also when a check fails
+class EventStorageScope
+{
+public:
+    explicit EventStorageScope(EventStorage *storage) { EventStorage::setInstance(storage); }
+    ~EventStorageScope() { EventStorage::setInstance(0); }
+
+private:
+    Q_DISABLE_COPY(EventStorageScope)
+};
+
+Tp::ChannelPtr createImChannel(Tp::AccountPtr &acc)
+{
+    // setup connection
+    Tp::ConnectionPtr conn(new Tp::Connection());
+    conn->ut_setIsReady(true);
+
+    acc = Tp::AccountPtr(new Tp::Account(conn, IM_ACCOUNT_PATH));
+
+    //setup channel
+    Tp::ChannelPtr ch(new Tp::TextChannel(IM_CHANNEL_PATH));
+    ch->ut_setIsRequested(false);
+    ch->ut_setTargetHandleType(Tp::HandleTypeContact);
+    ch->ut_setTargetHandle(TARGET_HANDLE);
+    QVariantMap immProp;
+    immProp.insert(TELEPATHY_INTERFACE_CHANNEL ".TargetID", IM_USERNAME);
+    ch->ut_setImmutableProperties(immProp);
+    ch->ut_setConnection(conn);
+
+    return ch;
+}
+
+Tp::ReceivedMessage createImMessage(const QString &message, const QString &token)
+{
+    Tp::ReceivedMessage msg(Tp::MessagePartList() << Tp::MessagePart() << Tp::MessagePart());
+    addMsgHeader(msg, 0, "pending-message-id", pendingMessageId++);
+    addMsgHeader(msg, 0, "received", QDateTime::currentDateTime().toTime_t());
+    addMsgHeader(msg, 0, "message-type", (uint)Tp::ChannelTextMessageTypeNormal);
+    addMsgHeader(msg, 0, "message-token", token);
+    addMsgHeader(msg, 1,"content-type", "text/plain");
+    addMsgHeader(msg, 1,"content", message);
+    Tp::ContactPtr sender(new Tp::Contact());
+    sender->ut_setHandle(22);
+    sender->ut_setId(IM_USERNAME);
+    msg.ut_setSender(sender);
+
+    return msg;
+}
+
+}
+
+void Ut_TextChannelListener::saveFailureRetry()
+{
+    InMemoryStorage storage;
+    storage.failNext(1);
+    EventStorageScope storageScope(&storage);
+
+    NotificationManager *nm = NotificationManager::instance();
+    QVERIFY(nm);
+    nm->postedNotifications.clear();
+
+    Tp::AccountPtr acc;
+    Tp::ChannelPtr ch(createImChannel(acc));
+
+    Tp::MethodInvocationContextPtr<> ctx(new Tp::MethodInvocationContext<>());
+
+    TextChannelListener tcl(acc, ch, ctx);
+    waitInvocationContext(ctx, 5000);
+
+    QVERIFY(ctx->isFinished());
+    QVERIFY(!ctx->isError());
+
+    QString message = QString(RECEIVED_MESSAGE) + QString(" : retry ") + QTime::currentTime().toString(Qt::ISODate);
+    QString token = QUuid::createUuid().toString();
+    Tp::ReceivedMessage msg(createImMessage(message, token));
+
+    QSignalSpy eventCommitted(&tcl.eventModel(), SIGNAL(eventsCommitted(const QList<CommHistory::Event>&, bool)));
+    Tp::TextChannelPtr::dynamicCast(ch)->ut_receiveMessage(msg);
+
+    // the first write fails and is retried after a while
+    QVERIFY(waitSignal(eventCommitted, 5000));
+    QCOMPARE(eventCommitted.takeFirst().at(1).toBool(), false);
+    QCOMPARE(tcl.m_failedSaveEvents.size(), 1);
+    QVERIFY(storage.events().isEmpty());
+
+    QVERIFY(waitSignal(eventCommitted, 10000));
+    QCOMPARE(eventCommitted.takeFirst().at(1).toBool(), true);
+    QVERIFY(tcl.m_failedSaveEvents.isEmpty());
+
+    QCOMPARE(storage.failures(), 1);
+    QCOMPARE(storage.events().size(), 1);
+    QCOMPARE(storage.events().first().messageToken(), token);
+    QCOMPARE(storage.events().first().freeText(), message);
+}
+
+void Ut_TextChannelListener::recordTraffic()
+{
+    InMemoryStorage storage;
+    EventStorageScope storageScope(&storage);
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString logFile(dir.path() + QLatin1String("/traffic.log"));
+    TrafficRecorder *recorder = TrafficRecorder::instance();
+    QVERIFY(recorder->start(logFile));
+
+    Tp::AccountPtr acc;
+    Tp::ChannelPtr ch(createImChannel(acc));
+
+    Tp::MethodInvocationContextPtr<> ctx(new Tp::MethodInvocationContext<>());
+
+    TextChannelListener tcl(acc, ch, ctx);
+    waitInvocationContext(ctx, 5000);
+
+    QVERIFY(ctx->isFinished());
+    QVERIFY(!ctx->isError());
+
+    QString message = QString(RECEIVED_MESSAGE) + QString(" : recorded ") + QTime::currentTime().toString(Qt::ISODate);
+    QString token = QUuid::createUuid().toString();
+    Tp::ReceivedMessage msg(createImMessage(message, token));
+
+    QSignalSpy eventCommitted(&tcl.eventModel(), SIGNAL(eventsCommitted(const QList<CommHistory::Event>&, bool)));
+    Tp::TextChannelPtr::dynamicCast(ch)->ut_receiveMessage(msg);
+    QVERIFY(waitSignal(eventCommitted, 5000));
+
+    recorder->stop();
+    QVERIFY(!recorder->isRecording());
+
+    // the log reads back as the channel followed by the message
+    QFile file(logFile);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QDataStream stream(&file);
+    QVERIFY(TrafficRecorder::readHeader(stream) > 0);
+
+    TrafficRecorder::Record opened;
+    QVERIFY(TrafficRecorder::readRecord(stream, opened));
+    QCOMPARE(opened.kind, TrafficRecorder::TextChannelOpened);
+    QCOMPARE(opened.args.value(0).toString(), QString(IM_ACCOUNT_PATH));
+    QCOMPARE(opened.args.value(2).toString(), QString(IM_CHANNEL_PATH));
+    QCOMPARE(opened.args.value(3).toString(), QString(IM_USERNAME));
+    QCOMPARE(opened.args.value(5).toBool(), false);
+
+    TrafficRecorder::Record received;
+    QVERIFY(TrafficRecorder::readRecord(stream, received));
+    QCOMPARE(received.kind, TrafficRecorder::TextMessageReceived);
+    QVERIFY(received.timestampUs >= opened.timestampUs);
+    QCOMPARE(received.args.value(0).toString(), QString(IM_CHANNEL_PATH));
+    QCOMPARE(received.args.value(1).toString(), QString(IM_USERNAME));
+    QCOMPARE(received.args.value(2).toUInt(), 22u);
+    const QVariantList parts(received.args.value(3).toList());
+    QCOMPARE(parts.size(), 2);
+    QCOMPARE(parts.at(0).toMap().value("message-token").toString(), token);
+    QCOMPARE(parts.at(1).toMap().value("content").toString(), message);
+
+    TrafficRecorder::Record last;
+    QVERIFY(!TrafficRecorder::readRecord(stream, last));
+}
+
 QTEST_MAIN(Ut_TextChannelListener)
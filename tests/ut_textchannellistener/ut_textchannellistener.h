@@ -57,6 +57,8 @@ private Q_SLOTS:
     void groups();
     void receivingFromSelf();
     void supersedes();
+    void saveFailureRetry();
+    void recordTraffic();
 
 private:
     CommHistory::Group fetchGroup(const QString &localUid, const QString &remoteUid, bool wait);
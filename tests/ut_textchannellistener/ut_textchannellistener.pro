@@ -41,15 +41,33 @@ TARGET = ut_textchannellistener
 PKGCONFIG += mlocale5
 
 TEST_SOURCES += $$COMMHISTORYDSRCDIR/textchannellistener.cpp \
-                $$COMMHISTORYDSRCDIR/channellistener.cpp
+                $$COMMHISTORYDSRCDIR/channellistener.cpp \
+                $$COMMHISTORYDSRCDIR/eventmodelpool.cpp \
+                $$COMMHISTORYDSRCDIR/eventstorage.cpp \
+                $$COMMHISTORYDSRCDIR/shutdowncoordinator.cpp \
+                $$COMMHISTORYDSRCDIR/debug.cpp \
+                $$COMMHISTORYDSRCDIR/messagetracer.cpp \
+                $$COMMHISTORYDSRCDIR/metrics.cpp \
+                $$COMMHISTORYDSRCDIR/dbuscallstats.cpp \
+                $$COMMHISTORYDSRCDIR/trafficrecorder.cpp
 
 TEST_HEADERS += $$COMMHISTORYDSRCDIR/textchannellistener.h \
-                $$COMMHISTORYDSRCDIR/channellistener.h
+                $$COMMHISTORYDSRCDIR/channellistener.h \
+                $$COMMHISTORYDSRCDIR/eventmodelpool.h \
+                $$COMMHISTORYDSRCDIR/eventstorage.h \
+                $$COMMHISTORYDSRCDIR/shutdowncoordinator.h \
+                $$COMMHISTORYDSRCDIR/debug.h \
+                $$COMMHISTORYDSRCDIR/messagetracer.h \
+                $$COMMHISTORYDSRCDIR/metrics.h \
+                $$COMMHISTORYDSRCDIR/dbuscallstats.h \
+                $$COMMHISTORYDSRCDIR/trafficrecorder.h
 
 HEADERS     += ut_textchannellistener.h \
+            ../stubs/inmemorystorage.h \
             $$TEST_HEADERS
 
 SOURCES     += ut_textchannellistener.cpp \
+            ../stubs/inmemorystorage.cpp \
             $$TEST_SOURCES
 
 DESTDIR = ../bin